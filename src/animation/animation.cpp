@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <vector>
 
 #include "animation.h"
@@ -65,6 +66,19 @@ Animation::Animation(Model *model)
     }
 }
 
+Animation::Animation(const Animation &animation)
+    : m_name(animation.m_name),
+      m_duration(animation.m_duration),
+      m_ticksPerSecond(animation.m_ticksPerSecond),
+      m_boneInfoMap(animation.m_boneInfoMap)
+{
+    m_rootNode = new AssimpNodeData();
+    copyHierarchy(m_rootNode, animation.m_rootNode);
+
+    for (auto const &[boneName, bone] : animation.m_bones)
+        m_bones[boneName] = new Bone(*bone);
+}
+
 Animation::~Animation()
 {
     for (auto iter = m_assimpNodes.begin(); iter != m_assimpNodes.end(); ++iter)
@@ -142,24 +156,51 @@ void Animation::readHierarchy(AssimpNodeData *dest, const aiNode *src)
     }
 }
 
-void Animation::setBlendMask(std::unordered_map<std::string, float> blendMask, float defaultValue)
+void Animation::copyHierarchy(AssimpNodeData *dest, const AssimpNodeData *src)
 {
-    m_blendMask = blendMask;
+    dest->name = src->name;
+    dest->transformation = src->transformation;
+    m_assimpNodes[dest->name] = dest;
 
-    for (auto it = m_bones.begin(); it != m_bones.end(); ++it)
+    for (int i = 0; i < src->children.size(); i++)
     {
-        Bone *bone = it->second;
-        bone->m_blendFactor = defaultValue;
+        AssimpNodeData *newData = new AssimpNodeData();
+
+        copyHierarchy(newData, src->children[i]);
+        dest->children.push_back(newData);
     }
+}
 
-    for (auto it = m_blendMask.begin(); it != m_blendMask.end(); ++it)
+void Animation::compress(const ClipCompression &settings)
+{
+    size_t sourceSize = getMemoryUsage();
+
+    float maxPositionError = 0.f;
+    float maxRotationError = 0.f;
+    float maxScaleError = 0.f;
+    int rawCount = 0;
+    for (auto const &[boneName, bone] : m_bones)
     {
-        std::string name = it->first;
-        Bone *bone = getBone(name);
-        if (bone)
-        {
-            float blendFactor = it->second;
-            bone->m_blendFactor = blendFactor;
-        }
+        rawCount += bone->compress(settings);
+        maxPositionError = std::max(maxPositionError, bone->m_compressedPositions.m_maxError);
+        maxRotationError = std::max(maxRotationError, bone->m_compressedRotations.m_maxError);
+        maxScaleError = std::max(maxScaleError, bone->m_compressedScales.m_maxError);
     }
+
+    size_t compressedSize = getMemoryUsage();
+    std::cout << "Animation: compressed: " << m_name
+              << ": " << sourceSize / 1024.f << "kb -> " << compressedSize / 1024.f << "kb"
+              << ", max error: position: " << maxPositionError
+              << ", rotation: " << maxRotationError
+              << ", scale: " << maxScaleError
+              << ", raw tracks: " << rawCount << std::endl;
+}
+
+size_t Animation::getMemoryUsage()
+{
+    size_t size = 0;
+    for (auto const &[boneName, bone] : m_bones)
+        size += bone->getMemoryUsage();
+
+    return size;
 }
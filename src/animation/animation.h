@@ -19,6 +19,8 @@ struct AssimpNodeData
     std::vector<AssimpNodeData *> children;
 };
 
+// immutable clip data, shared through ResourceManager::getAnimation
+// per-instance playback state lives on the Animator
 class Animation
 {
 public:
@@ -31,15 +33,18 @@ public:
 
     std::unordered_map<std::string, Bone *> m_bones;
     std::map<std::string, BoneInfo> m_boneInfoMap;
-    std::unordered_map<std::string, float> m_blendMask;
 
     Animation(const std::string &animationName, Model *model);
     Animation(Model *model);
+    // deep copy, for clips that are written at runtime like ragdoll poses
+    Animation(const Animation &animation);
     ~Animation();
     Bone *getBone(const std::string &name);
     void readBones(const aiAnimation *animation, Model &model);
     void readHierarchy(AssimpNodeData *dest, const aiNode *src);
-    void setBlendMask(std::unordered_map<std::string, float> blendMask, float defaultValue);
+    void copyHierarchy(AssimpNodeData *dest, const AssimpNodeData *src);
+    void compress(const ClipCompression &settings);
+    size_t getMemoryUsage();
 };
 
 #endif /* animation_hpp */
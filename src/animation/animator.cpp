@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <vector>
 
 #include "animator.h"
@@ -7,15 +8,23 @@ Animator::Animator(std::vector<Animation *> animations)
 {
     // TODO: initial state
 
-    // TODO: better way?
-    int size = m_animations[0]->m_bones.size();
-    m_finalBoneMatrices.reserve(size);
-    for (int i = 0; i < size; i++)
-        m_finalBoneMatrices.push_back(glm::mat4(1.0f));
-
-    m_globalMatrices.reserve(size);
-    for (int i = 0; i < size; i++)
-        m_globalMatrices.push_back(glm::mat4(1.0f));
+    // TODO: always first animation is correct?
+    Animation *animation = m_animations[0];
+    m_skeleton = new Skeleton(animation->m_rootNode, animation->m_boneInfoMap);
+
+    int size = std::max((int)animation->m_bones.size(), m_skeleton->m_boneCount);
+    m_finalBoneMatrices.resize(size, glm::mat4(1.0f));
+    m_globalMatrices.resize(size, glm::mat4(1.0f));
+
+    int nodeCount = m_skeleton->m_nodes.size();
+    m_localNodeMatrices.resize(nodeCount, glm::mat4(1.0f));
+    m_globalNodeMatrices.resize(nodeCount, glm::mat4(1.0f));
+    m_localPoses.resize(nodeCount);
+    m_previousLocalPoses.resize(nodeCount);
+    m_layerPose.resize(nodeCount);
+    m_layerWeights.resize(m_layerPose.m_capacity, 0.f);
+    m_interpolatedPoses.resize(nodeCount);
+    m_poseMatrices.resize(m_layerPose.m_capacity, glm::mat4(1.0f));
 }
 
 Animator::~Animator()
@@ -27,6 +36,12 @@ Animator::~Animator()
     for (int i = 0; i < m_state.poses.size(); i++)
         delete m_state.poses[i];
     m_state.poses.clear();
+
+    for (int i = 0; i < m_blendMasks.size(); i++)
+        delete m_blendMasks[i];
+    m_blendMasks.clear();
+
+    delete m_skeleton;
 }
 
 void Animator::update(float deltaTime)
@@ -37,106 +52,334 @@ void Animator::update(float deltaTime)
     for (int i = 0; i < m_state.poses.size(); i++)
         m_state.poses[i]->updateTimer(deltaTime, m_startOffset);
 
-    calculateBoneTransform(m_animations[0]->m_rootNode, glm::mat4(1.0f));
+    m_evaluationPending = true;
 }
 
-void Animator::calculateBoneTransform(const AssimpNodeData *node, glm::mat4 parentTransform)
+// only touches state of this animator and reads shared clips, safe to run on a worker thread
+void Animator::evaluate()
 {
-    std::string nodeName = node->name;
-    glm::mat4 nodeTransform = node->transformation;
+    m_evaluationPending = false;
 
-    glm::vec3 blendedT;
-    glm::quat blendedR;
-    glm::vec3 blendedS;
+    if (m_updateInterval <= 1)
+    {
+        calculateBoneTransforms();
+        return;
+    }
 
-    bool boneProcessed = false;
-    float totalWeight = 0.0f;
-    for (int i = 0; i < m_state.animations.size(); i++)
+    // reduced rate, the displayed pose trails the sampled one by up to an interval
+    bool hasHistory = m_framesSinceEvaluation != -1;
+    if (!hasHistory || ++m_framesSinceEvaluation >= m_updateInterval)
     {
-        Anim *anim = m_state.animations[i];
-        Bone *bone = anim->m_animation->getBone(nodeName);
+        if (hasHistory)
+            m_previousLocalPoses = m_localPoses;
 
-        if (!bone)
-            continue;
+        if (m_batchBlending)
+            sampleLocalPosesBatch();
+        else
+            sampleLocalPoses();
 
-        float blendWeight = anim->m_blendFactor * bone->m_blendFactor;
+        if (!hasHistory)
+            m_previousLocalPoses = m_localPoses;
 
-        if (blendWeight == 0.0f)
-            continue;
+        m_framesSinceEvaluation = 0;
+    }
+
+    float factor = (float)m_framesSinceEvaluation / m_updateInterval;
+    if (m_batchBlending)
+        updateMatricesBatch(factor);
+    else
+        updateMatrices(factor);
+}
 
-        bone->update(anim->m_timer);
+void Animator::calculateBoneTransforms()
+{
+    if (m_batchBlending)
+    {
+        sampleLocalPosesBatch();
+        updateMatricesBatch(1.f);
+    }
+    else
+    {
+        sampleLocalPoses();
+        updateMatrices(1.f);
+    }
 
-        totalWeight += blendWeight;
+    m_framesSinceEvaluation = -1;
+}
 
-        // TODO: blend weight influence
-        if (!boneProcessed) // first bone
+float Animator::compareBlending()
+{
+    // both paths run at the full rate, the state of a reduced rate animator is put back afterwards
+    bool batchBlending = m_batchBlending;
+    int framesSinceEvaluation = m_framesSinceEvaluation;
+    PoseBuffer localPoses = m_localPoses;
+    std::vector<glm::mat4> finalBoneMatrices = m_finalBoneMatrices;
+    std::vector<glm::mat4> globalMatrices = m_globalMatrices;
+    std::vector<glm::mat4> localNodeMatrices = m_localNodeMatrices;
+    std::vector<glm::mat4> globalNodeMatrices = m_globalNodeMatrices;
+
+    m_batchBlending = false;
+    calculateBoneTransforms();
+    std::vector<glm::mat4> scalarMatrices = m_finalBoneMatrices;
+
+    m_batchBlending = true;
+    calculateBoneTransforms();
+
+    float maxError = 0.f;
+    for (int i = 0; i < m_finalBoneMatrices.size(); i++)
+    {
+        for (int c = 0; c < 4; c++)
         {
-            blendedT = bone->m_translation;
-            blendedR = bone->m_rotation;
-            blendedS = bone->m_scale;
+            glm::vec4 difference = glm::abs(m_finalBoneMatrices[i][c] - scalarMatrices[i][c]);
+            maxError = std::max(maxError, std::max(std::max(difference.x, difference.y), std::max(difference.z, difference.w)));
         }
-        else
+    }
+
+    m_batchBlending = batchBlending;
+    m_framesSinceEvaluation = framesSinceEvaluation;
+    m_localPoses = localPoses;
+    m_finalBoneMatrices = finalBoneMatrices;
+    m_globalMatrices = globalMatrices;
+    m_localNodeMatrices = localNodeMatrices;
+    m_globalNodeMatrices = globalNodeMatrices;
+
+    return maxError;
+}
+
+void Animator::setLod(AnimationLod lod, const AnimationLodSettings &settings)
+{
+    if (lod != m_lod)
+        m_framesSinceEvaluation = -1;
+
+    m_lod = lod;
+    m_maxBoneDepth = lod == AnimationLod::full ? -1 : settings.reducedBoneDepth;
+    m_updateInterval = lod == AnimationLod::reducedRate ? std::max(1, settings.reducedRateInterval) : 1;
+}
+
+bool Animator::isNodeEvaluated(const SkeletonNode &node)
+{
+    return m_maxBoneDepth == -1 || node.boneDepth <= m_maxBoneDepth;
+}
+
+void Animator::sampleLocalPoses()
+{
+    const std::vector<SkeletonNode> &nodes = m_skeleton->m_nodes;
+    int nodeCount = nodes.size();
+
+    for (int nodeIndex = 0; nodeIndex < nodeCount; nodeIndex++)
+    {
+        if (!isNodeEvaluated(nodes[nodeIndex]))
+            continue;
+
+        glm::vec3 blendedT;
+        glm::quat blendedR;
+        glm::vec3 blendedS;
+
+        bool boneProcessed = false;
+        float totalWeight = 0.0f;
+        for (int i = 0; i < m_state.animations.size(); i++)
+        {
+            Anim *anim = m_state.animations[i];
+            Bone *bone = anim->m_channels[nodeIndex];
+
+            if (!bone)
+                continue;
+
+            float blendWeight = anim->m_blendFactor * anim->m_blendMask[nodeIndex];
+
+            if (blendWeight == 0.0f)
+                continue;
+
+            BonePose pose = bone->sample(anim->m_timer, anim->m_cursors[nodeIndex]);
+
+            totalWeight += blendWeight;
+
+            // TODO: blend weight influence
+            if (!boneProcessed) // first bone
+            {
+                blendedT = pose.translation;
+                blendedR = pose.rotation;
+                blendedS = pose.scale;
+            }
+            else
+            {
+                float weight = blendWeight / totalWeight;
+                if (isnan(weight))
+                    weight = 1.0f;
+
+                blendedT = glm::mix(blendedT, pose.translation, weight);
+                blendedR = glm::slerp(blendedR, pose.rotation, weight);
+                blendedS = glm::mix(blendedS, pose.scale, weight);
+            }
+
+            boneProcessed = true;
+        }
+
+        // pose influence
+        for (int i = 0; i < m_state.poses.size(); i++)
         {
-            float weight = blendWeight / totalWeight;
-            if (isnan(weight))
-                weight = 1.0f;
+            Anim *anim = m_state.poses[i];
+            Bone *bone = anim->m_channels[nodeIndex];
+
+            if (!bone)
+                continue;
+
+            float blendWeight = anim->m_blendFactor * anim->m_blendMask[nodeIndex];
 
-            blendedT = glm::mix(blendedT, bone->m_translation, weight);
-            blendedR = glm::slerp(blendedR, bone->m_rotation, weight);
-            blendedS = glm::mix(blendedS, bone->m_scale, weight);
+            if (blendWeight == 0.0f)
+                continue;
+
+            BonePose pose = bone->sample(anim->m_timer, anim->m_cursors[nodeIndex]);
+
+            blendedT = glm::mix(blendedT, pose.translation, blendWeight);
+            blendedR = glm::slerp(blendedR, pose.rotation, blendWeight);
+            blendedS = glm::mix(blendedS, pose.scale, blendWeight);
         }
 
-        boneProcessed = true;
+        m_localPoses.m_weights[nodeIndex] = boneProcessed ? totalWeight : 0.f;
+        if (boneProcessed)
+            m_localPoses.set(nodeIndex, BonePose{blendedT, glm::normalize(blendedR), blendedS});
+    }
+}
+
+// same blending as sampleLocalPoses on whole poses, a layer at a time
+void Animator::sampleLocalPosesBatch()
+{
+    m_localPoses.resetWeights();
+
+    for (int i = 0; i < m_state.animations.size(); i++)
+    {
+        if (sampleLayer(m_state.animations[i]))
+            PoseBlend::accumulate(m_localPoses, m_layerPose, m_layerWeights.data());
     }
 
-    // pose influence
     for (int i = 0; i < m_state.poses.size(); i++)
     {
-        Anim *anim = m_state.poses[i];
-        Animation *animation = anim->m_animation;
-        Bone *bone = animation->getBone(nodeName);
+        if (sampleLayer(m_state.poses[i]))
+            PoseBlend::overlay(m_localPoses, m_layerPose, m_layerWeights.data());
+    }
 
-        if (!bone)
-            continue;
+    PoseBlend::normalizeRotations(m_localPoses);
+}
 
-        float blendWeight = anim->m_blendFactor * bone->m_blendFactor;
+// samples the weighted nodes of the anim into the layer pose, false when nothing is weighted
+bool Animator::sampleLayer(Anim *anim)
+{
+    const std::vector<SkeletonNode> &nodes = m_skeleton->m_nodes;
+    int nodeCount = nodes.size();
+
+    bool weighted = false;
+    for (int nodeIndex = 0; nodeIndex < nodeCount; nodeIndex++)
+    {
+        Bone *bone = anim->m_channels[nodeIndex];
+        float blendWeight = 0.f;
+
+        if (bone && isNodeEvaluated(nodes[nodeIndex]))
+            blendWeight = anim->m_blendFactor * anim->m_blendMask[nodeIndex];
+
+        m_layerWeights[nodeIndex] = blendWeight;
 
         if (blendWeight == 0.0f)
             continue;
 
-        bone->update(anim->m_timer);
+        m_layerPose.set(nodeIndex, bone->sample(anim->m_timer, anim->m_cursors[nodeIndex]));
+        weighted = true;
+    }
 
-        blendedT = glm::mix(blendedT, bone->m_translation, blendWeight);
-        blendedR = glm::slerp(blendedR, bone->m_rotation, blendWeight);
-        blendedS = glm::mix(blendedS, bone->m_scale, blendWeight);
+    return weighted;
+}
+
+// factor blends from the previous to the last sampled pose
+void Animator::updateMatrices(float factor)
+{
+    const std::vector<SkeletonNode> &nodes = m_skeleton->m_nodes;
+    int nodeCount = nodes.size();
+
+    for (int nodeIndex = 0; nodeIndex < nodeCount; nodeIndex++)
+    {
+        const SkeletonNode &node = nodes[nodeIndex];
+
+        // skipped nodes keep their last local transform
+        if (isNodeEvaluated(node))
+        {
+            glm::mat4 nodeTransform = node.transformation;
+
+            if (m_localPoses.m_weights[nodeIndex] > 0.f)
+            {
+                BonePose pose = m_localPoses.get(nodeIndex);
+                if (factor < 1.f)
+                {
+                    BonePose previous = m_previousLocalPoses.get(nodeIndex);
+                    pose.translation = glm::mix(previous.translation, pose.translation, factor);
+                    pose.rotation = glm::normalize(glm::slerp(previous.rotation, pose.rotation, factor));
+                    pose.scale = glm::mix(previous.scale, pose.scale, factor);
+                }
+
+                nodeTransform = glm::translate(glm::mat4(1), pose.translation) *
+                                glm::toMat4(pose.rotation) *
+                                glm::scale(glm::mat4(1), pose.scale);
+            }
+
+            m_localNodeMatrices[nodeIndex] = nodeTransform;
+        }
+
+        // parents are evaluated before their children
+        glm::mat4 globalTransformation = node.parent == -1
+                                             ? m_localNodeMatrices[nodeIndex]
+                                             : m_globalNodeMatrices[node.parent] * m_localNodeMatrices[nodeIndex];
+        m_globalNodeMatrices[nodeIndex] = globalTransformation;
+
+        if (node.boneIndex != -1)
+        {
+            m_finalBoneMatrices[node.boneIndex] = globalTransformation * node.offset;
+            m_globalMatrices[node.boneIndex] = globalTransformation;
+        }
     }
+}
 
-    if (boneProcessed)
+void Animator::updateMatricesBatch(float factor)
+{
+    const PoseBuffer *pose = &m_localPoses;
+    if (factor < 1.f)
     {
-        nodeTransform = glm::translate(glm::mat4(1), blendedT) *
-                        glm::toMat4(glm::normalize(blendedR)) *
-                        glm::scale(glm::mat4(1), blendedS);
+        PoseBlend::interpolate(m_interpolatedPoses, m_previousLocalPoses, m_localPoses, factor);
+        pose = &m_interpolatedPoses;
     }
 
-    glm::mat4 globalTransformation = parentTransform * nodeTransform;
+    PoseBlend::compose(*pose, m_poseMatrices.data());
 
-    // TODO: always first index is correct?
-    auto boneInfoMap = m_animations[0]->m_boneInfoMap;
-    if (boneInfoMap.find(nodeName) != boneInfoMap.end())
+    const std::vector<SkeletonNode> &nodes = m_skeleton->m_nodes;
+    int nodeCount = nodes.size();
+
+    for (int nodeIndex = 0; nodeIndex < nodeCount; nodeIndex++)
     {
-        int index = boneInfoMap[nodeName].id;
-        glm::mat4 offset = boneInfoMap[nodeName].offset;
-        m_finalBoneMatrices[index] = globalTransformation * offset;
-        m_globalMatrices[index] = globalTransformation;
-    }
+        const SkeletonNode &node = nodes[nodeIndex];
+
+        // skipped nodes keep their last local transform
+        if (isNodeEvaluated(node))
+        {
+            m_localNodeMatrices[nodeIndex] = pose->m_weights[nodeIndex] > 0.f
+                                                 ? m_poseMatrices[nodeIndex]
+                                                 : node.transformation;
+        }
+
+        if (node.parent == -1)
+            m_globalNodeMatrices[nodeIndex] = m_localNodeMatrices[nodeIndex];
+        else
+            PoseBlend::multiply(m_globalNodeMatrices[node.parent], m_localNodeMatrices[nodeIndex], m_globalNodeMatrices[nodeIndex]);
 
-    for (int i = 0; i < node->children.size(); i++)
-        calculateBoneTransform(node->children[i], globalTransformation);
+        if (node.boneIndex != -1)
+        {
+            PoseBlend::multiply(m_globalNodeMatrices[nodeIndex], node.offset, m_finalBoneMatrices[node.boneIndex]);
+            m_globalMatrices[node.boneIndex] = m_globalNodeMatrices[nodeIndex];
+        }
+    }
 }
 
 Anim *Animator::addStateAnimation(Animation *animation)
 {
     Anim *anim = new Anim(animation);
+    anim->bindSkeleton(*m_skeleton);
     m_state.animations.push_back(anim);
 
     return anim;
@@ -145,22 +388,38 @@ Anim *Animator::addStateAnimation(Animation *animation)
 Anim *Animator::addPoseAnimation(Animation *animation)
 {
     Anim *anim = new Anim(animation);
+    anim->bindSkeleton(*m_skeleton);
     m_state.poses.push_back(anim);
 
     return anim;
 }
 
+BlendMask *Animator::createBlendMask(float defaultValue)
+{
+    BlendMask *mask = new BlendMask(*m_skeleton, defaultValue);
+    m_blendMasks.push_back(mask);
+
+    return mask;
+}
+
 // Anim
 
 Anim::Anim(Animation *animation)
     : m_animation(animation),
+      m_ownedAnimation(nullptr),
       m_blendFactor(0.f),
       m_playbackSpeed(1.f),
       m_timerActive(true),
-      m_timer(0.f)
+      m_timer(0.f),
+      m_skeleton(nullptr)
 {
 }
 
+Anim::~Anim()
+{
+    delete m_ownedAnimation;
+}
+
 void Anim::updateTimer(float deltaTime, float startOffset)
 {
     if (!m_timerActive)
@@ -178,3 +437,88 @@ void Anim::updateTimer(float deltaTime, float startOffset)
 
     m_timer = clampedTime;
 }
+
+void Anim::bindSkeleton(const Skeleton &skeleton)
+{
+    m_skeleton = &skeleton;
+
+    int nodeCount = skeleton.m_nodes.size();
+    m_channels.assign(nodeCount, nullptr);
+    m_blendMask.assign(nodeCount, 1.f);
+    m_cursors.assign(nodeCount, BoneCursor());
+
+    for (int i = 0; i < nodeCount; i++)
+        m_channels[i] = m_animation->getBone(skeleton.m_nodes[i].name);
+}
+
+void Anim::makeClipUnique()
+{
+    if (m_ownedAnimation)
+        return;
+
+    m_ownedAnimation = new Animation(*m_animation);
+    m_animation = m_ownedAnimation;
+
+    // channels point into the copy, masks and cursors are kept
+    if (!m_skeleton)
+        return;
+
+    for (int i = 0; i < m_skeleton->m_nodes.size(); i++)
+        m_channels[i] = m_animation->getBone(m_skeleton->m_nodes[i].name);
+}
+
+void Anim::setBlendMask(const BlendMask *mask)
+{
+    m_maskLayers.clear();
+    m_maskLayers.push_back(BlendMaskLayer{mask, 1.f});
+    updateBlendMask();
+}
+
+int Anim::addBlendMaskLayer(const BlendMask *mask, float weight)
+{
+    m_maskLayers.push_back(BlendMaskLayer{mask, weight});
+    updateBlendMask();
+
+    return m_maskLayers.size() - 1;
+}
+
+void Anim::setBlendMaskLayerWeight(int layer, float weight)
+{
+    if (m_maskLayers[layer].weight == weight)
+        return;
+
+    m_maskLayers[layer].weight = weight;
+    updateBlendMask();
+}
+
+// only array reads, cheap enough to run when a layer weight changes
+void Anim::updateBlendMask()
+{
+    if (m_maskLayers.empty())
+    {
+        std::fill(m_blendMask.begin(), m_blendMask.end(), 1.f);
+        return;
+    }
+
+    std::fill(m_blendMask.begin(), m_blendMask.end(), 0.f);
+    for (int i = 0; i < m_maskLayers.size(); i++)
+    {
+        const BlendMaskLayer &layer = m_maskLayers[i];
+        const std::vector<float> &weights = layer.mask->m_weights;
+
+        for (int j = 0; j < m_blendMask.size(); j++)
+            m_blendMask[j] += weights[j] * layer.weight;
+    }
+
+    for (int i = 0; i < m_blendMask.size(); i++)
+        m_blendMask[i] = std::min(m_blendMask[i], 1.f);
+}
+
+float Anim::getBlendFactor(const std::string &boneName)
+{
+    int nodeIndex = m_skeleton->getNodeIndex(boneName);
+    if (nodeIndex == -1)
+        return 0.f;
+
+    return m_blendMask[nodeIndex];
+}
@@ -4,12 +4,16 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <unordered_map>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <assimp/scene.h>
 
 #include "animation.h"
+#include "blend_mask.h"
+#include "pose_blend.h"
+#include "skeleton.h"
 
 #define MAX_BONES 200
 
@@ -17,14 +21,60 @@ class Anim
 {
 public:
     Anim(Animation *animation);
+    ~Anim();
 
     Animation *m_animation;
+    // copy of the shared clip for edits of this anim only, nullptr while playing the shared one
+    Animation *m_ownedAnimation;
     float m_blendFactor;
     float m_playbackSpeed;
     bool m_timerActive;
     float m_timer;
 
+    // bone of the clip for each skeleton node, nullptr when the clip has no channel for it
+    std::vector<Bone *> m_channels;
+    // blend factor for each skeleton node, sum of the mask layers
+    std::vector<float> m_blendMask;
+    std::vector<BlendMaskLayer> m_maskLayers;
+    // key cursor for each skeleton node
+    std::vector<BoneCursor> m_cursors;
+    const Skeleton *m_skeleton;
+
     void updateTimer(float deltaTime, float startOffset);
+    void bindSkeleton(const Skeleton &skeleton);
+    // clips are shared between animators, this anim plays its own copy from now on
+    void makeClipUnique();
+    // replaces the layers with a single mask
+    void setBlendMask(const BlendMask *mask);
+    int addBlendMaskLayer(const BlendMask *mask, float weight);
+    void setBlendMaskLayerWeight(int layer, float weight);
+    float getBlendFactor(const std::string &boneName);
+
+private:
+    void updateBlendMask();
+};
+
+enum class AnimationLod
+{
+    full,
+    // nodes deeper than the max bone depth keep their last local transform
+    reducedBones,
+    // evaluated every few frames, the pose in between is interpolated
+    reducedRate,
+    // only timers advance
+    offscreen,
+    COUNT
+};
+
+struct AnimationLodSettings
+{
+    bool enabled = true;
+    // projected height over screen height, below this only the reduced bone set is evaluated
+    float reducedBonesScreenSize = 0.15f;
+    int reducedBoneDepth = 7;
+    // distance from the view position, beyond this the pose is evaluated at a reduced rate
+    float reducedRateDistance = 60.f;
+    int reducedRateInterval = 4;
 };
 
 struct AnimatorState
@@ -38,16 +88,57 @@ class Animator
 public:
     std::vector<glm::mat4> m_finalBoneMatrices;
     std::vector<glm::mat4> m_globalMatrices;
+    std::vector<glm::mat4> m_localNodeMatrices;
+    std::vector<glm::mat4> m_globalNodeMatrices;
     std::vector<Animation *> m_animations;
+    Skeleton *m_skeleton;
     AnimatorState m_state;
     float m_startOffset = 0.f;
+    // timers advanced since the last pose evaluation
+    bool m_evaluationPending = false;
+
+    // level of detail, assigned by the render manager every frame
+    AnimationLod m_lod = AnimationLod::full;
+    int m_maxBoneDepth = -1;
+    int m_updateInterval = 1;
+    // -1 when there is no sampled pose to interpolate from
+    int m_framesSinceEvaluation = -1;
+    // blended local pose of each node, only valid where the weight is above zero
+    PoseBuffer m_localPoses;
+    PoseBuffer m_previousLocalPoses;
+
+    // simd nlerp kernels over whole poses, scalar slerp per node otherwise
+    bool m_batchBlending = true;
 
     Animator(std::vector<Animation *> animations);
     ~Animator();
+    // advances timers, the pose is evaluated later in a batch with evaluate
     void update(float deltaTime);
-    void calculateBoneTransform(const AssimpNodeData *node, glm::mat4 parentTransform);
+    void evaluate();
+    void calculateBoneTransforms();
+    void setLod(AnimationLod lod, const AnimationLodSettings &settings);
+    // max final bone matrix difference between the batch and the scalar path for the current state
+    float compareBlending();
     Anim *addStateAnimation(Animation *animation);
     Anim *addPoseAnimation(Animation *animation);
+    // owned by the animator, can be shared by its anims
+    BlendMask *createBlendMask(float defaultValue);
+
+private:
+    std::vector<BlendMask *> m_blendMasks;
+
+    // scratch for the batch path
+    PoseBuffer m_layerPose;
+    std::vector<float> m_layerWeights;
+    PoseBuffer m_interpolatedPoses;
+    std::vector<glm::mat4> m_poseMatrices;
+
+    bool isNodeEvaluated(const SkeletonNode &node);
+    void sampleLocalPoses();
+    void sampleLocalPosesBatch();
+    bool sampleLayer(Anim *anim);
+    void updateMatrices(float factor);
+    void updateMatricesBatch(float factor);
 };
 
 #endif /* animator_hpp */
@@ -0,0 +1,36 @@
+#include <iostream>
+
+#include "blend_mask.h"
+
+BlendMask::BlendMask(const Skeleton &skeleton, float defaultValue)
+    : m_skeleton(&skeleton)
+{
+    m_weights.assign(skeleton.m_nodes.size(), defaultValue);
+}
+
+void BlendMask::set(const std::string &nodeName, float weight)
+{
+    int nodeIndex = m_skeleton->getNodeIndex(nodeName);
+    if (nodeIndex == -1)
+    {
+        std::cout << "BlendMask: node not found: " << nodeName << std::endl;
+        return;
+    }
+
+    m_weights[nodeIndex] = weight;
+}
+
+void BlendMask::set(const std::vector<std::string> &nodeNames, float weight)
+{
+    for (int i = 0; i < nodeNames.size(); i++)
+        set(nodeNames[i], weight);
+}
+
+float BlendMask::get(const std::string &nodeName)
+{
+    int nodeIndex = m_skeleton->getNodeIndex(nodeName);
+    if (nodeIndex == -1)
+        return 0.f;
+
+    return m_weights[nodeIndex];
+}
@@ -0,0 +1,31 @@
+#ifndef blend_mask_hpp
+#define blend_mask_hpp
+
+#include <string>
+#include <vector>
+
+#include "skeleton.h"
+
+// blend weight for each skeleton node
+// built by name once at load, read by node index while blending
+class BlendMask
+{
+public:
+    BlendMask(const Skeleton &skeleton, float defaultValue);
+
+    const Skeleton *m_skeleton;
+    std::vector<float> m_weights;
+
+    void set(const std::string &nodeName, float weight);
+    void set(const std::vector<std::string> &nodeNames, float weight);
+    float get(const std::string &nodeName);
+};
+
+// a shared mask scaled by a per anim weight
+struct BlendMaskLayer
+{
+    const BlendMask *mask;
+    float weight;
+};
+
+#endif /* blend_mask_hpp */
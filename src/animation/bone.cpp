@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <vector>
 
 #include <glm/glm.hpp>
@@ -9,10 +10,7 @@
 
 Bone::Bone(const std::string &name, int ID, const aiNodeAnim *channel)
     : m_name(name),
-      m_ID(ID),
-      m_translation(1.0f),
-      m_rotation(glm::vec3(1.0f)),
-      m_scale(1.0f)
+      m_ID(ID)
 {
     m_numPositions = channel->mNumPositionKeys;
     for (int positionIndex = 0; positionIndex < m_numPositions; ++positionIndex)
@@ -78,79 +76,119 @@ Bone::~Bone()
     // TODO: destruction
 }
 
+// finds the key pair surrounding animationTime, starting from the cursor of the previous sample
+// playback usually advances by less than a key per frame, seeks and wraps fall back to binary search
+template <typename Key>
+static int findKeyIndex(const std::vector<Key> &keys, float animationTime, int &cursor)
+{
+    int lastPair = keys.size() - 2;
+    if (lastPair < 0)
+        return 0;
+
+    if (cursor >= 0 && cursor <= lastPair && keys[cursor].timestamp <= animationTime)
+    {
+        if (animationTime < keys[cursor + 1].timestamp)
+            return cursor;
+
+        if (cursor + 1 <= lastPair && animationTime < keys[cursor + 2].timestamp)
+            return ++cursor;
+    }
+
+    auto it = std::upper_bound(keys.begin(), keys.end(), animationTime,
+                               [](float time, const Key &key) { return time < key.timestamp; });
+
+    // before the first key or past the last key clamps to the edge pair
+    cursor = std::clamp((int)(it - keys.begin()) - 1, 0, lastPair);
+    return cursor;
+}
+
 // TODO: snap to keyframe
-void Bone::update(float animationTime)
+BonePose Bone::sample(float animationTime, BoneCursor &cursor) const
 {
     if (animationTime == 0.f)
-        updatePose();
+        return samplePose();
     else
-        updateCycle(animationTime);
+        return sampleCycle(animationTime, cursor);
 }
 
-void Bone::updatePose()
+BonePose Bone::samplePose() const
 {
-    m_translation = m_positions[0].value;
-    m_rotation = m_rotations[0].value;
-    m_scale = m_scales[0].value;
-}
+    BonePose pose;
+    if (m_compressed)
+    {
+        pose.translation = m_compressedPositions.getKey(0);
+        pose.rotation = m_compressedRotations.getKey(0);
+        pose.scale = m_compressedScales.getKey(0);
+        return pose;
+    }
 
-void Bone::updateCycle(float animationTime)
-{
-    m_translation = interpolatePosition(animationTime);
-    m_rotation = interpolateRotation(animationTime);
-    m_scale = interpolateScaling(animationTime);
+    pose.translation = m_positions[0].value;
+    pose.rotation = m_rotations[0].value;
+    pose.scale = m_scales[0].value;
+    return pose;
 }
 
-int Bone::getPositionIndex(float animationTime)
+BonePose Bone::sampleCycle(float animationTime, BoneCursor &cursor) const
 {
-    for (int index = 0; index < m_numPositions - 1; ++index)
+    BonePose pose;
+    if (m_compressed)
     {
-        if (animationTime < m_positions[index + 1].timestamp)
-            return index;
+        // uniform keys are indexed directly, no cursor needed
+        pose.translation = m_compressedPositions.sample(animationTime);
+        pose.rotation = m_compressedRotations.sample(animationTime);
+        pose.scale = m_compressedScales.sample(animationTime);
+        return pose;
     }
-    assert(0);
+
+    pose.translation = interpolatePosition(animationTime, cursor.position);
+    pose.rotation = interpolateRotation(animationTime, cursor.rotation);
+    pose.scale = interpolateScaling(animationTime, cursor.scale);
+    return pose;
 }
 
-int Bone::getRotationIndex(float animationTime)
+int Bone::getPositionIndex(float animationTime, int &cursor) const
 {
-    for (int index = 0; index < m_numRotations - 1; ++index)
-    {
-        if (animationTime < m_rotations[index + 1].timestamp)
-            return index;
-    }
-    assert(0);
+    return findKeyIndex(m_positions, animationTime, cursor);
 }
 
-int Bone::getScaleIndex(float animationTime)
+int Bone::getRotationIndex(float animationTime, int &cursor) const
 {
-    for (int index = 0; index < m_numScalings - 1; ++index)
-    {
-        if (animationTime < m_scales[index + 1].timestamp)
-            return index;
-    }
-    assert(0);
+    return findKeyIndex(m_rotations, animationTime, cursor);
 }
 
-float Bone::getScaleFactor(float lastTimeStamp, float nextTimeStamp, float animationTime)
+int Bone::getScaleIndex(float animationTime, int &cursor) const
+{
+    return findKeyIndex(m_scales, animationTime, cursor);
+}
+
+float Bone::getScaleFactor(float lastTimeStamp, float nextTimeStamp, float animationTime) const
 {
-    float scaleFactor = 0.0f;
-    float midWayLength = animationTime - lastTimeStamp;
     float framesDiff = nextTimeStamp - lastTimeStamp;
-    scaleFactor = midWayLength / framesDiff;
-    return scaleFactor;
+    if (framesDiff <= 0.0f)
+        return 0.0f;
+
+    float midWayLength = animationTime - lastTimeStamp;
+    float scaleFactor = midWayLength / framesDiff;
+    return std::clamp(scaleFactor, 0.0f, 1.0f);
 }
 
-glm::vec3 Bone::interpolatePosition(float animationTime)
+glm::vec3 Bone::interpolatePosition(float animationTime, int &cursor) const
 {
-    int p0Index = getPositionIndex(animationTime);
+    if (m_numPositions == 1)
+        return m_positions[0].value;
+
+    int p0Index = getPositionIndex(animationTime, cursor);
     int p1Index = p0Index + 1;
     float scaleFactor = getScaleFactor(m_positions[p0Index].timestamp, m_positions[p1Index].timestamp, animationTime);
     return glm::mix(m_positions[p0Index].value, m_positions[p1Index].value, scaleFactor);
 }
 
-glm::quat Bone::interpolateRotation(float animationTime)
+glm::quat Bone::interpolateRotation(float animationTime, int &cursor) const
 {
-    int p0Index = getRotationIndex(animationTime);
+    if (m_numRotations == 1)
+        return glm::normalize(m_rotations[0].value);
+
+    int p0Index = getRotationIndex(animationTime, cursor);
     int p1Index = p0Index + 1;
     float scaleFactor = getScaleFactor(m_rotations[p0Index].timestamp, m_rotations[p1Index].timestamp, animationTime);
     glm::quat finalRotation = glm::slerp(m_rotations[p0Index].value, m_rotations[p1Index].value, scaleFactor);
@@ -158,10 +196,50 @@ glm::quat Bone::interpolateRotation(float animationTime)
     return glm::normalize(finalRotation);
 }
 
-glm::vec3 Bone::interpolateScaling(float animationTime)
+glm::vec3 Bone::interpolateScaling(float animationTime, int &cursor) const
 {
-    int p0Index = getScaleIndex(animationTime);
+    if (m_numScalings == 1)
+        return m_scales[0].value;
+
+    int p0Index = getScaleIndex(animationTime, cursor);
     int p1Index = p0Index + 1;
     float scaleFactor = getScaleFactor(m_scales[p0Index].timestamp, m_scales[p1Index].timestamp, animationTime);
     return glm::mix(m_scales[p0Index].value, m_scales[p1Index].value, scaleFactor);
 }
+
+int Bone::compress(const ClipCompression &settings)
+{
+    if (m_compressed)
+        return 0;
+
+    int rawCount = 0;
+    if (!m_compressedPositions.compress(m_positions, settings.positionTolerance, settings.maxKeyStep))
+        rawCount++;
+    if (!m_compressedRotations.compress(m_rotations, settings.rotationTolerance, settings.maxKeyStep))
+        rawCount++;
+    if (!m_compressedScales.compress(m_scales, settings.scaleTolerance, settings.maxKeyStep))
+        rawCount++;
+
+    std::vector<KeyVec3>().swap(m_positions);
+    std::vector<KeyQuat>().swap(m_rotations);
+    std::vector<KeyVec3>().swap(m_scales);
+
+    m_compressed = true;
+    return rawCount;
+}
+
+size_t Bone::getMemoryUsage() const
+{
+    if (m_compressed)
+    {
+        return sizeof(Bone) +
+               m_compressedPositions.getMemoryUsage() +
+               m_compressedRotations.getMemoryUsage() +
+               m_compressedScales.getMemoryUsage();
+    }
+
+    return sizeof(Bone) +
+           m_positions.size() * sizeof(KeyVec3) +
+           m_rotations.size() * sizeof(KeyQuat) +
+           m_scales.size() * sizeof(KeyVec3);
+}
@@ -2,23 +2,30 @@
 #define bone_hpp
 
 #include <assimp/anim.h>
+#include <string>
 #include <vector>
 
 #include <glm/glm.hpp>
 #include <glm/gtx/quaternion.hpp>
 
-struct KeyVec3
+#include "keyframe.h"
+
+struct BonePose
 {
-    float timestamp;
-    glm::vec3 value;
+    glm::vec3 translation;
+    glm::quat rotation;
+    glm::vec3 scale;
 };
 
-struct KeyQuat
+// last sampled key pair of each track, kept per playing layer
+struct BoneCursor
 {
-    float timestamp;
-    glm::quat value;
+    int position = 0;
+    int rotation = 0;
+    int scale = 0;
 };
 
+// keyframes of a single channel, shared between every animator playing the clip
 class Bone
 {
 public:
@@ -29,29 +36,32 @@ public:
     int m_numRotations;
     int m_numScalings;
 
-    glm::vec3 m_translation;
-    glm::quat m_rotation;
-    glm::vec3 m_scale;
     std::string m_name;
     int m_ID;
 
-    float m_blendFactor = 1.0f;
+    // when compressed the key vectors are released and sampling reads the tracks
+    bool m_compressed = false;
+    CompressedVec3Track m_compressedPositions;
+    CompressedQuatTrack m_compressedRotations;
+    CompressedVec3Track m_compressedScales;
 
     Bone(const std::string &name, int ID, const aiNodeAnim *channel);
     Bone(const std::string &name, int id, const glm::mat4 &localTransform);
 
     ~Bone();
-    void update(float animationTime);
-    void updatePose();
-    void updateCycle(float animationTime);
-    // TODO: single function without polimorphism?
-    int getPositionIndex(float animationTime);
-    int getRotationIndex(float animationTime);
-    int getScaleIndex(float animationTime);
-    float getScaleFactor(float lastTimeStamp, float nextTimeStamp, float animationTime);
-    glm::vec3 interpolatePosition(float animationTime);
-    glm::quat interpolateRotation(float animationTime);
-    glm::vec3 interpolateScaling(float animationTime);
+    BonePose sample(float animationTime, BoneCursor &cursor) const;
+    BonePose samplePose() const;
+    BonePose sampleCycle(float animationTime, BoneCursor &cursor) const;
+    int getPositionIndex(float animationTime, int &cursor) const;
+    int getRotationIndex(float animationTime, int &cursor) const;
+    int getScaleIndex(float animationTime, int &cursor) const;
+    float getScaleFactor(float lastTimeStamp, float nextTimeStamp, float animationTime) const;
+    glm::vec3 interpolatePosition(float animationTime, int &cursor) const;
+    glm::quat interpolateRotation(float animationTime, int &cursor) const;
+    glm::vec3 interpolateScaling(float animationTime, int &cursor) const;
+    // returns the tracks that kept their source keys
+    int compress(const ClipCompression &settings);
+    size_t getMemoryUsage() const;
 };
 
 #endif /* bone_hpp */
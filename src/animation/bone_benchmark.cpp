@@ -0,0 +1,201 @@
+// key search of Bone on the clips of a model, built with ENIGINE_BUILD_BENCHMARKS
+// playback keeps a cursor per track, seeks and loop wraps go through the binary search fallback
+// usage: bone_benchmark [model] [passes]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+
+#include "bone.h"
+
+#define BENCHMARK_FRAME_RATE 60.f
+#define BENCHMARK_DEFAULT_MODEL "assets/character/mixamo-y-1.glb"
+
+struct Clip
+{
+    std::string name;
+    float duration;
+    float ticksPerSecond;
+    std::vector<Bone> bones;
+};
+
+struct SearchResult
+{
+    float time;
+    int searches;
+    // samples the cursor did not cover, found by the binary search
+    int fallbacks;
+    long checksum;
+};
+
+enum class SearchMode
+{
+    // cursors kept between samples, as Anim does
+    cursor,
+    // cursors reset before every sample, always the binary search
+    seek,
+    // the scan from the first key that the cursors replaced
+    linear,
+};
+
+// milliseconds since the first call, small enough to keep float precision
+static float getTime()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Key>
+static int findKeyIndexLinear(const std::vector<Key> &keys, float animationTime)
+{
+    int lastPair = keys.size() - 2;
+    for (int index = 0; index < lastPair; ++index)
+    {
+        if (animationTime < keys[index + 1].timestamp)
+            return index;
+    }
+
+    return lastPair < 0 ? 0 : lastPair;
+}
+
+static int search(const Bone &bone, float time, BoneCursor &cursor, SearchMode mode, int &fallbacks)
+{
+    if (mode == SearchMode::linear)
+    {
+        return findKeyIndexLinear(bone.m_positions, time) +
+               findKeyIndexLinear(bone.m_rotations, time) +
+               findKeyIndexLinear(bone.m_scales, time);
+    }
+
+    if (mode == SearchMode::seek)
+        cursor = BoneCursor{-1, -1, -1};
+
+    BoneCursor previous = cursor;
+    int index = bone.getPositionIndex(time, cursor.position) +
+                bone.getRotationIndex(time, cursor.rotation) +
+                bone.getScaleIndex(time, cursor.scale);
+
+    // the cursor only ever stays or steps to the next pair
+    int step = cursor.rotation - previous.rotation;
+    if (mode == SearchMode::seek || step < 0 || step > 1)
+        fallbacks++;
+
+    return index;
+}
+
+// every track of every clip at each time, a time is a frame of the whole skeleton
+static SearchResult run(std::vector<Clip> &clips, const std::vector<std::vector<float>> &times, SearchMode mode)
+{
+    SearchResult result{0.f, 0, 0, 0};
+
+    float start = getTime();
+    for (int c = 0; c < clips.size(); c++)
+    {
+        std::vector<Bone> &bones = clips[c].bones;
+        std::vector<BoneCursor> cursors(bones.size());
+
+        for (int t = 0; t < times[c].size(); t++)
+        {
+            for (int b = 0; b < bones.size(); b++)
+                result.checksum += search(bones[b], times[c][t], cursors[b], mode, result.fallbacks);
+
+            result.searches += bones.size() * 3;
+        }
+    }
+    result.time = getTime() - start;
+
+    return result;
+}
+
+static void printResult(const char *name, const SearchResult &result, const SearchResult &reference)
+{
+    printf("%s: %.3f ms, %.1f ns per search, binary searches: %.1f%%, %s\n",
+           name, result.time, result.time * 1e6f / result.searches,
+           100.f * result.fallbacks / (result.searches / 3),
+           result.checksum == reference.checksum ? "same keys as linear" : "KEYS DIFFER FROM LINEAR");
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = argc > 1 ? argv[1] : BENCHMARK_DEFAULT_MODEL;
+    int passes = argc > 2 ? atoi(argv[2]) : 100;
+
+    // keys are read as imported, no post processing touches animations
+    Assimp::Importer importer;
+    const aiScene *scene = importer.ReadFile(path, 0);
+    if (!scene || scene->mNumAnimations == 0)
+    {
+        fprintf(stderr, "bone_benchmark: no animations in %s\n", path);
+        return 1;
+    }
+
+    std::vector<Clip> clips;
+    int keyCount = 0;
+    int trackCount = 0;
+    for (int i = 0; i < scene->mNumAnimations; i++)
+    {
+        aiAnimation *animation = scene->mAnimations[i];
+
+        Clip clip;
+        clip.name = animation->mName.C_Str();
+        clip.duration = animation->mDuration;
+        clip.ticksPerSecond = animation->mTicksPerSecond != 0.0 ? animation->mTicksPerSecond : 25.f;
+
+        for (int j = 0; j < animation->mNumChannels; j++)
+        {
+            aiNodeAnim *channel = animation->mChannels[j];
+            clip.bones.push_back(Bone(channel->mNodeName.C_Str(), j, channel));
+            keyCount += channel->mNumPositionKeys + channel->mNumRotationKeys + channel->mNumScalingKeys;
+        }
+
+        trackCount += clip.bones.size() * 3;
+        clips.push_back(clip);
+    }
+
+    // playback times advance a frame at a time and wrap like Anim::updateTimer
+    // random times are seeks, the cursor is kept but rarely covers them
+    std::mt19937 generator(1234u);
+    std::vector<std::vector<float>> playbackTimes(clips.size());
+    std::vector<std::vector<float>> randomTimes(clips.size());
+    for (int c = 0; c < clips.size(); c++)
+    {
+        float step = clips[c].ticksPerSecond / BENCHMARK_FRAME_RATE;
+        int frames = std::max(1, (int)(clips[c].duration / step)) * passes;
+        std::uniform_real_distribution<float> distribution(0.f, clips[c].duration);
+
+        float time = 0.f;
+        for (int f = 0; f < frames; f++)
+        {
+            time = fmod(time + step, clips[c].duration);
+            playbackTimes[c].push_back(time);
+            randomTimes[c].push_back(distribution(generator));
+        }
+    }
+
+    printf("%s: %d clips, %d tracks, %.1f keys per track, %d passes\n",
+           path, (int)clips.size(), trackCount, (float)keyCount / trackCount, passes);
+
+    SearchResult linear = run(clips, playbackTimes, SearchMode::linear);
+    SearchResult cursor = run(clips, playbackTimes, SearchMode::cursor);
+    SearchResult seek = run(clips, playbackTimes, SearchMode::seek);
+    SearchResult randomLinear = run(clips, randomTimes, SearchMode::linear);
+    SearchResult randomCursor = run(clips, randomTimes, SearchMode::cursor);
+
+    printf("playback\n");
+    printResult("  linear", linear, linear);
+    printResult("  cursor", cursor, linear);
+    printResult("  seek", seek, linear);
+    printf("random\n");
+    printResult("  linear", randomLinear, randomLinear);
+    printResult("  cursor", randomCursor, randomLinear);
+
+    return 0;
+}
@@ -0,0 +1,348 @@
+#include <algorithm>
+#include <cmath>
+
+#include "keyframe.h"
+
+static const float quantizeScale16 = 65535.f;
+static const float quantizeScale15 = 32767.f;
+
+static glm::vec3 sampleKeys(const std::vector<KeyVec3> &keys, float time)
+{
+    auto it = std::upper_bound(keys.begin(), keys.end(), time,
+                               [](float t, const KeyVec3 &key) { return t < key.timestamp; });
+    if (it == keys.begin())
+        return keys.front().value;
+    if (it == keys.end())
+        return keys.back().value;
+
+    const KeyVec3 &k0 = *(it - 1);
+    const KeyVec3 &k1 = *it;
+    float factor = (time - k0.timestamp) / (k1.timestamp - k0.timestamp);
+    return glm::mix(k0.value, k1.value, factor);
+}
+
+static glm::quat sampleKeys(const std::vector<KeyQuat> &keys, float time)
+{
+    auto it = std::upper_bound(keys.begin(), keys.end(), time,
+                               [](float t, const KeyQuat &key) { return t < key.timestamp; });
+    if (it == keys.begin())
+        return glm::normalize(keys.front().value);
+    if (it == keys.end())
+        return glm::normalize(keys.back().value);
+
+    const KeyQuat &k0 = *(it - 1);
+    const KeyQuat &k1 = *it;
+    float factor = (time - k0.timestamp) / (k1.timestamp - k0.timestamp);
+    return glm::normalize(glm::slerp(k0.value, k1.value, factor));
+}
+
+static int getUniformIndex(float time, float startTime, float interval, int keyCount, float &factor)
+{
+    float position = (time - startTime) / interval;
+    position = std::clamp(position, 0.f, (float)(keyCount - 1));
+
+    int index = std::min((int)position, keyCount - 2);
+    factor = position - index;
+    return index;
+}
+
+// atan2 keeps precision for small angles where acos of the dot product does not
+static float getAngle(const glm::quat &a, const glm::quat &b)
+{
+    glm::quat diff = a * glm::conjugate(b);
+    return 2.f * std::atan2(glm::length(glm::vec3(diff.x, diff.y, diff.z)), std::fabs(diff.w));
+}
+
+// drops the largest component, its sign is folded into the others
+// the dropped index is kept in the top bits of the first two values
+static void packQuat(const glm::quat &rotation, uint16_t *out)
+{
+    glm::quat q = glm::normalize(rotation);
+    float components[4] = {q.x, q.y, q.z, q.w};
+
+    int largest = 0;
+    for (int i = 1; i < 4; i++)
+    {
+        if (std::fabs(components[i]) > std::fabs(components[largest]))
+            largest = i;
+    }
+
+    float sign = components[largest] < 0.f ? -1.f : 1.f;
+
+    int j = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        if (i == largest)
+            continue;
+
+        // remaining components are in [-1/sqrt(2), 1/sqrt(2)]
+        float normalized = components[i] * sign * (float)M_SQRT2 * 0.5f + 0.5f;
+        normalized = std::clamp(normalized, 0.f, 1.f);
+        out[j++] = (uint16_t)std::round(normalized * quantizeScale15);
+    }
+
+    out[0] |= (uint16_t)((largest & 1) << 15);
+    out[1] |= (uint16_t)((largest >> 1) << 15);
+}
+
+static glm::quat unpackQuat(const uint16_t *in)
+{
+    int largest = (in[0] >> 15) | ((in[1] >> 15) << 1);
+
+    float components[4];
+    float sum = 0.f;
+    int j = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        if (i == largest)
+            continue;
+
+        float normalized = (in[j++] & 0x7fff) / quantizeScale15;
+        components[i] = (normalized * 2.f - 1.f) * (float)M_SQRT1_2;
+        sum += components[i] * components[i];
+    }
+    components[largest] = std::sqrt(std::max(0.f, 1.f - sum));
+
+    return glm::quat(components[3], components[0], components[1], components[2]);
+}
+
+// CompressedVec3Track
+
+CompressedVec3Track::CompressedVec3Track()
+    : m_startTime(0.f),
+      m_interval(0.f),
+      m_keyCount(0),
+      m_min(0.f),
+      m_extent(0.f),
+      m_maxError(0.f)
+{
+}
+
+// constant tracks keep a single key, others drop keys uniformly while the error stays in tolerance
+bool CompressedVec3Track::compress(const std::vector<KeyVec3> &keys, float tolerance, int maxKeyStep)
+{
+    build(keys, 1);
+    m_maxError = measureError(keys);
+
+    int sourceCount = keys.size();
+    if (m_maxError <= tolerance || sourceCount < 2)
+        return true;
+
+    for (int step = std::max(maxKeyStep, 1); step >= 1; step--)
+    {
+        int keyCount = std::max(2, (sourceCount - 1 + step - 1) / step + 1);
+        build(keys, keyCount);
+        m_maxError = measureError(keys);
+
+        if (m_maxError <= tolerance)
+            return true;
+    }
+
+    // even every source key quantized is over tolerance, the clip must not play inaccurately
+    m_values.clear();
+    m_values.shrink_to_fit();
+    m_rawKeys = keys;
+    m_keyCount = sourceCount;
+    m_maxError = 0.f;
+    return false;
+}
+
+void CompressedVec3Track::build(const std::vector<KeyVec3> &keys, int keyCount)
+{
+    m_startTime = keys.front().timestamp;
+    float endTime = keys.back().timestamp;
+
+    m_keyCount = keyCount;
+    m_interval = keyCount > 1 ? (endTime - m_startTime) / (keyCount - 1) : 0.f;
+    if (m_interval <= 0.f)
+        m_keyCount = 1;
+
+    m_extent = glm::vec3(0.f);
+    m_values.clear();
+    m_rawKeys.clear();
+
+    if (m_keyCount == 1)
+    {
+        m_min = keys.front().value;
+        return;
+    }
+
+    std::vector<glm::vec3> values(m_keyCount);
+    for (int i = 0; i < m_keyCount; i++)
+        values[i] = sampleKeys(keys, m_startTime + i * m_interval);
+
+    m_min = values[0];
+    glm::vec3 max = values[0];
+    for (int i = 1; i < m_keyCount; i++)
+    {
+        m_min = glm::min(m_min, values[i]);
+        max = glm::max(max, values[i]);
+    }
+    m_extent = max - m_min;
+
+    m_values.resize(m_keyCount * 3);
+    for (int i = 0; i < m_keyCount; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            float normalized = m_extent[c] > 0.f ? (values[i][c] - m_min[c]) / m_extent[c] : 0.f;
+            m_values[i * 3 + c] = (uint16_t)std::round(normalized * quantizeScale16);
+        }
+    }
+    m_values.shrink_to_fit();
+}
+
+float CompressedVec3Track::measureError(const std::vector<KeyVec3> &keys) const
+{
+    float maxError = 0.f;
+    for (int i = 0; i < keys.size(); i++)
+    {
+        float time = keys[i].timestamp;
+        maxError = std::max(maxError, glm::distance(sample(time), keys[i].value));
+
+        if (i + 1 == keys.size())
+            continue;
+
+        float midTime = (time + keys[i + 1].timestamp) * 0.5f;
+        maxError = std::max(maxError, glm::distance(sample(midTime), sampleKeys(keys, midTime)));
+    }
+
+    return maxError;
+}
+
+glm::vec3 CompressedVec3Track::sample(float time) const
+{
+    if (!m_rawKeys.empty())
+        return sampleKeys(m_rawKeys, time);
+    if (m_keyCount == 1)
+        return m_min;
+
+    float factor;
+    int index = getUniformIndex(time, m_startTime, m_interval, m_keyCount, factor);
+    return glm::mix(getKey(index), getKey(index + 1), factor);
+}
+
+glm::vec3 CompressedVec3Track::getKey(int index) const
+{
+    if (!m_rawKeys.empty())
+        return m_rawKeys[index].value;
+    if (m_keyCount == 1)
+        return m_min;
+
+    const uint16_t *value = &m_values[index * 3];
+    return m_min + glm::vec3(value[0], value[1], value[2]) / quantizeScale16 * m_extent;
+}
+
+size_t CompressedVec3Track::getMemoryUsage() const
+{
+    return m_values.size() * sizeof(uint16_t) + m_rawKeys.size() * sizeof(KeyVec3);
+}
+
+// CompressedQuatTrack
+
+CompressedQuatTrack::CompressedQuatTrack()
+    : m_startTime(0.f),
+      m_interval(0.f),
+      m_keyCount(0),
+      m_constant(1.f, 0.f, 0.f, 0.f),
+      m_maxError(0.f)
+{
+}
+
+bool CompressedQuatTrack::compress(const std::vector<KeyQuat> &keys, float tolerance, int maxKeyStep)
+{
+    build(keys, 1);
+    m_maxError = measureError(keys);
+
+    int sourceCount = keys.size();
+    if (m_maxError <= tolerance || sourceCount < 2)
+        return true;
+
+    for (int step = std::max(maxKeyStep, 1); step >= 1; step--)
+    {
+        int keyCount = std::max(2, (sourceCount - 1 + step - 1) / step + 1);
+        build(keys, keyCount);
+        m_maxError = measureError(keys);
+
+        if (m_maxError <= tolerance)
+            return true;
+    }
+
+    // even every source key quantized is over tolerance, the clip must not play inaccurately
+    m_values.clear();
+    m_values.shrink_to_fit();
+    m_rawKeys = keys;
+    m_keyCount = sourceCount;
+    m_maxError = 0.f;
+    return false;
+}
+
+void CompressedQuatTrack::build(const std::vector<KeyQuat> &keys, int keyCount)
+{
+    m_startTime = keys.front().timestamp;
+    float endTime = keys.back().timestamp;
+
+    m_keyCount = keyCount;
+    m_interval = keyCount > 1 ? (endTime - m_startTime) / (keyCount - 1) : 0.f;
+    if (m_interval <= 0.f)
+        m_keyCount = 1;
+
+    m_values.clear();
+    m_rawKeys.clear();
+
+    if (m_keyCount == 1)
+    {
+        m_constant = glm::normalize(keys.front().value);
+        return;
+    }
+
+    m_values.resize(m_keyCount * 3);
+    for (int i = 0; i < m_keyCount; i++)
+        packQuat(sampleKeys(keys, m_startTime + i * m_interval), &m_values[i * 3]);
+    m_values.shrink_to_fit();
+}
+
+float CompressedQuatTrack::measureError(const std::vector<KeyQuat> &keys) const
+{
+    float maxError = 0.f;
+    for (int i = 0; i < keys.size(); i++)
+    {
+        float time = keys[i].timestamp;
+        maxError = std::max(maxError, getAngle(sample(time), glm::normalize(keys[i].value)));
+
+        if (i + 1 == keys.size())
+            continue;
+
+        float midTime = (time + keys[i + 1].timestamp) * 0.5f;
+        maxError = std::max(maxError, getAngle(sample(midTime), sampleKeys(keys, midTime)));
+    }
+
+    return maxError;
+}
+
+glm::quat CompressedQuatTrack::sample(float time) const
+{
+    if (!m_rawKeys.empty())
+        return sampleKeys(m_rawKeys, time);
+    if (m_keyCount == 1)
+        return m_constant;
+
+    float factor;
+    int index = getUniformIndex(time, m_startTime, m_interval, m_keyCount, factor);
+    return glm::normalize(glm::slerp(getKey(index), getKey(index + 1), factor));
+}
+
+glm::quat CompressedQuatTrack::getKey(int index) const
+{
+    if (!m_rawKeys.empty())
+        return glm::normalize(m_rawKeys[index].value);
+    if (m_keyCount == 1)
+        return m_constant;
+
+    return unpackQuat(&m_values[index * 3]);
+}
+
+size_t CompressedQuatTrack::getMemoryUsage() const
+{
+    return m_values.size() * sizeof(uint16_t) + m_rawKeys.size() * sizeof(KeyQuat);
+}
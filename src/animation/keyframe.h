@@ -0,0 +1,88 @@
+#ifndef keyframe_hpp
+#define keyframe_hpp
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+struct KeyVec3
+{
+    float timestamp;
+    glm::vec3 value;
+};
+
+struct KeyQuat
+{
+    float timestamp;
+    glm::quat value;
+};
+
+struct ClipCompression
+{
+    // maximum allowed error of a track against the source keys
+    float positionTolerance = 0.001f;
+    float rotationTolerance = 0.001f; // radians
+    float scaleTolerance = 0.001f;
+    // upper limit for key reduction, in source key intervals
+    int maxKeyStep = 8;
+};
+
+// uniformly sampled track, 16 bit quantized in the track bounds
+// a constant track keeps a single key and no quantized data
+// a track no key step brings into tolerance keeps its source keys
+class CompressedVec3Track
+{
+public:
+    CompressedVec3Track();
+
+    float m_startTime;
+    float m_interval;
+    int m_keyCount;
+    glm::vec3 m_min;
+    glm::vec3 m_extent;
+    std::vector<uint16_t> m_values;
+    std::vector<KeyVec3> m_rawKeys;
+    float m_maxError;
+
+    // false when the source keys were kept
+    bool compress(const std::vector<KeyVec3> &keys, float tolerance, int maxKeyStep);
+    glm::vec3 sample(float time) const;
+    glm::vec3 getKey(int index) const;
+    // key data in bytes
+    size_t getMemoryUsage() const;
+
+private:
+    void build(const std::vector<KeyVec3> &keys, int keyCount);
+    float measureError(const std::vector<KeyVec3> &keys) const;
+};
+
+// uniformly sampled track, smallest three quantized in 48 bits per key
+// a track no key step brings into tolerance keeps its source keys
+class CompressedQuatTrack
+{
+public:
+    CompressedQuatTrack();
+
+    float m_startTime;
+    float m_interval;
+    int m_keyCount;
+    glm::quat m_constant;
+    std::vector<uint16_t> m_values;
+    std::vector<KeyQuat> m_rawKeys;
+    float m_maxError;
+
+    // false when the source keys were kept
+    bool compress(const std::vector<KeyQuat> &keys, float tolerance, int maxKeyStep);
+    glm::quat sample(float time) const;
+    glm::quat getKey(int index) const;
+    // key data in bytes
+    size_t getMemoryUsage() const;
+
+private:
+    void build(const std::vector<KeyQuat> &keys, int keyCount);
+    float measureError(const std::vector<KeyQuat> &keys) const;
+};
+
+#endif /* keyframe_hpp */
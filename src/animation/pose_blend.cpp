@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <cmath>
+
+#include "pose_blend.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define POSE_BLEND_SSE
+#include <emmintrin.h>
+#endif
+
+// 4 lanes of floats, comparisons return all bits set lanes as masks
+#ifdef POSE_BLEND_SSE
+
+typedef __m128 Lane4;
+
+static inline Lane4 load4(const float *p) { return _mm_loadu_ps(p); }
+static inline void store4(float *p, Lane4 a) { _mm_storeu_ps(p, a); }
+static inline Lane4 set4(float a) { return _mm_set1_ps(a); }
+static inline Lane4 add4(Lane4 a, Lane4 b) { return _mm_add_ps(a, b); }
+static inline Lane4 sub4(Lane4 a, Lane4 b) { return _mm_sub_ps(a, b); }
+static inline Lane4 mul4(Lane4 a, Lane4 b) { return _mm_mul_ps(a, b); }
+static inline Lane4 div4(Lane4 a, Lane4 b) { return _mm_div_ps(a, b); }
+static inline Lane4 sqrt4(Lane4 a) { return _mm_sqrt_ps(a); }
+static inline Lane4 max4(Lane4 a, Lane4 b) { return _mm_max_ps(a, b); }
+static inline Lane4 greater4(Lane4 a, Lane4 b) { return _mm_cmpgt_ps(a, b); }
+static inline Lane4 select4(Lane4 mask, Lane4 a, Lane4 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+// flips the sign of a where the sign bit of b is set
+static inline Lane4 flipSign4(Lane4 a, Lane4 b) { return _mm_xor_ps(a, _mm_and_ps(b, _mm_set1_ps(-0.f))); }
+
+#else
+
+struct Lane4
+{
+    float v[4];
+};
+
+static inline Lane4 load4(const float *p) { return Lane4{{p[0], p[1], p[2], p[3]}}; }
+static inline void store4(float *p, Lane4 a)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = a.v[i];
+}
+static inline Lane4 set4(float a) { return Lane4{{a, a, a, a}}; }
+
+#define LANE4_OP(name, expression)              \
+    static inline Lane4 name(Lane4 a, Lane4 b)  \
+    {                                           \
+        Lane4 r;                                \
+        for (int i = 0; i < 4; i++)             \
+            r.v[i] = expression;                \
+        return r;                               \
+    }
+
+LANE4_OP(add4, a.v[i] + b.v[i])
+LANE4_OP(sub4, a.v[i] - b.v[i])
+LANE4_OP(mul4, a.v[i] * b.v[i])
+LANE4_OP(div4, a.v[i] / b.v[i])
+LANE4_OP(max4, a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+// masks are kept as 0 or 1 in the scalar fallback
+LANE4_OP(greater4, a.v[i] > b.v[i] ? 1.f : 0.f)
+LANE4_OP(flipSign4, std::signbit(b.v[i]) ? -a.v[i] : a.v[i])
+
+#undef LANE4_OP
+
+static inline Lane4 sqrt4(Lane4 a)
+{
+    Lane4 r;
+    for (int i = 0; i < 4; i++)
+        r.v[i] = std::sqrt(a.v[i]);
+    return r;
+}
+
+static inline Lane4 select4(Lane4 mask, Lane4 a, Lane4 b)
+{
+    Lane4 r;
+    for (int i = 0; i < 4; i++)
+        r.v[i] = mask.v[i] != 0.f ? a.v[i] : b.v[i];
+    return r;
+}
+
+#endif
+
+static inline Lane4 mix4(Lane4 a, Lane4 b, Lane4 factor)
+{
+    return add4(a, mul4(sub4(b, a), factor));
+}
+
+// shortest path nlerp without the final normalization
+static inline void nlerp4(Lane4 &x, Lane4 &y, Lane4 &z, Lane4 &w,
+                          Lane4 bx, Lane4 by, Lane4 bz, Lane4 bw, Lane4 factor)
+{
+    Lane4 dot = add4(add4(mul4(x, bx), mul4(y, by)), add4(mul4(z, bz), mul4(w, bw)));
+
+    x = mix4(x, flipSign4(bx, dot), factor);
+    y = mix4(y, flipSign4(by, dot), factor);
+    z = mix4(z, flipSign4(bz, dot), factor);
+    w = mix4(w, flipSign4(bw, dot), factor);
+}
+
+static inline void normalize4(Lane4 &x, Lane4 &y, Lane4 &z, Lane4 &w)
+{
+    Lane4 lengthSquared = add4(add4(mul4(x, x), mul4(y, y)), add4(mul4(z, z), mul4(w, w)));
+    Lane4 length = sqrt4(max4(lengthSquared, set4(1e-12f)));
+
+    x = div4(x, length);
+    y = div4(y, length);
+    z = div4(z, length);
+    w = div4(w, length);
+}
+
+// PoseBuffer
+
+PoseBuffer::PoseBuffer()
+    : m_count(0),
+      m_capacity(0)
+{
+}
+
+void PoseBuffer::resize(int count)
+{
+    m_count = count;
+    m_capacity = (count + 3) & ~3;
+
+    m_tx.assign(m_capacity, 0.f);
+    m_ty.assign(m_capacity, 0.f);
+    m_tz.assign(m_capacity, 0.f);
+    m_rx.assign(m_capacity, 0.f);
+    m_ry.assign(m_capacity, 0.f);
+    m_rz.assign(m_capacity, 0.f);
+    m_rw.assign(m_capacity, 1.f);
+    m_sx.assign(m_capacity, 1.f);
+    m_sy.assign(m_capacity, 1.f);
+    m_sz.assign(m_capacity, 1.f);
+    m_weights.assign(m_capacity, 0.f);
+}
+
+void PoseBuffer::resetWeights()
+{
+    std::fill(m_weights.begin(), m_weights.end(), 0.f);
+}
+
+void PoseBuffer::set(int index, const BonePose &pose)
+{
+    m_tx[index] = pose.translation.x;
+    m_ty[index] = pose.translation.y;
+    m_tz[index] = pose.translation.z;
+    m_rx[index] = pose.rotation.x;
+    m_ry[index] = pose.rotation.y;
+    m_rz[index] = pose.rotation.z;
+    m_rw[index] = pose.rotation.w;
+    m_sx[index] = pose.scale.x;
+    m_sy[index] = pose.scale.y;
+    m_sz[index] = pose.scale.z;
+}
+
+BonePose PoseBuffer::get(int index) const
+{
+    BonePose pose;
+    pose.translation = glm::vec3(m_tx[index], m_ty[index], m_tz[index]);
+    pose.rotation = glm::quat(m_rw[index], m_rx[index], m_ry[index], m_rz[index]);
+    pose.scale = glm::vec3(m_sx[index], m_sy[index], m_sz[index]);
+    return pose;
+}
+
+// PoseBlend
+
+void PoseBlend::accumulate(PoseBuffer &pose, const PoseBuffer &layer, const float *weights)
+{
+    Lane4 zero = set4(0.f);
+
+    for (int i = 0; i < pose.m_capacity; i += 4)
+    {
+        Lane4 weight = load4(weights + i);
+        Lane4 previousTotal = load4(&pose.m_weights[i]);
+        Lane4 total = add4(previousTotal, weight);
+
+        // weight over the running total, zero weight lanes stay untouched
+        Lane4 factor = select4(greater4(weight, zero), div4(weight, max4(total, set4(1e-12f))), zero);
+        Lane4 first = greater4(factor, zero);
+        first = select4(greater4(previousTotal, zero), zero, first);
+        factor = select4(first, set4(1.f), factor);
+
+        store4(&pose.m_tx[i], select4(first, load4(&layer.m_tx[i]), mix4(load4(&pose.m_tx[i]), load4(&layer.m_tx[i]), factor)));
+        store4(&pose.m_ty[i], select4(first, load4(&layer.m_ty[i]), mix4(load4(&pose.m_ty[i]), load4(&layer.m_ty[i]), factor)));
+        store4(&pose.m_tz[i], select4(first, load4(&layer.m_tz[i]), mix4(load4(&pose.m_tz[i]), load4(&layer.m_tz[i]), factor)));
+        store4(&pose.m_sx[i], select4(first, load4(&layer.m_sx[i]), mix4(load4(&pose.m_sx[i]), load4(&layer.m_sx[i]), factor)));
+        store4(&pose.m_sy[i], select4(first, load4(&layer.m_sy[i]), mix4(load4(&pose.m_sy[i]), load4(&layer.m_sy[i]), factor)));
+        store4(&pose.m_sz[i], select4(first, load4(&layer.m_sz[i]), mix4(load4(&pose.m_sz[i]), load4(&layer.m_sz[i]), factor)));
+
+        Lane4 x = load4(&pose.m_rx[i]);
+        Lane4 y = load4(&pose.m_ry[i]);
+        Lane4 z = load4(&pose.m_rz[i]);
+        Lane4 w = load4(&pose.m_rw[i]);
+        Lane4 bx = load4(&layer.m_rx[i]);
+        Lane4 by = load4(&layer.m_ry[i]);
+        Lane4 bz = load4(&layer.m_rz[i]);
+        Lane4 bw = load4(&layer.m_rw[i]);
+        nlerp4(x, y, z, w, bx, by, bz, bw, factor);
+
+        store4(&pose.m_rx[i], select4(first, bx, x));
+        store4(&pose.m_ry[i], select4(first, by, y));
+        store4(&pose.m_rz[i], select4(first, bz, z));
+        store4(&pose.m_rw[i], select4(first, bw, w));
+
+        store4(&pose.m_weights[i], total);
+    }
+}
+
+void PoseBlend::overlay(PoseBuffer &pose, const PoseBuffer &layer, const float *weights)
+{
+    Lane4 zero = set4(0.f);
+
+    for (int i = 0; i < pose.m_capacity; i += 4)
+    {
+        Lane4 driven = greater4(load4(&pose.m_weights[i]), zero);
+        Lane4 factor = select4(driven, load4(weights + i), zero);
+
+        store4(&pose.m_tx[i], mix4(load4(&pose.m_tx[i]), load4(&layer.m_tx[i]), factor));
+        store4(&pose.m_ty[i], mix4(load4(&pose.m_ty[i]), load4(&layer.m_ty[i]), factor));
+        store4(&pose.m_tz[i], mix4(load4(&pose.m_tz[i]), load4(&layer.m_tz[i]), factor));
+        store4(&pose.m_sx[i], mix4(load4(&pose.m_sx[i]), load4(&layer.m_sx[i]), factor));
+        store4(&pose.m_sy[i], mix4(load4(&pose.m_sy[i]), load4(&layer.m_sy[i]), factor));
+        store4(&pose.m_sz[i], mix4(load4(&pose.m_sz[i]), load4(&layer.m_sz[i]), factor));
+
+        Lane4 x = load4(&pose.m_rx[i]);
+        Lane4 y = load4(&pose.m_ry[i]);
+        Lane4 z = load4(&pose.m_rz[i]);
+        Lane4 w = load4(&pose.m_rw[i]);
+        nlerp4(x, y, z, w, load4(&layer.m_rx[i]), load4(&layer.m_ry[i]), load4(&layer.m_rz[i]), load4(&layer.m_rw[i]), factor);
+
+        store4(&pose.m_rx[i], x);
+        store4(&pose.m_ry[i], y);
+        store4(&pose.m_rz[i], z);
+        store4(&pose.m_rw[i], w);
+    }
+}
+
+void PoseBlend::normalizeRotations(PoseBuffer &pose)
+{
+    for (int i = 0; i < pose.m_capacity; i += 4)
+    {
+        Lane4 x = load4(&pose.m_rx[i]);
+        Lane4 y = load4(&pose.m_ry[i]);
+        Lane4 z = load4(&pose.m_rz[i]);
+        Lane4 w = load4(&pose.m_rw[i]);
+        normalize4(x, y, z, w);
+
+        store4(&pose.m_rx[i], x);
+        store4(&pose.m_ry[i], y);
+        store4(&pose.m_rz[i], z);
+        store4(&pose.m_rw[i], w);
+    }
+}
+
+void PoseBlend::interpolate(PoseBuffer &out, const PoseBuffer &previous, const PoseBuffer &current, float factor)
+{
+    if (out.m_capacity != current.m_capacity)
+        out.resize(current.m_count);
+
+    Lane4 f = set4(factor);
+
+    for (int i = 0; i < current.m_capacity; i += 4)
+    {
+        store4(&out.m_tx[i], mix4(load4(&previous.m_tx[i]), load4(&current.m_tx[i]), f));
+        store4(&out.m_ty[i], mix4(load4(&previous.m_ty[i]), load4(&current.m_ty[i]), f));
+        store4(&out.m_tz[i], mix4(load4(&previous.m_tz[i]), load4(&current.m_tz[i]), f));
+        store4(&out.m_sx[i], mix4(load4(&previous.m_sx[i]), load4(&current.m_sx[i]), f));
+        store4(&out.m_sy[i], mix4(load4(&previous.m_sy[i]), load4(&current.m_sy[i]), f));
+        store4(&out.m_sz[i], mix4(load4(&previous.m_sz[i]), load4(&current.m_sz[i]), f));
+
+        Lane4 x = load4(&previous.m_rx[i]);
+        Lane4 y = load4(&previous.m_ry[i]);
+        Lane4 z = load4(&previous.m_rz[i]);
+        Lane4 w = load4(&previous.m_rw[i]);
+        nlerp4(x, y, z, w, load4(&current.m_rx[i]), load4(&current.m_ry[i]), load4(&current.m_rz[i]), load4(&current.m_rw[i]), f);
+        normalize4(x, y, z, w);
+
+        store4(&out.m_rx[i], x);
+        store4(&out.m_ry[i], y);
+        store4(&out.m_rz[i], z);
+        store4(&out.m_rw[i], w);
+
+        store4(&out.m_weights[i], load4(&current.m_weights[i]));
+    }
+}
+
+void PoseBlend::compose(const PoseBuffer &pose, glm::mat4 *matrices)
+{
+    Lane4 zero = set4(0.f);
+    Lane4 one = set4(1.f);
+    Lane4 two = set4(2.f);
+
+    for (int i = 0; i < pose.m_capacity; i += 4)
+    {
+        Lane4 x = load4(&pose.m_rx[i]);
+        Lane4 y = load4(&pose.m_ry[i]);
+        Lane4 z = load4(&pose.m_rz[i]);
+        Lane4 w = load4(&pose.m_rw[i]);
+        Lane4 sx = load4(&pose.m_sx[i]);
+        Lane4 sy = load4(&pose.m_sy[i]);
+        Lane4 sz = load4(&pose.m_sz[i]);
+
+        Lane4 xx = mul4(x, x), yy = mul4(y, y), zz = mul4(z, z);
+        Lane4 xy = mul4(x, y), xz = mul4(x, z), yz = mul4(y, z);
+        Lane4 wx = mul4(w, x), wy = mul4(w, y), wz = mul4(w, z);
+
+        // columns of glm::toMat4, scaled per axis
+        Lane4 columns[4][4] = {
+            {mul4(sub4(one, mul4(two, add4(yy, zz))), sx), mul4(mul4(two, add4(xy, wz)), sx), mul4(mul4(two, sub4(xz, wy)), sx), zero},
+            {mul4(mul4(two, sub4(xy, wz)), sy), mul4(sub4(one, mul4(two, add4(xx, zz))), sy), mul4(mul4(two, add4(yz, wx)), sy), zero},
+            {mul4(mul4(two, add4(xz, wy)), sz), mul4(mul4(two, sub4(yz, wx)), sz), mul4(sub4(one, mul4(two, add4(xx, yy))), sz), zero},
+            {load4(&pose.m_tx[i]), load4(&pose.m_ty[i]), load4(&pose.m_tz[i]), one},
+        };
+
+        // lanes to matrices
+        for (int c = 0; c < 4; c++)
+        {
+#ifdef POSE_BLEND_SSE
+            Lane4 r0 = columns[c][0], r1 = columns[c][1], r2 = columns[c][2], r3 = columns[c][3];
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            store4(&matrices[i + 0][c][0], r0);
+            store4(&matrices[i + 1][c][0], r1);
+            store4(&matrices[i + 2][c][0], r2);
+            store4(&matrices[i + 3][c][0], r3);
+#else
+            for (int lane = 0; lane < 4; lane++)
+            {
+                for (int r = 0; r < 4; r++)
+                    matrices[i + lane][c][r] = columns[c][r].v[lane];
+            }
+#endif
+        }
+    }
+}
+
+void PoseBlend::multiply(const glm::mat4 &a, const glm::mat4 &b, glm::mat4 &out)
+{
+#ifdef POSE_BLEND_SSE
+    __m128 a0 = _mm_loadu_ps(&a[0][0]);
+    __m128 a1 = _mm_loadu_ps(&a[1][0]);
+    __m128 a2 = _mm_loadu_ps(&a[2][0]);
+    __m128 a3 = _mm_loadu_ps(&a[3][0]);
+
+    // out may alias a or b, columns of b are read before the matching store
+    for (int c = 0; c < 4; c++)
+    {
+        __m128 column = _mm_mul_ps(a0, _mm_set1_ps(b[c][0]));
+        column = _mm_add_ps(column, _mm_mul_ps(a1, _mm_set1_ps(b[c][1])));
+        column = _mm_add_ps(column, _mm_mul_ps(a2, _mm_set1_ps(b[c][2])));
+        column = _mm_add_ps(column, _mm_mul_ps(a3, _mm_set1_ps(b[c][3])));
+        _mm_storeu_ps(&out[c][0], column);
+    }
+#else
+    out = a * b;
+#endif
+}
@@ -0,0 +1,49 @@
+#ifndef pose_blend_hpp
+#define pose_blend_hpp
+
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include "bone.h"
+
+// local poses of skeleton nodes as structure of arrays
+// sizes are padded to a multiple of 4 nodes, padding lanes keep a zero weight
+class PoseBuffer
+{
+public:
+    PoseBuffer();
+
+    int m_count;
+    int m_capacity;
+    std::vector<float> m_tx, m_ty, m_tz;
+    std::vector<float> m_rx, m_ry, m_rz, m_rw;
+    std::vector<float> m_sx, m_sy, m_sz;
+    // accumulated blend weight, zero when nothing drives the node
+    std::vector<float> m_weights;
+
+    void resize(int count);
+    void resetWeights();
+    void set(int index, const BonePose &pose);
+    BonePose get(int index) const;
+};
+
+// data parallel kernels over whole poses, sse when available and a 4 wide scalar loop otherwise
+// rotations are blended with nlerp, slerp is left to the scalar path in Animator
+class PoseBlend
+{
+public:
+    // normalized blend of a state layer, the first layer on a node is copied
+    static void accumulate(PoseBuffer &pose, const PoseBuffer &layer, const float *weights);
+    // weighted override by a pose layer, only on nodes already driven by a state layer
+    static void overlay(PoseBuffer &pose, const PoseBuffer &layer, const float *weights);
+    static void normalizeRotations(PoseBuffer &pose);
+    // blends previous to current by factor into out, weights are taken from current
+    static void interpolate(PoseBuffer &out, const PoseBuffer &previous, const PoseBuffer &current, float factor);
+    // translate * rotate * scale for every lane, matrices has room for m_capacity entries
+    static void compose(const PoseBuffer &pose, glm::mat4 *matrices);
+    static void multiply(const glm::mat4 &a, const glm::mat4 &b, glm::mat4 &out);
+};
+
+#endif /* pose_blend_hpp */
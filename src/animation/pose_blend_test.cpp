@@ -0,0 +1,289 @@
+// batch kernels of PoseBlend against the scalar blending of Animator, built with ENIGINE_BUILD_TESTS
+// exits with 1 when a kernel leaves the tolerance
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include "pose_blend.h"
+
+// not a multiple of 4, the last lanes are padding
+#define TEST_NODE_COUNT 67
+#define TEST_STATE_LAYERS 3
+#define TEST_POSE_LAYERS 2
+#define TEST_ITERATIONS 200
+// exact kernels against glm
+#define TEST_EXACT_TOLERANCE 1e-5f
+// nlerp against slerp, same as the default of the system monitor
+#define TEST_BLEND_TOLERANCE 0.01f
+// layers of a blend stay within this angle of each other, as clips of a blend tree do
+#define TEST_MAX_ANGLE 0.8f
+// movement of the skeleton between two blends
+#define TEST_MAX_DRIFT 0.4f
+
+struct Layer
+{
+    std::vector<BonePose> poses;
+    std::vector<float> weights;
+};
+
+static std::mt19937 generator(1234u);
+
+static float getRandom(float min, float max)
+{
+    return std::uniform_real_distribution<float>(min, max)(generator);
+}
+
+static glm::vec3 getRandomVec3(float min, float max)
+{
+    return glm::vec3(getRandom(min, max), getRandom(min, max), getRandom(min, max));
+}
+
+static glm::quat getRandomRotation(float maxAngle)
+{
+    glm::vec3 axis = glm::normalize(getRandomVec3(-1.f, 1.f));
+    return glm::angleAxis(getRandom(-maxAngle, maxAngle), axis);
+}
+
+// poses around a base, quaternion signs are flipped at random to exercise the shortest path
+static Layer getRandomLayer(const std::vector<glm::quat> &base)
+{
+    Layer layer;
+    for (int i = 0; i < TEST_NODE_COUNT; i++)
+    {
+        glm::quat rotation = getRandomRotation(TEST_MAX_ANGLE * 0.5f) * base[i];
+        if (getRandom(0.f, 1.f) < 0.5f)
+            rotation = -rotation;
+
+        layer.poses.push_back(BonePose{getRandomVec3(-2.f, 2.f), rotation, getRandomVec3(0.5f, 1.5f)});
+        layer.weights.push_back(getRandom(0.f, 1.f) < 0.2f ? 0.f : getRandom(0.f, 1.f));
+    }
+
+    return layer;
+}
+
+static void setLayer(PoseBuffer &pose, std::vector<float> &weights, const Layer &layer)
+{
+    for (int i = 0; i < TEST_NODE_COUNT; i++)
+    {
+        pose.set(i, layer.poses[i]);
+        weights[i] = layer.weights[i];
+    }
+}
+
+static glm::mat4 getMatrix(const BonePose &pose)
+{
+    return glm::translate(glm::mat4(1), pose.translation) *
+           glm::toMat4(pose.rotation) *
+           glm::scale(glm::mat4(1), pose.scale);
+}
+
+static float getError(const glm::mat4 &a, const glm::mat4 &b)
+{
+    float error = 0.f;
+    for (int c = 0; c < 4; c++)
+    {
+        glm::vec4 difference = glm::abs(a[c] - b[c]);
+        error = std::max(error, std::max(std::max(difference.x, difference.y), std::max(difference.z, difference.w)));
+    }
+
+    return error;
+}
+
+static bool check(const char *name, float error, float tolerance)
+{
+    bool pass = error <= tolerance;
+    printf("%s: %s, max error: %.6f\n", name, pass ? "pass" : "fail", error);
+    return pass;
+}
+
+// Animator::sampleLocalPoses for a single node
+static bool blendScalar(const std::vector<Layer> &states, const std::vector<Layer> &poses, int node, BonePose &blended, float &totalWeight)
+{
+    bool boneProcessed = false;
+    totalWeight = 0.f;
+    for (int i = 0; i < states.size(); i++)
+    {
+        float blendWeight = states[i].weights[node];
+        if (blendWeight == 0.0f)
+            continue;
+
+        const BonePose &pose = states[i].poses[node];
+        totalWeight += blendWeight;
+
+        if (!boneProcessed)
+        {
+            blended = pose;
+        }
+        else
+        {
+            float weight = blendWeight / totalWeight;
+            blended.translation = glm::mix(blended.translation, pose.translation, weight);
+            blended.rotation = glm::slerp(blended.rotation, pose.rotation, weight);
+            blended.scale = glm::mix(blended.scale, pose.scale, weight);
+        }
+
+        boneProcessed = true;
+    }
+
+    if (!boneProcessed)
+        return false;
+
+    for (int i = 0; i < poses.size(); i++)
+    {
+        float blendWeight = poses[i].weights[node];
+        if (blendWeight == 0.0f)
+            continue;
+
+        const BonePose &pose = poses[i].poses[node];
+        blended.translation = glm::mix(blended.translation, pose.translation, blendWeight);
+        blended.rotation = glm::slerp(blended.rotation, pose.rotation, blendWeight);
+        blended.scale = glm::mix(blended.scale, pose.scale, blendWeight);
+    }
+
+    blended.rotation = glm::normalize(blended.rotation);
+    return true;
+}
+
+// accumulate and overlay of random layers, then interpolate from the previous blend
+static bool testBlend(std::vector<glm::quat> &base, PoseBuffer &previous, std::vector<BonePose> &previousScalar,
+                      float &blendError, float &interpolateError, float &composeError)
+{
+    for (int i = 0; i < TEST_NODE_COUNT; i++)
+        base[i] = getRandomRotation(TEST_MAX_DRIFT) * base[i];
+
+    std::vector<Layer> states;
+    std::vector<Layer> poses;
+    for (int i = 0; i < TEST_STATE_LAYERS; i++)
+        states.push_back(getRandomLayer(base));
+    for (int i = 0; i < TEST_POSE_LAYERS; i++)
+        poses.push_back(getRandomLayer(base));
+
+    PoseBuffer pose;
+    PoseBuffer layer;
+    pose.resize(TEST_NODE_COUNT);
+    layer.resize(TEST_NODE_COUNT);
+    std::vector<float> weights(layer.m_capacity, 0.f);
+
+    for (int i = 0; i < states.size(); i++)
+    {
+        setLayer(layer, weights, states[i]);
+        PoseBlend::accumulate(pose, layer, weights.data());
+    }
+    for (int i = 0; i < poses.size(); i++)
+    {
+        setLayer(layer, weights, poses[i]);
+        PoseBlend::overlay(pose, layer, weights.data());
+    }
+    PoseBlend::normalizeRotations(pose);
+
+    std::vector<glm::mat4> matrices(pose.m_capacity);
+    PoseBlend::compose(pose, matrices.data());
+
+    std::vector<BonePose> scalar(TEST_NODE_COUNT);
+    bool valid = true;
+    for (int i = 0; i < TEST_NODE_COUNT; i++)
+    {
+        float totalWeight;
+        bool driven = blendScalar(states, poses, i, scalar[i], totalWeight);
+
+        if (!driven)
+        {
+            // undriven nodes keep the bind pose in the animator, only the weight is checked
+            scalar[i] = pose.get(i);
+            valid &= pose.m_weights[i] == 0.f;
+            continue;
+        }
+
+        valid &= std::abs(pose.m_weights[i] - totalWeight) <= TEST_EXACT_TOLERANCE;
+        blendError = std::max(blendError, getError(matrices[i], getMatrix(scalar[i])));
+        composeError = std::max(composeError, getError(matrices[i], getMatrix(pose.get(i))));
+    }
+
+    // padding lanes are never driven
+    for (int i = TEST_NODE_COUNT; i < pose.m_capacity; i++)
+        valid &= pose.m_weights[i] == 0.f;
+
+    // Animator::updateMatrices between two evaluations of a reduced rate animator
+    if (previous.m_count != 0)
+    {
+        float factor = getRandom(0.f, 1.f);
+        PoseBuffer interpolated;
+        PoseBlend::interpolate(interpolated, previous, pose, factor);
+        PoseBlend::compose(interpolated, matrices.data());
+
+        for (int i = 0; i < TEST_NODE_COUNT; i++)
+        {
+            valid &= interpolated.m_weights[i] == pose.m_weights[i];
+
+            // nodes without weight on either side start from a stale pose on both paths
+            if (previous.m_weights[i] == 0.f || pose.m_weights[i] == 0.f)
+                continue;
+
+            BonePose expected;
+            expected.translation = glm::mix(previousScalar[i].translation, scalar[i].translation, factor);
+            expected.rotation = glm::normalize(glm::slerp(previousScalar[i].rotation, scalar[i].rotation, factor));
+            expected.scale = glm::mix(previousScalar[i].scale, scalar[i].scale, factor);
+
+            interpolateError = std::max(interpolateError, getError(matrices[i], getMatrix(expected)));
+        }
+    }
+
+    previous = pose;
+    previousScalar = scalar;
+
+    return valid;
+}
+
+static float testMultiply()
+{
+    float error = 0.f;
+    for (int i = 0; i < TEST_ITERATIONS; i++)
+    {
+        glm::mat4 a = getMatrix(BonePose{getRandomVec3(-2.f, 2.f), getRandomRotation(3.14159265f), getRandomVec3(0.5f, 1.5f)});
+        glm::mat4 b = getMatrix(BonePose{getRandomVec3(-2.f, 2.f), getRandomRotation(3.14159265f), getRandomVec3(0.5f, 1.5f)});
+        glm::mat4 expected = a * b;
+
+        glm::mat4 out;
+        PoseBlend::multiply(a, b, out);
+        error = std::max(error, getError(out, expected));
+
+        // out aliases a, as in the global matrix pass
+        PoseBlend::multiply(a, b, a);
+        error = std::max(error, getError(a, expected));
+    }
+
+    return error;
+}
+
+int main()
+{
+    std::vector<glm::quat> base;
+    for (int i = 0; i < TEST_NODE_COUNT; i++)
+        base.push_back(getRandomRotation(3.14159265f));
+
+    PoseBuffer previous;
+    std::vector<BonePose> previousScalar;
+    float blendError = 0.f;
+    float interpolateError = 0.f;
+    float composeError = 0.f;
+    bool weights = true;
+
+    for (int i = 0; i < TEST_ITERATIONS; i++)
+        weights &= testBlend(base, previous, previousScalar, blendError, interpolateError, composeError);
+
+    bool pass = true;
+    pass &= check("weights", weights ? 0.f : 1.f, 0.f);
+    pass &= check("compose", composeError, TEST_EXACT_TOLERANCE);
+    pass &= check("multiply", testMultiply(), TEST_EXACT_TOLERANCE);
+    pass &= check("accumulate and overlay", blendError, TEST_BLEND_TOLERANCE);
+    pass &= check("interpolate", interpolateError, TEST_BLEND_TOLERANCE);
+
+    return pass ? 0 : 1;
+}
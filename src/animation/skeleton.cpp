@@ -0,0 +1,53 @@
+#include <algorithm>
+
+#include "skeleton.h"
+#include "animation.h"
+
+Skeleton::Skeleton(const AssimpNodeData *rootNode, const std::map<std::string, BoneInfo> &boneInfoMap)
+    : m_boneCount(0)
+{
+    flatten(rootNode, -1, boneInfoMap);
+}
+
+// depth first pre-order keeps the parent index lower than the child index
+void Skeleton::flatten(const AssimpNodeData *node, int parent, const std::map<std::string, BoneInfo> &boneInfoMap)
+{
+    int index = m_nodes.size();
+
+    SkeletonNode skeletonNode;
+    skeletonNode.name = node->name;
+    skeletonNode.parent = parent;
+    skeletonNode.transformation = node->transformation;
+    skeletonNode.boneIndex = -1;
+    skeletonNode.offset = glm::mat4(1.f);
+    skeletonNode.boneDepth = 0;
+
+    if (parent != -1)
+    {
+        const SkeletonNode &parentNode = m_nodes[parent];
+        skeletonNode.boneDepth = parentNode.boneDepth + (parentNode.boneIndex != -1 ? 1 : 0);
+    }
+
+    auto it = boneInfoMap.find(node->name);
+    if (it != boneInfoMap.end())
+    {
+        skeletonNode.boneIndex = it->second.id;
+        skeletonNode.offset = it->second.offset;
+        m_boneCount = std::max(m_boneCount, it->second.id + 1);
+    }
+
+    m_nodes.push_back(skeletonNode);
+    m_nodeIndices[node->name] = index;
+
+    for (int i = 0; i < node->children.size(); i++)
+        flatten(node->children[i], index, boneInfoMap);
+}
+
+int Skeleton::getNodeIndex(const std::string &name) const
+{
+    auto it = m_nodeIndices.find(name);
+    if (it == m_nodeIndices.end())
+        return -1;
+
+    return it->second;
+}
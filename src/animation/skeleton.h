@@ -0,0 +1,45 @@
+#ifndef skeleton_hpp
+#define skeleton_hpp
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "../model/model.h"
+
+struct AssimpNodeData;
+
+struct SkeletonNode
+{
+    std::string name;
+    // index of the parent node, -1 for the root
+    int parent;
+    // bind pose local transform, used when no clip drives the node
+    glm::mat4 transformation;
+    // index in finalBoneMatrices, -1 when the node is not a bone
+    int boneIndex;
+    glm::mat4 offset;
+    // number of bone ancestors, fingers and other extremities sit deepest
+    int boneDepth;
+};
+
+// flattened node hierarchy, parents always come before their children
+class Skeleton
+{
+public:
+    Skeleton(const AssimpNodeData *rootNode, const std::map<std::string, BoneInfo> &boneInfoMap);
+
+    std::vector<SkeletonNode> m_nodes;
+    std::unordered_map<std::string, int> m_nodeIndices;
+    int m_boneCount;
+
+    int getNodeIndex(const std::string &name) const;
+
+private:
+    void flatten(const AssimpNodeData *node, int parent, const std::map<std::string, BoneInfo> &boneInfoMap);
+};
+
+#endif /* skeleton_hpp */
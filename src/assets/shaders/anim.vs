@@ -3,14 +3,17 @@
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aNormal;
 layout(location = 2) in vec2 aTexCoords;
-layout(location = 3) in vec3 aTangent;
-layout(location = 4) in vec3 aBitangent;
+// w is the bitangent sign, 1 when the layout has no sign
+layout(location = 3) in vec4 aTangent;
 layout(location = 5) in ivec4 aBoneIds;
 layout(location = 6) in vec4 aWeights;
 
 const int MAX_BONES = 200;
 const int MAX_BONE_PER_VERTEX = 4;
-uniform mat4 finalBonesMatrices[MAX_BONES];
+// bone matrices of all visible skeletons, 4 texels per matrix
+uniform samplerBuffer u_bonePalette;
+// first matrix of this skeleton in the palette
+uniform int u_boneOffset;
 
 out vec2 TexCoords;
 out vec3 WorldPos;
@@ -29,26 +32,35 @@ uniform mat4 view;
 uniform mat4 model;
 uniform mat4 u_meshOffset;
 
+mat4 getBoneMatrix(int boneId)
+{
+    int texel = (u_boneOffset + boneId) * 4;
+    return mat4(texelFetch(u_bonePalette, texel),
+                texelFetch(u_bonePalette, texel + 1),
+                texelFetch(u_bonePalette, texel + 2),
+                texelFetch(u_bonePalette, texel + 3));
+}
+
 void main()
 {
     vec4 totalPosition = vec4(0);
     vec3 localNormal = vec3(0);
     vec3 localTangent = vec3(0);
-    vec3 localBitangent = vec3(0);
     for(int i = 0; i < MAX_BONE_PER_VERTEX; i++)
     {
-        if(aBoneIds[i] == -1) 
+        // packed layouts mark unused influences with a zero weight
+        if(aBoneIds[i] == -1 || aWeights[i] == 0.0)
             continue;
         if(aBoneIds[i] >= MAX_BONES) 
         {
             totalPosition = vec4(aPos, 1);
             break;
         }
-        vec4 localPosition = finalBonesMatrices[aBoneIds[i]] * vec4(aPos, 1);
+        mat4 boneMatrix = getBoneMatrix(aBoneIds[i]);
+        vec4 localPosition = boneMatrix * vec4(aPos, 1);
         totalPosition += localPosition * aWeights[i];
-        localNormal += mat3(finalBonesMatrices[aBoneIds[i]]) * aNormal;
-        localTangent += mat3(finalBonesMatrices[aBoneIds[i]]) * aTangent;
-        localBitangent += mat3(finalBonesMatrices[aBoneIds[i]]) * aBitangent;
+        localNormal += mat3(boneMatrix) * aNormal;
+        localTangent += mat3(boneMatrix) * aTangent.xyz;
     }
 
     TexCoords = aTexCoords;
@@ -63,13 +75,13 @@ void main()
     mat3 normalMatrix = transpose(inverse(mat3(TransformedModel)));
     Normal = normalize(normalMatrix * localNormal);
     Tangent = normalize(normalMatrix * localTangent);
-    Bitangent = cross(Normal, Tangent);
+    Bitangent = cross(Normal, Tangent) * aTangent.w;
 
     // view space normals
     mat3 viewNormalMatrix = transpose(inverse(mat3(view * TransformedModel)));
     ViewNormal = normalize(viewNormalMatrix * localNormal);
 
     vec3 viewT = normalize(viewNormalMatrix * localTangent);
-    vec3 viewB = cross(ViewNormal, viewT);
+    vec3 viewB = cross(ViewNormal, viewT) * aTangent.w;
     ViewTBN = mat3(viewT, viewB, ViewNormal);
 }
\ No newline at end of file
@@ -4,8 +4,8 @@
 layout (location = 0) in vec3 vertexPosition_modelspace;
 layout (location = 1) in vec3 vertexNormal_modelspace;
 layout (location = 2) in vec2 vertexUV;
-layout (location = 3) in vec3 vertexTangent_modelspace;
-layout (location = 4) in vec3 vertexBitangent_modelspace;
+// w is the bitangent sign, 1 when the layout has no sign
+layout (location = 3) in vec4 vertexTangent_modelspace;
 
 // Output data, will be interpolated for each fragment.
 out vec2 UV;
@@ -44,8 +44,10 @@ void main()
     LightDirection_cameraspace = LightPosition_cameraspace + EyeDirection_cameraspace;
 
     vec3 vertexNormal_cameraspace = MV3x3 * normalize(vertexNormal_modelspace);
-    vec3 vertexTangent_cameraspace = MV3x3 * normalize(vertexTangent_modelspace);
-    vec3 vertexBitangent_cameraspace = MV3x3 * normalize(vertexBitangent_modelspace);
+    vec3 vertexTangent_cameraspace = MV3x3 * normalize(vertexTangent_modelspace.xyz);
+    // rebuilt from the tangent sign, packed layouts have no bitangent
+    vec3 vertexBitangent_modelspace = cross(normalize(vertexNormal_modelspace), normalize(vertexTangent_modelspace.xyz)) * vertexTangent_modelspace.w;
+    vec3 vertexBitangent_cameraspace = MV3x3 * vertexBitangent_modelspace;
 
     mat3 TBN = transpose(mat3(
         vertexTangent_cameraspace,
@@ -0,0 +1,40 @@
+#version 410 core
+
+// camera facing quads from the points of a transform feedback capture
+// writes the UV of a unit quad, for the fragment shaders of the instanced particles
+
+layout (points) in;
+layout (triangle_strip, max_vertices = 4) out;
+
+in vec3 vs_position[];
+
+uniform mat4 u_viewProjection;
+uniform vec3 u_worldOrigin;
+uniform vec3 u_viewPosition;
+uniform float u_particleScale;
+
+out vec2 UV;
+
+void main()
+{
+    vec3 front = normalize(vs_position[0] - u_viewPosition);
+    vec3 right = cross(front, vec3(0.0, 1.0, 0.0));
+    if (dot(right, right) < 1e-6)
+        right = vec3(1.0, 0.0, 0.0);
+    right = normalize(right);
+    vec3 up = cross(right, front);
+
+    vec3 center = vs_position[0] + u_worldOrigin;
+    right *= u_particleScale * 0.5;
+    up *= u_particleScale * 0.5;
+
+    for (int i = 0; i < 4; i++)
+    {
+        vec2 corner = vec2(i & 1, i >> 1);
+        vec3 position = center + right * (corner.x * 2.0 - 1.0) + up * (corner.y * 2.0 - 1.0);
+        gl_Position = u_viewProjection * vec4(position, 1.0);
+        UV = corner;
+        EmitVertex();
+    }
+    EndPrimitive();
+}
@@ -0,0 +1,10 @@
+#version 410 core
+
+layout (location = 0) in vec3 position;
+
+out vec3 vs_position;
+
+void main()
+{
+    vs_position = position;
+}
@@ -0,0 +1,6 @@
+#version 410 core
+
+// drawn with rasterizer discard, never runs
+void main()
+{
+}
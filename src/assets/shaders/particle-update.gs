@@ -0,0 +1,34 @@
+#version 410 core
+
+layout (points) in;
+layout (points, max_vertices = 1) out;
+
+in vec3 vs_position[];
+in vec3 vs_emitPosition[];
+in vec3 vs_velocity[];
+in float vs_duration[];
+in float vs_maxDuration[];
+in float vs_distance[];
+
+out vec3 tf_position;
+out vec3 tf_emitPosition;
+out vec3 tf_velocity;
+out float tf_duration;
+out float tf_maxDuration;
+out float tf_distance;
+
+// expired particles are not written, the capture only holds live ones
+void main()
+{
+    if (vs_duration[0] < 0.0)
+        return;
+
+    tf_position = vs_position[0];
+    tf_emitPosition = vs_emitPosition[0];
+    tf_velocity = vs_velocity[0];
+    tf_duration = vs_duration[0];
+    tf_maxDuration = vs_maxDuration[0];
+    tf_distance = vs_distance[0];
+    EmitVertex();
+    EndPrimitive();
+}
@@ -0,0 +1,77 @@
+#version 410 core
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 emitPosition;
+layout (location = 2) in vec3 velocity;
+layout (location = 3) in float duration;
+layout (location = 4) in float maxDuration;
+
+uniform bool u_emit;
+uniform int u_seed;
+uniform float u_deltaTime;
+uniform vec3 u_viewPosition;
+
+// same emission as the cpu pool
+uniform vec3 u_emitPosition;
+uniform vec3 u_emitDirection;
+uniform float u_randomness;
+uniform vec2 u_velocity;
+uniform vec2 u_duration;
+
+out vec3 vs_position;
+out vec3 vs_emitPosition;
+out vec3 vs_velocity;
+out float vs_duration;
+out float vs_maxDuration;
+out float vs_distance;
+
+const float TWO_PI = 6.28318530718;
+
+uint hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+// uniform in [0, 1), four per emitted particle
+float random(uint index)
+{
+    uint value = hash(uint(u_seed) ^ hash(uint(gl_VertexID) * 4U + index));
+    return float(value >> 8) / 16777216.0;
+}
+
+void main()
+{
+    if (u_emit)
+    {
+        // uniform on the unit sphere from a height and an angle
+        float z = random(0U) * 2.0 - 1.0;
+        float angle = random(1U) * TWO_PI;
+        float ring = sqrt(1.0 - z * z);
+        vec3 spread = vec3(ring * cos(angle), ring * sin(angle), z);
+
+        vec3 direction = normalize(u_emitDirection + u_randomness * spread);
+        vs_velocity = direction * mix(u_velocity.x, u_velocity.y, random(2U));
+        vs_duration = mix(u_duration.x, u_duration.y, random(3U));
+        vs_maxDuration = vs_duration;
+        vs_position = u_emitPosition;
+        vs_emitPosition = u_emitPosition;
+    }
+    else
+    {
+        vs_velocity = velocity;
+        vs_duration = duration;
+        vs_maxDuration = maxDuration;
+        vs_position = position;
+        vs_emitPosition = emitPosition;
+    }
+
+    // emitted particles move in their first step too
+    vs_position += vs_velocity * u_deltaTime;
+    vs_duration -= u_deltaTime;
+    vs_distance = distance(vs_position, u_viewPosition);
+}
@@ -0,0 +1,133 @@
+#version 410 core
+
+out vec4 FragColor;
+
+uniform sampler2D gPosition;
+uniform sampler2D gNormalShadow;
+uniform sampler2D gAlbedo;
+uniform sampler2D gAoRoughMetal;
+
+// first index and count of each cluster
+uniform usamplerBuffer clusterLights;
+uniform usamplerBuffer lightIndices;
+// position and radius, then color of each light
+uniform samplerBuffer lightData;
+
+uniform int clusterCountX;
+uniform int clusterCountY;
+uniform int clusterCountZ;
+uniform float sliceScale;
+uniform float sliceBias;
+
+uniform mat4 view;
+uniform vec3 camPos;
+uniform vec2 screenSize;
+
+const float PI = 3.14159265359;
+
+// ----------------------------------------------------------------------------
+float DistributionGGX(vec3 N, vec3 H, float roughness)
+{
+    float a = roughness*roughness;
+    float a2 = a*a;
+    float NdotH = max(dot(N, H), 0.0);
+    float NdotH2 = NdotH*NdotH;
+
+    float nom   = a2;
+    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
+    denom = PI * denom * denom;
+
+    return nom / denom;
+}
+// ----------------------------------------------------------------------------
+float GeometrySchlickGGX(float NdotV, float roughness)
+{
+    float r = (roughness + 1.0);
+    float k = (r*r) / 8.0;
+
+    float nom   = NdotV;
+    float denom = NdotV * (1.0 - k) + k;
+
+    return nom / denom;
+}
+// ----------------------------------------------------------------------------
+float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness)
+{
+    float NdotV = max(dot(N, V), 0.0);
+    float NdotL = max(dot(N, L), 0.0);
+    float ggx2 = GeometrySchlickGGX(NdotV, roughness);
+    float ggx1 = GeometrySchlickGGX(NdotL, roughness);
+
+    return ggx1 * ggx2;
+}
+// ----------------------------------------------------------------------------
+vec3 fresnelSchlick(float cosTheta, vec3 F0)
+{
+    return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}
+// ----------------------------------------------------------------------------
+
+void main()
+{
+    vec2 deferredUV = gl_FragCoord.xy / screenSize;
+
+    vec3 WorldPos = texture(gPosition, deferredUV).xyz;
+    vec4 normalShadow = texture(gNormalShadow, deferredUV);
+    vec3 N = normalShadow.xyz;
+    vec3 albedo = pow(texture(gAlbedo, deferredUV).rgb, vec3(2.2));
+    vec3 aoRoughMetal = texture(gAoRoughMetal, deferredUV).rgb;
+    float roughness = aoRoughMetal.g;
+    float metallic = aoRoughMetal.b;
+
+    // cluster of the pixel, slices are exponential in view depth
+    float depth = -(view * vec4(WorldPos, 1.0)).z;
+    int slice = clamp(int(floor(log(max(depth, 0.0001)) * sliceScale + sliceBias)), 0, clusterCountZ - 1);
+    ivec2 clusterTiles = ivec2(clusterCountX, clusterCountY);
+    ivec2 tile = min(ivec2(deferredUV * vec2(clusterTiles)), clusterTiles - 1);
+    int cluster = (slice * clusterCountY + tile.y) * clusterCountX + tile.x;
+    uvec2 range = texelFetch(clusterLights, cluster).rg;
+
+    vec3 V = normalize(camPos - WorldPos);
+
+    vec3 F0 = vec3(0.04);
+    F0 = mix(F0, albedo, metallic);
+
+    vec3 Lo = vec3(0.0);
+    for (uint i = 0u; i < range.y; i++)
+    {
+        int lightIndex = int(texelFetch(lightIndices, int(range.x + i)).r);
+        vec4 positionRadius = texelFetch(lightData, lightIndex * 2);
+        vec3 color = texelFetch(lightData, lightIndex * 2 + 1).rgb;
+
+        vec3 position = positionRadius.xyz;
+        float radius = positionRadius.w;
+        float dist = length(position - WorldPos);
+        if (dist >= radius)
+            continue;
+
+        vec3 L = normalize(position - WorldPos);
+        vec3 H = normalize(V + L);
+
+        // same falloff as the light volumes
+        float attenuation = 1.0 - (dist / radius);
+        vec3 radiance = color * attenuation;
+
+        // Cook-Torrance BRDF
+        float NDF = DistributionGGX(N, H, roughness);
+        float G   = GeometrySmith(N, V, L, roughness);
+        vec3 F    = fresnelSchlick(clamp(dot(H, V), 0.0, 1.0), F0);
+
+        vec3 numerator    = NDF * G * F;
+        float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001;
+        vec3 specular = numerator / denominator;
+
+        vec3 kS = F;
+        vec3 kD = vec3(1.0) - kS;
+        kD *= 1.0 - metallic;
+
+        float NdotL = max(dot(N, L), 0.0);
+        Lo += (kD * albedo / PI + specular) * radiance * NdotL;
+    }
+
+    FragColor = vec4(Lo, 1.0);
+}
@@ -0,0 +1,13 @@
+#version 410 core
+
+layout (location = 0) in vec2 position;
+layout (location = 1) in vec2 uv;
+
+out vec2 TexCoords;
+
+void main()
+{
+    TexCoords = uv;
+    // on the far plane, a greater depth test skips the sky
+    gl_Position = vec4(position.xy, 1.0, 1.0);
+}
@@ -0,0 +1,12 @@
+#version 410 core
+
+#include <pbr-transform.vs>
+
+// per instance model matrix, locations 7-10
+layout (location = 7) in mat4 aInstanceModel;
+
+void main()
+{
+    // origin transform, shared by every instance
+    transformVertex(model * aInstanceModel * u_meshOffset);
+}
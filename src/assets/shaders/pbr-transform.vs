@@ -0,0 +1,57 @@
+// shared by pbr.vs and pbr-instanced.vs, the variants only differ in the model matrix
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+// w is the bitangent sign, 1 when the layout has no sign
+layout (location = 3) in vec4 aTangent;
+
+out vec2 TexCoords;
+out vec3 WorldPos;
+out vec3 ModelPos;
+out vec3 Tangent;
+out vec3 Bitangent;
+out vec3 Normal;
+out mat4 TransformedModel;
+
+out vec3 ViewPos;
+out vec3 ViewNormal;
+out mat3 ViewTBN;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform mat4 model;
+uniform mat4 u_meshOffset;
+
+uniform bool u_flipNormals;
+
+void transformVertex(mat4 transformedModel)
+{
+    TexCoords = aTexCoords;
+    TransformedModel = transformedModel;
+    WorldPos = vec3(TransformedModel * vec4(aPos, 1.0));
+    ModelPos = aPos;
+    ViewPos = (view * vec4(WorldPos, 1.0)).xyz;
+
+    gl_Position = projection * vec4(ViewPos, 1.0);
+
+    vec3 normal = aNormal;
+
+    if (u_flipNormals)
+        normal *= -1.0;
+
+    // world space normals
+    mat3 normalMatrix = transpose(inverse(mat3(TransformedModel)));
+    Normal = normalize(normalMatrix * normal);
+    Tangent = normalize(normalMatrix * aTangent.xyz);
+    Bitangent = cross(Normal, Tangent) * aTangent.w;
+
+    // view space normals
+    mat3 viewNormalMatrix = transpose(inverse(mat3(view * TransformedModel)));
+    ViewNormal = normalize(viewNormalMatrix * normal);
+
+    vec3 viewT = normalize(viewNormalMatrix * aTangent.xyz);
+    viewT = normalize(viewT - dot(viewT, ViewNormal) * ViewNormal);
+    vec3 viewB = cross(ViewNormal, viewT) * aTangent.w;
+    ViewTBN = mat3(viewT, viewB, ViewNormal);
+}
@@ -3,8 +3,8 @@
 layout(location = 0) in vec3 pos;
 layout(location = 1) in vec3 norm;
 layout(location = 2) in vec2 tex;
-layout(location = 3) in vec3 tangent;
-layout(location = 4) in vec3 bitangent;
+// w is the bitangent sign, 1 when the layout has no sign
+layout(location = 3) in vec4 tangent;
 
 uniform mat4 projection;
 uniform mat4 view;
@@ -26,6 +26,7 @@ void main()
     TexCoords = tex;
     Pos = pos;
     Normal = norm;
-    Tangent = tangent;
-    Bitangent = bitangent;
+    Tangent = tangent.xyz;
+    // rebuilt from the tangent sign, packed layouts have no bitangent
+    Bitangent = cross(norm, tangent.xyz) * tangent.w;
 }
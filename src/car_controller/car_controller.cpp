@@ -301,10 +301,9 @@ void CarController::followCar(float deltaTime)
 }
 
 // TODO: sync with engine force
+// emission only, particles are simulated by the particle manager
 void CarController::updateExhaust(int index, float deltaTime)
 {
-    m_exhausParticles[index]->update(deltaTime);
-
     float maxParticlesPerSecond = 250.0f;
     float maxSpeed = 25.0f;
 
@@ -319,7 +318,6 @@ void CarController::updateTireSmoke(int index, float deltaTime)
 {
     bool front = index < 2;
     ParticleEngine *tireSmoke = m_tireSmokeParticles[index];
-    tireSmoke->update(deltaTime);
 
     if (!m_vehicle->m_wheelInContact[index])
     {
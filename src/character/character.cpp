@@ -20,35 +20,39 @@ void Character::init()
     // Animation
     m_model = m_resourceManager->getModel("assets/character/mixamo-y-1.glb");
 
-    Animation *animIdle = new Animation("idle", m_model);
-
-    Animation *animWalkForward = new Animation("walking-forward", m_model);
-    Animation *animWalkBack = new Animation("walking-back", m_model);
-    Animation *animWalkLeft = new Animation("walking-left", m_model);
-    Animation *animWalkRight = new Animation("walking-right", m_model);
-    Animation *animWalkBackLeft = new Animation("walking-back-left", m_model);
-    Animation *animWalkBackRight = new Animation("walking-back-right", m_model);
-
-    Animation *animRunForward = new Animation("running-forward", m_model);
-    Animation *animRunBack = new Animation("running-back", m_model);
-    Animation *animRunLeft = new Animation("running-left", m_model);
-    Animation *animRunRight = new Animation("running-right", m_model);
-    Animation *animRunBackLeft = new Animation("running-back-left", m_model);
-    Animation *animRunBackRight = new Animation("running-back-right", m_model);
+    Animation *animIdle = m_resourceManager->getAnimation(m_model, "idle", true);
+
+    Animation *animWalkForward = m_resourceManager->getAnimation(m_model, "walking-forward", true);
+    Animation *animWalkBack = m_resourceManager->getAnimation(m_model, "walking-back", true);
+    Animation *animWalkLeft = m_resourceManager->getAnimation(m_model, "walking-left", true);
+    Animation *animWalkRight = m_resourceManager->getAnimation(m_model, "walking-right", true);
+    Animation *animWalkBackLeft = m_resourceManager->getAnimation(m_model, "walking-back-left", true);
+    Animation *animWalkBackRight = m_resourceManager->getAnimation(m_model, "walking-back-right", true);
+
+    Animation *animRunForward = m_resourceManager->getAnimation(m_model, "running-forward", true);
+    Animation *animRunBack = m_resourceManager->getAnimation(m_model, "running-back", true);
+    Animation *animRunLeft = m_resourceManager->getAnimation(m_model, "running-left", true);
+    Animation *animRunRight = m_resourceManager->getAnimation(m_model, "running-right", true);
+    Animation *animRunBackLeft = m_resourceManager->getAnimation(m_model, "running-back-left", true);
+    Animation *animRunBackRight = m_resourceManager->getAnimation(m_model, "running-back-right", true);
 
     // TODO: create empty at runtime?
-    Animation *animRagdoll = new Animation("pose", m_model);
-    Animation *animHeadFollow = new Animation("pose", m_model);
-
-    Animation *animPistolAim = new Animation("pistol-aim-1", m_model);
-    Animation *animFiring = new Animation("firing", m_model);
-    Animation *animLeanLeft = new Animation("left", m_model);
-    Animation *animLeanRight = new Animation("right", m_model);
-
-    Animation *animEnterCar = new Animation("enter-car-7", m_model);
-    Animation *animExitCar = new Animation("exit-car-6", m_model);
-    Animation *animJumpCar = new Animation("jump-car-5", m_model);
-    Animation *animTurn180 = new Animation("turn-180", m_model);
+    // writable copies, ragdoll and head follow modify their keyframes
+    m_animPose = m_resourceManager->getAnimation(m_model, "pose");
+    Animation *animRagdoll = new Animation(*m_animPose);
+    Animation *animHeadFollow = new Animation(*m_animPose);
+    m_animRagdoll = animRagdoll;
+    m_animHeadFollow = animHeadFollow;
+
+    Animation *animPistolAim = m_resourceManager->getAnimation(m_model, "pistol-aim-1", true);
+    Animation *animFiring = m_resourceManager->getAnimation(m_model, "firing", true);
+    Animation *animLeanLeft = m_resourceManager->getAnimation(m_model, "left", true);
+    Animation *animLeanRight = m_resourceManager->getAnimation(m_model, "right", true);
+
+    Animation *animEnterCar = m_resourceManager->getAnimation(m_model, "enter-car-7", true);
+    Animation *animExitCar = m_resourceManager->getAnimation(m_model, "exit-car-6", true);
+    Animation *animJumpCar = m_resourceManager->getAnimation(m_model, "jump-car-5", true);
+    Animation *animTurn180 = m_resourceManager->getAnimation(m_model, "turn-180", true);
 
     // TODO: inside Model
     std::vector<Animation *> animations = {
@@ -78,6 +82,7 @@ void Character::init()
         animEnterCar,
         animExitCar,
         animJumpCar,
+        animTurn180,
     };
 
     // TODO: setup multiple animators from same Model
@@ -102,61 +107,6 @@ void Character::init()
     m_runCircle.m_backLeft = m_animator->addStateAnimation(animRunBackLeft);
     m_runCircle.m_backRight = m_animator->addStateAnimation(animRunBackRight);
 
-    // blend masks
-    std::unordered_map<std::string, float> blendMask;
-    blendMask["mixamorig:Spine"] = 1.0f;
-    blendMask["mixamorig:Spine1"] = 1.0f;
-    blendMask["mixamorig:Spine2"] = 1.0f;
-    blendMask["mixamorig:Neck"] = 1.0f;
-    blendMask["mixamorig:Head"] = 1.0f;
-
-    animLeanLeft->setBlendMask(blendMask, 0.f);
-    animLeanRight->setBlendMask(blendMask, 0.f);
-    // TODO: ragdoll mask for ragdoll hands - default position?
-
-    // TODO: fix animation - no arms
-    blendMask.clear();
-    blendMask["mixamorig:Hips"] = 1.0f;
-    blendMask["mixamorig:Spine"] = 1.0f;
-    blendMask["mixamorig:Spine1"] = 1.0f;
-    blendMask["mixamorig:Spine2"] = 1.0f;
-    blendMask["mixamorig:Neck"] = 1.0f;
-    blendMask["mixamorig:Head"] = 1.0f;
-    blendMask["mixamorig:LeftShoulder"] = 1.0f;
-    blendMask["mixamorig:RightShoulder"] = 1.0f;
-    blendMask["mixamorig:RightUpLeg"] = 1.0f;
-    blendMask["mixamorig:RightLeg"] = 1.0f;
-    blendMask["mixamorig:RightFoot"] = 1.0f;
-    blendMask["mixamorig:RightToeBase"] = 1.0f;
-    blendMask["mixamorig:LeftUpLeg"] = 1.0f;
-    blendMask["mixamorig:LeftLeg"] = 1.0f;
-    blendMask["mixamorig:LeftFoot"] = 1.0f;
-    blendMask["mixamorig:LeftToeBase"] = 1.0f;
-
-    animWalkBackLeft->setBlendMask(blendMask, 0.f);
-    animWalkBackRight->setBlendMask(blendMask, 0.f);
-    animRunBackLeft->setBlendMask(blendMask, 0.f);
-    animRunBackRight->setBlendMask(blendMask, 0.f);
-
-    // firing
-    blendMask.clear();
-    blendMask["mixamorig:Neck"] = 1.0f;
-    blendMask["mixamorig:Spine2"] = 1.0f;
-    blendMask["mixamorig:RightShoulder"] = 1.0f;
-    blendMask["mixamorig:RightArm"] = 1.0f;
-    blendMask["mixamorig:RightForeArm"] = 1.0f;
-    blendMask["mixamorig:RightHand"] = 1.0f;
-    animFiring->setBlendMask(blendMask, 0.f);
-
-    // head follow
-    blendMask.clear();
-    blendMask["mixamorig:Head"] = 1.0f;
-    animHeadFollow->setBlendMask(blendMask, 0.f);
-
-    blendMask.clear();
-    blendMask["mixamorig:Hips"] = 0.f;
-    animTurn180->setBlendMask(blendMask, 1.f);
-
     // TODO: priority variable? instead of order
     // state anim poses
     m_animPoseLeanLeft = m_animator->addPoseAnimation(animLeanLeft);
@@ -170,6 +120,57 @@ void Character::init()
     m_animPoseHeadFollow = m_animator->addPoseAnimation(animHeadFollow);
     m_animPoseRagdoll = m_animator->addPoseAnimation(animRagdoll);
 
+    // blend masks
+    BlendMask *leanMask = m_animator->createBlendMask(0.f);
+    leanMask->set({"mixamorig:Spine", "mixamorig:Spine1", "mixamorig:Spine2", "mixamorig:Neck", "mixamorig:Head"}, 1.f);
+
+    m_animPoseLeanLeft->setBlendMask(leanMask);
+    m_animPoseLeanRight->setBlendMask(leanMask);
+    // TODO: ragdoll mask for ragdoll hands - default position?
+
+    // TODO: fix animation - no arms
+    BlendMask *backDiagonalMask = m_animator->createBlendMask(0.f);
+    backDiagonalMask->set({"mixamorig:Hips", "mixamorig:Spine", "mixamorig:Spine1", "mixamorig:Spine2",
+                           "mixamorig:Neck", "mixamorig:Head", "mixamorig:LeftShoulder", "mixamorig:RightShoulder",
+                           "mixamorig:RightUpLeg", "mixamorig:RightLeg", "mixamorig:RightFoot", "mixamorig:RightToeBase",
+                           "mixamorig:LeftUpLeg", "mixamorig:LeftLeg", "mixamorig:LeftFoot", "mixamorig:LeftToeBase"},
+                          1.f);
+
+    m_walkCircle.m_backLeft->setBlendMask(backDiagonalMask);
+    m_walkCircle.m_backRight->setBlendMask(backDiagonalMask);
+    m_runCircle.m_backLeft->setBlendMask(backDiagonalMask);
+    m_runCircle.m_backRight->setBlendMask(backDiagonalMask);
+
+    // upper body and right arm, shared by firing and aiming
+    BlendMask *rightArmMask = m_animator->createBlendMask(0.f);
+    rightArmMask->set({"mixamorig:Neck", "mixamorig:Spine2", "mixamorig:RightShoulder",
+                       "mixamorig:RightArm", "mixamorig:RightForeArm", "mixamorig:RightHand"},
+                      1.f);
+
+    m_animPoseFiring->setBlendMask(rightArmMask);
+
+    // head follow
+    BlendMask *headMask = m_animator->createBlendMask(0.f);
+    headMask->set("mixamorig:Head", 1.f);
+    m_animPoseHeadFollow->setBlendMask(headMask);
+
+    BlendMask *turnMask = m_animator->createBlendMask(1.f);
+    turnMask->set("mixamorig:Hips", 0.f);
+    m_animTurn180->setBlendMask(turnMask);
+
+    // pistol aim, the right hand grip is always on and the arm follows the aim blend
+    BlendMask *rightHandMask = m_animator->createBlendMask(0.f);
+    const char *fingers[] = {"Thumb", "Index", "Middle", "Ring", "Pinky"};
+    for (int i = 0; i < 5; i++)
+    {
+        for (int j = 1; j <= 4; j++)
+            rightHandMask->set("mixamorig:RightHand" + std::string(fingers[i]) + std::to_string(j), 1.f);
+    }
+
+    m_animPosePistolAim->setBlendMask(rightHandMask);
+    m_aimMaskLayer = m_animPosePistolAim->addBlendMaskLayer(rightArmMask, 0.f);
+    m_animPosePistolAim->addBlendMaskLayer(headMask, 0.f);
+
     m_animPoseRagdoll->m_timerActive = false;
     m_animPoseHeadFollow->m_timerActive = false;
     m_animPosePistolAim->m_timerActive = false;
@@ -211,8 +212,15 @@ Character::~Character()
 {
     delete m_controller;
     for (int i = 0; i < m_animator->m_animations.size(); i++)
-        delete m_animator->m_animations[i];
+    {
+        Animation *animation = m_animator->m_animations[i];
+        if (animation == m_animRagdoll || animation == m_animHeadFollow)
+            delete animation;
+        else
+            m_resourceManager->releaseAnimation(animation);
+    }
     m_animator->m_animations.clear();
+    m_resourceManager->releaseAnimation(m_animPose);
     delete m_animator;
     delete m_ragdoll;
 }
@@ -463,7 +471,6 @@ void Character::updateHeadFollow(float deltaTime)
     shouldSlerp = shouldSlerp && animPose.m_blendFactor != 0.f;
 
     boneRot = shouldSlerp ? glm::slerp(boneRot, m_clampedHeadRot, 0.1f) : m_clampedHeadRot;
-    bone->updatePose();
 
     m_lastHeadFollow = m_headFollow;
 }
@@ -680,51 +687,16 @@ void Character::checkPhysicsStateChange()
     }
 }
 
-// TODO: single run in a thread
+// masks are built at load, only the layer weights change here
 void Character::updateAimPoseBlendMask(float blendFactor)
 {
-    // early exit
-    Bone *bone = m_animPosePistolAim->m_animation->getBone("mixamorig:Head");
-    if (bone && bone->m_blendFactor == blendFactor)
-        return;
-
-    std::unordered_map<std::string, float> blendMask;
-
     glm::vec2 p0(0, 0);
     glm::vec2 p1(0.5, 1);
     glm::vec2 p2(0.15, 1);
     glm::vec2 p3(1, 1);
     float cubicBlend = CommonUtil::cubicBezier(p0, p1, p2, p3, blendFactor).y;
 
-    blendMask["mixamorig:Head"] = cubicBlend;
-    blendMask["mixamorig:Neck"] = cubicBlend;
-    blendMask["mixamorig:Spine2"] = cubicBlend;
-    blendMask["mixamorig:RightShoulder"] = cubicBlend;
-    blendMask["mixamorig:RightArm"] = cubicBlend;
-    blendMask["mixamorig:RightForeArm"] = cubicBlend;
-    blendMask["mixamorig:RightHand"] = cubicBlend;
-
-    // always on
-    blendMask["mixamorig:RightHandThumb1"] = 1.0f;
-    blendMask["mixamorig:RightHandThumb2"] = 1.0f;
-    blendMask["mixamorig:RightHandThumb3"] = 1.0f;
-    blendMask["mixamorig:RightHandThumb4"] = 1.0f;
-    blendMask["mixamorig:RightHandIndex1"] = 1.0f;
-    blendMask["mixamorig:RightHandIndex2"] = 1.0f;
-    blendMask["mixamorig:RightHandIndex3"] = 1.0f;
-    blendMask["mixamorig:RightHandIndex4"] = 1.0f;
-    blendMask["mixamorig:RightHandMiddle1"] = 1.0f;
-    blendMask["mixamorig:RightHandMiddle2"] = 1.0f;
-    blendMask["mixamorig:RightHandMiddle3"] = 1.0f;
-    blendMask["mixamorig:RightHandMiddle4"] = 1.0f;
-    blendMask["mixamorig:RightHandRing1"] = 1.0f;
-    blendMask["mixamorig:RightHandRing2"] = 1.0f;
-    blendMask["mixamorig:RightHandRing3"] = 1.0f;
-    blendMask["mixamorig:RightHandRing4"] = 1.0f;
-    blendMask["mixamorig:RightHandPinky1"] = 1.0f;
-    blendMask["mixamorig:RightHandPinky2"] = 1.0f;
-    blendMask["mixamorig:RightHandPinky3"] = 1.0f;
-    blendMask["mixamorig:RightHandPinky4"] = 1.0f;
-
-    m_animPosePistolAim->m_animation->setBlendMask(blendMask, 0.0f);
+    // right arm and head layers
+    m_animPosePistolAim->setBlendMaskLayerWeight(m_aimMaskLayer, cubicBlend);
+    m_animPosePistolAim->setBlendMaskLayerWeight(m_aimMaskLayer + 1, cubicBlend);
 }
@@ -101,6 +101,11 @@ public:
     Anim *m_animPoseHeadFollow;
     Anim *m_animTurn180;
 
+    // clips written at runtime, copied from the shared pose clip and owned by the character
+    Animation *m_animPose;
+    Animation *m_animRagdoll;
+    Animation *m_animHeadFollow;
+
     float m_blendSpeed = 0.2f;
 
     float m_walkStepFreq = 1.f;
@@ -115,6 +120,8 @@ public:
     float m_runAnimSpeed = 0.f;
 
     float m_aimBlend = 0.0f;
+    // first of the right arm and head mask layers on the pistol aim pose
+    int m_aimMaskLayer = 0;
     float m_aimStateChangeSpeed = 3.f;
 
     float m_firingBlend = 0.0f;
@@ -83,12 +83,10 @@ void PCharacter::update(float deltaTime)
 {
     Character::update(deltaTime);
 
-    // particle
-    m_smokeParticle->update(deltaTime);
+    // particle, emission only, simulated by the particle manager
     m_smokeParticle->m_position = m_lastFireHit;
 
     m_muzzleFlash->m_particlesPerSecond = m_firing ? 250.f : 0.f;
-    m_muzzleFlash->update(deltaTime);
     m_muzzleFlash->m_position = m_muzzlePosition;
     m_muzzleFlash->m_direction = m_muzzleDirection;
 
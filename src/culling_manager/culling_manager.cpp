@@ -1,174 +1,477 @@
 #include "culling_manager.h"
 
 #include <algorithm>
+#include <chrono>
 
-class MyOverlapCallback : public btBroadphaseAabbCallback
+#if defined(__AVX__)
+#define CULLING_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CULLING_SSE
+#include <emmintrin.h>
+#endif
+
+// objects per leaf, a multiple of the simd width
+#define CULL_LEAF_SIZE 64
+
+// 8 lanes of floats, comparisons return one bit per lane
+#if defined(CULLING_AVX)
+
+typedef __m256 Lane8;
+
+static inline Lane8 load8(const float *p) { return _mm256_loadu_ps(p); }
+static inline Lane8 set8(float a) { return _mm256_set1_ps(a); }
+static inline Lane8 add8(Lane8 a, Lane8 b) { return _mm256_add_ps(a, b); }
+static inline Lane8 mul8(Lane8 a, Lane8 b) { return _mm256_mul_ps(a, b); }
+static inline int less8(Lane8 a, Lane8 b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+
+#elif defined(CULLING_SSE)
+
+// two sse halves
+struct Lane8
 {
-public:
-    btAlignedObjectArray<btCollisionObject *> *m_overlappingObjects;
+    __m128 low, high;
+};
 
-    MyOverlapCallback()
-    {
-        m_overlappingObjects = new btAlignedObjectArray<btCollisionObject *>();
-    }
+static inline Lane8 load8(const float *p) { return Lane8{_mm_loadu_ps(p), _mm_loadu_ps(p + 4)}; }
+static inline Lane8 set8(float a) { return Lane8{_mm_set1_ps(a), _mm_set1_ps(a)}; }
+static inline Lane8 add8(Lane8 a, Lane8 b) { return Lane8{_mm_add_ps(a.low, b.low), _mm_add_ps(a.high, b.high)}; }
+static inline Lane8 mul8(Lane8 a, Lane8 b) { return Lane8{_mm_mul_ps(a.low, b.low), _mm_mul_ps(a.high, b.high)}; }
+static inline int less8(Lane8 a, Lane8 b)
+{
+    return _mm_movemask_ps(_mm_cmplt_ps(a.low, b.low)) | (_mm_movemask_ps(_mm_cmplt_ps(a.high, b.high)) << 4);
+}
 
-    ~MyOverlapCallback()
-    {
-        delete m_overlappingObjects;
-    }
+#else
 
-    virtual bool process(const btBroadphaseProxy *proxy)
-    {
-        btCollisionObject *collisionObject = static_cast<btCollisionObject *>(proxy->m_clientObject);
-        m_overlappingObjects->push_back(collisionObject);
-        return true;
-    }
+struct Lane8
+{
+    float v[8];
 };
 
-CullingManager::CullingManager()
+static inline Lane8 load8(const float *p)
 {
-    init();
+    Lane8 r;
+    for (int i = 0; i < 8; i++)
+        r.v[i] = p[i];
+    return r;
 }
+static inline Lane8 set8(float a) { return Lane8{{a, a, a, a, a, a, a, a}}; }
+
+#define LANE8_OP(name, expression)             \
+    static inline Lane8 name(Lane8 a, Lane8 b) \
+    {                                          \
+        Lane8 r;                               \
+        for (int i = 0; i < 8; i++)            \
+            r.v[i] = expression;               \
+        return r;                              \
+    }
 
-CullingManager::~CullingManager()
+LANE8_OP(add8, a.v[i] + b.v[i])
+LANE8_OP(mul8, a.v[i] * b.v[i])
+
+static inline int less8(Lane8 a, Lane8 b)
 {
-    for (int i = m_collisionWorld->getNumCollisionObjects() - 1; i >= 0; i--)
-    {
-        btCollisionObject *obj = m_collisionWorld->getCollisionObjectArray()[i];
+    int mask = 0;
+    for (int i = 0; i < 8; i++)
+        mask |= (a.v[i] < b.v[i]) << i;
+    return mask;
+}
 
-        // TODO: refactor when shape reuse impl
-        if (obj && obj->getCollisionShape())
+#endif
+
+// 10 bits per axis interleaved
+static uint32_t expandBits(uint32_t v)
+{
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+// entry parameter of the segment from + dir * t, t in [0, 1]
+static bool intersectSegment(const glm::vec3 &from, const glm::vec3 &dir, const glm::vec3 &aabbMin, const glm::vec3 &aabbMax, float &t)
+{
+    float tMin = 0.f;
+    float tMax = 1.f;
+    for (int i = 0; i < 3; i++)
+    {
+        if (std::abs(dir[i]) < 1e-8f)
         {
-            delete obj->getCollisionShape();
+            if (from[i] < aabbMin[i] || from[i] > aabbMax[i])
+                return false;
+            continue;
         }
 
-        m_collisionWorld->removeCollisionObject(obj);
-
-        delete obj;
+        float t0 = (aabbMin[i] - from[i]) / dir[i];
+        float t1 = (aabbMax[i] - from[i]) / dir[i];
+        tMin = std::max(tMin, std::min(t0, t1));
+        tMax = std::min(tMax, std::max(t0, t1));
+        if (tMin > tMax)
+            return false;
     }
 
-    delete m_dispatcher;
-    delete m_broadphase;
-    delete m_collisionConfiguration;
-    delete m_collisionWorld;
+    t = tMin;
+    return true;
 }
 
-void CullingManager::init()
+// mask of the planes the box crosses, -1 if it is behind one of them
+// the plane that rejected the box last time most likely rejects it again
+static int classifyBox(const glm::vec3 &aabbMin, const glm::vec3 &aabbMax, const glm::vec4 *planes, int planeCount, int &lastFailedPlane)
 {
-    // TODO: minimum runtime ram usage
-    m_collisionConfiguration = new btDefaultCollisionConfiguration();
-    m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
-    m_broadphase = new btDbvtBroadphase();
-    m_collisionWorld = new btCollisionWorld(m_dispatcher, m_broadphase, m_collisionConfiguration);
+    int planeMask = 0;
+    for (int i = 0; i < planeCount; i++)
+    {
+        int plane = (lastFailedPlane + i) % planeCount;
+        glm::vec3 normal = glm::vec3(planes[plane]);
+        glm::vec3 positive = glm::mix(aabbMin, aabbMax, glm::greaterThan(normal, glm::vec3(0.f)));
+        if (glm::dot(normal, positive) + planes[plane].w < 0.f)
+        {
+            lastFailedPlane = plane;
+            return -1;
+        }
+
+        glm::vec3 negative = glm::mix(aabbMax, aabbMin, glm::greaterThan(normal, glm::vec3(0.f)));
+        if (glm::dot(normal, negative) + planes[plane].w < 0.f)
+            planeMask |= 1 << plane;
+    }
 
+    return planeMask;
+}
+
+CullingManager::CullingManager(JobPool *jobPool)
+    : m_jobPool(jobPool)
+{
     m_debugDrawer = new DebugDrawer();
     m_debugDrawer->setDebugMode(btIDebugDraw::DBG_NoDebug);
-    m_collisionWorld->setDebugDrawer(m_debugDrawer);
+    m_occlusionBuffer = new OcclusionBuffer();
+}
+
+CullingManager::~CullingManager()
+{
+    if (m_occlusionPending)
+        m_jobPool->wait(m_occlusionJob);
+
+    for (auto &occluder : m_occluders)
+        delete occluder.second;
+    delete m_occlusionBuffer;
+    delete m_debugDrawer;
+}
+
+void CullingManager::addObject(void *userPointer, const float radius, const glm::mat4 &modelMatrix)
+{
+    addObject(CullObject{userPointer, modelMatrix, glm::vec3(radius), true});
 }
 
-// TODO: reuse shapes
-btCollisionObject *CullingManager::addObject(void *userPointer, const float radius, const glm::mat4 &modelMatrix)
+void CullingManager::addObject(void *userPointer, const glm::vec3 &size, const glm::mat4 &modelMatrix)
 {
-    btCollisionShape *shape = new btSphereShape(radius);
-    return createCollisionObject(userPointer, shape, modelMatrix);
+    addObject(CullObject{userPointer, modelMatrix, size, false});
 }
 
-btCollisionObject *CullingManager::addObject(void *userPointer, const glm::vec3 &size, const glm::mat4 &modelMatrix)
+void CullingManager::addObject(const CullObject &object)
 {
-    btCollisionShape *shape = new btBoxShape(BulletGLM::getBulletVec3(size));
-    return createCollisionObject(userPointer, shape, modelMatrix);
+    removeObject(object.userPointer);
+
+    int index = m_objects.size();
+    m_objects.push_back(object);
+    m_objectIndices[object.userPointer] = index;
+
+    resizeBounds();
+    updateBounds(index);
+    m_unsortedCount++;
 }
 
+// the last object takes the place of the removed one
 void CullingManager::removeObject(void *userPointer)
 {
-    btCollisionObject *objectToRemove = nullptr;
+    auto it = m_objectIndices.find(userPointer);
+    if (it == m_objectIndices.end())
+        return;
 
-    int numCollisionObjects = m_collisionWorld->getNumCollisionObjects();
-    for (int i = 0; i < numCollisionObjects; ++i)
+    int index = it->second;
+    int last = m_objects.size() - 1;
+    m_objectIndices.erase(it);
+
+    if (index != last)
     {
-        btCollisionObject *obj = m_collisionWorld->getCollisionObjectArray()[i];
-        if (obj->getUserPointer() == userPointer)
-        {
-            objectToRemove = obj;
-            break;
-        }
+        m_objects[index] = m_objects[last];
+        m_objectIndices[m_objects[index].userPointer] = index;
+
+        m_minX[index] = m_minX[last];
+        m_minY[index] = m_minY[last];
+        m_minZ[index] = m_minZ[last];
+        m_maxX[index] = m_maxX[last];
+        m_maxY[index] = m_maxY[last];
+        m_maxZ[index] = m_maxZ[last];
+        m_leaves[index / CULL_LEAF_SIZE].dirty = true;
     }
 
-    if (objectToRemove)
-    {
-        if (objectToRemove->getCollisionShape())
-            delete objectToRemove->getCollisionShape();
+    m_objects.pop_back();
+    resizeBounds();
+    if (!m_leaves.empty())
+        m_leaves.back().dirty = true;
+    m_unsortedCount++;
+}
 
-        m_collisionWorld->removeCollisionObject(objectToRemove);
+void CullingManager::updateObject(void *userPointer, const glm::mat4 &modelMatrix)
+{
+    auto it = m_objectIndices.find(userPointer);
+    if (it == m_objectIndices.end())
+        return;
+
+    m_objects[it->second].modelMatrix = modelMatrix;
+    updateBounds(it->second);
+}
 
-        delete objectToRemove;
+void CullingManager::resizeBounds()
+{
+    int count = m_objects.size();
+    int padded = (count + 7) & ~7;
+    m_minX.resize(padded, 0.f);
+    m_minY.resize(padded, 0.f);
+    m_minZ.resize(padded, 0.f);
+    m_maxX.resize(padded, 0.f);
+    m_maxY.resize(padded, 0.f);
+    m_maxZ.resize(padded, 0.f);
+    m_leaves.resize((count + CULL_LEAF_SIZE - 1) / CULL_LEAF_SIZE);
+}
+
+void CullingManager::updateBounds(int index)
+{
+    const CullObject &object = m_objects[index];
+    glm::vec3 center = glm::vec3(object.modelMatrix[3]);
+    glm::vec3 extents = object.halfExtents;
+    if (!object.sphere)
+    {
+        const glm::mat4 &m = object.modelMatrix;
+        extents = glm::abs(glm::vec3(m[0])) * extents.x + glm::abs(glm::vec3(m[1])) * extents.y + glm::abs(glm::vec3(m[2])) * extents.z;
     }
+
+    m_minX[index] = center.x - extents.x;
+    m_minY[index] = center.y - extents.y;
+    m_minZ[index] = center.z - extents.z;
+    m_maxX[index] = center.x + extents.x;
+    m_maxY[index] = center.y + extents.y;
+    m_maxZ[index] = center.z + extents.z;
+    m_leaves[index / CULL_LEAF_SIZE].dirty = true;
 }
 
-void CullingManager::updateObject(void *userPointer, const glm::mat4 &modelMatrix)
+// morton order of the centers, nearby objects share leaves
+void CullingManager::sortObjects()
 {
-    auto it = m_collisionObjects.find(userPointer);
-    if (it != m_collisionObjects.end())
+    m_unsortedCount = 0;
+    int count = m_objects.size();
+    if (count == 0)
+        return;
+
+    glm::vec3 sceneMin = glm::vec3(m_minX[0], m_minY[0], m_minZ[0]);
+    glm::vec3 sceneMax = glm::vec3(m_maxX[0], m_maxY[0], m_maxZ[0]);
+    for (int i = 1; i < count; i++)
+    {
+        sceneMin = glm::min(sceneMin, glm::vec3(m_minX[i], m_minY[i], m_minZ[i]));
+        sceneMax = glm::max(sceneMax, glm::vec3(m_maxX[i], m_maxY[i], m_maxZ[i]));
+    }
+    glm::vec3 scale = 1023.f / glm::max(sceneMax - sceneMin, glm::vec3(1e-6f));
+
+    std::vector<std::pair<uint32_t, int>> keys(count);
+    for (int i = 0; i < count; i++)
     {
-        btTransform transform;
-        transform.setFromOpenGLMatrix((float *)&modelMatrix);
+        glm::vec3 center = glm::vec3(m_minX[i] + m_maxX[i], m_minY[i] + m_maxY[i], m_minZ[i] + m_maxZ[i]) * 0.5f;
+        glm::vec3 cell = (center - sceneMin) * scale;
+        uint32_t key = (expandBits((uint32_t)cell.x) << 2) | (expandBits((uint32_t)cell.y) << 1) | expandBits((uint32_t)cell.z);
+        keys[i] = std::make_pair(key, i);
+    }
+    std::sort(keys.begin(), keys.end());
 
-        it->second->setWorldTransform(transform);
-        m_collisionWorld->updateSingleAabb(it->second);
+    std::vector<CullObject> objects(count);
+    std::vector<float> bounds[6] = {m_minX, m_minY, m_minZ, m_maxX, m_maxY, m_maxZ};
+    for (int i = 0; i < count; i++)
+    {
+        int from = keys[i].second;
+        objects[i] = m_objects[from];
+        m_objectIndices[objects[i].userPointer] = i;
+
+        m_minX[i] = bounds[0][from];
+        m_minY[i] = bounds[1][from];
+        m_minZ[i] = bounds[2][from];
+        m_maxX[i] = bounds[3][from];
+        m_maxY[i] = bounds[4][from];
+        m_maxZ[i] = bounds[5][from];
     }
-    else
+    m_objects.swap(objects);
+
+    for (CullLeaf &leaf : m_leaves)
+        leaf.dirty = true;
+}
+
+void CullingManager::refitLeaves()
+{
+    int count = m_objects.size();
+    for (int i = 0; i < m_leaves.size(); i++)
     {
-        // std::cout << "CullingManager::updateObject: object not found" << std::endl;
+        CullLeaf &leaf = m_leaves[i];
+        if (!leaf.dirty)
+            continue;
+
+        int first = i * CULL_LEAF_SIZE;
+        int end = std::min(first + CULL_LEAF_SIZE, count);
+        leaf.aabbMin = glm::vec3(m_minX[first], m_minY[first], m_minZ[first]);
+        leaf.aabbMax = glm::vec3(m_maxX[first], m_maxY[first], m_maxZ[first]);
+        for (int j = first + 1; j < end; j++)
+        {
+            leaf.aabbMin = glm::min(leaf.aabbMin, glm::vec3(m_minX[j], m_minY[j], m_minZ[j]));
+            leaf.aabbMax = glm::max(leaf.aabbMax, glm::vec3(m_maxX[j], m_maxY[j], m_maxZ[j]));
+        }
+        leaf.dirty = false;
     }
 }
 
-btCollisionObject *CullingManager::createCollisionObject(void *userPointer, btCollisionShape *shape, const glm::mat4 &modelMatrix)
+void CullingManager::setupFrame(glm::mat4 viewProjection)
+{
+    calculatePlanes(viewProjection);
+    m_viewProjection = viewProjection;
+
+    m_occlusionStats = OcclusionStats();
+    if (!m_occlusionCulling || m_occluders.empty())
+        return;
+
+    // occluders and planes are not modified until testOcclusion
+    m_occlusionPending = true;
+    m_jobPool->submit(m_occlusionJob, [this]() { rasterizeOccluders(); });
+}
+
+void CullingManager::addOccluder(void *userPointer, const std::vector<glm::vec3> &positions, const std::vector<unsigned int> &indices)
 {
-    btCollisionObject *object = new btCollisionObject();
-    object->setUserPointer(userPointer);
-    object->setCollisionShape(shape);
+    if (positions.empty() || indices.empty())
+        return;
 
-    btTransform transform;
-    transform.setFromOpenGLMatrix((float *)&modelMatrix);
-    object->setWorldTransform(transform);
+    removeOccluder(userPointer);
 
-    m_collisionWorld->addCollisionObject(object);
-    m_collisionObjects[userPointer] = object;
+    Occluder *occluder = new Occluder();
+    occluder->positions = positions;
+    occluder->indices = indices;
+    occluder->aabbMin = positions[0];
+    occluder->aabbMax = positions[0];
+    for (int i = 1; i < positions.size(); i++)
+    {
+        occluder->aabbMin = glm::min(occluder->aabbMin, positions[i]);
+        occluder->aabbMax = glm::max(occluder->aabbMax, positions[i]);
+    }
 
-    return object;
+    m_occluders[userPointer] = occluder;
 }
 
-void CullingManager::setupFrame(glm::mat4 viewProjection)
+void CullingManager::removeOccluder(void *userPointer)
 {
-    calculatePlanes(viewProjection);
+    auto it = m_occluders.find(userPointer);
+    if (it == m_occluders.end())
+        return;
+
+    delete it->second;
+    m_occluders.erase(it);
 }
 
-std::vector<SelectedObject> CullingManager::getObjects(glm::vec3 from, glm::vec3 to)
+void CullingManager::updateOccluder(void *userPointer, const glm::mat4 &modelMatrix)
 {
-    std::vector<SelectedObject> selectedObjects;
+    auto it = m_occluders.find(userPointer);
+    if (it != m_occluders.end())
+        it->second->modelMatrix = modelMatrix;
+}
+
+// runs on a worker
+void CullingManager::rasterizeOccluders()
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    m_occlusionBuffer->clear();
+    for (auto &entry : m_occluders)
+    {
+        Occluder *occluder = entry.second;
+
+        // world bounds of the transformed local box
+        glm::vec3 center = glm::vec3(occluder->modelMatrix * glm::vec4((occluder->aabbMin + occluder->aabbMax) * 0.5f, 1.f));
+        glm::vec3 extents = (occluder->aabbMax - occluder->aabbMin) * 0.5f;
+        glm::mat3 rotation = glm::mat3(occluder->modelMatrix);
+        glm::vec3 worldExtents = glm::abs(rotation[0]) * extents.x + glm::abs(rotation[1]) * extents.y + glm::abs(rotation[2]) * extents.z;
+        if (!inFrustum(center - worldExtents, center + worldExtents, glm::vec3(0.f)))
+            continue;
+
+        m_occlusionBuffer->rasterize(occluder->positions, occluder->indices, m_viewProjection * occluder->modelMatrix);
+        m_occlusionStats.occluderCount++;
+    }
+    m_occlusionBuffer->buildHierarchy();
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_occlusionStats.triangleCount = m_occlusionBuffer->m_triangleCount;
+    m_occlusionStats.rasterTime = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+void CullingManager::testOcclusion(std::vector<SelectedObject> &objects)
+{
+    if (!m_occlusionPending)
+        return;
 
-    btVector3 rayFrom = BulletGLM::getBulletVec3(from);
-    btVector3 rayTo = BulletGLM::getBulletVec3(to);
+    m_jobPool->wait(m_occlusionJob);
+    m_occlusionPending = false;
 
-    btCollisionWorld::AllHitsRayResultCallback rayCallback(rayFrom, rayTo);
+    for (int i = 0; i < objects.size(); i++)
+    {
+        SelectedObject &object = objects[i];
+        object.occluded = !m_occlusionBuffer->isVisible(object.aabbMin, object.aabbMax, m_viewProjection);
+        if (object.occluded)
+            m_occlusionStats.occludedCount++;
+    }
+    m_occlusionStats.testedCount = objects.size();
+}
 
-    // Perform the ray cast against the collision world (dynamicsWorld or others)
-    m_collisionWorld->rayTest(rayFrom, rayTo, rayCallback);
 
-    // Loop through the ray cast results and collect the selected objects
-    for (int i = 0; i < rayCallback.m_hitFractions.size(); i++)
+std::vector<SelectedObject> CullingManager::getObjects(glm::vec3 from, glm::vec3 to)
+{
+    std::vector<SelectedObject> selectedObjects;
+    glm::vec3 dir = to - from;
+
+    for (int i = 0; i < m_objects.size(); i++)
     {
-        const btCollisionObject *object = rayCallback.m_collisionObjects[i];
+        const CullObject &object = m_objects[i];
+        glm::vec3 aabbMin = glm::vec3(m_minX[i], m_minY[i], m_minZ[i]);
+        glm::vec3 aabbMax = glm::vec3(m_maxX[i], m_maxY[i], m_maxZ[i]);
 
-        btTransform t = object->getWorldTransform();
-        btVector3 aabbMin, aabbMax;
-        object->getCollisionShape()->getAabb(t, aabbMin, aabbMax);
+        float t;
+        if (!intersectSegment(from, dir, aabbMin, aabbMax, t))
+            continue;
+
+        if (object.sphere)
+        {
+            // nearest root of |from + dir * t - center| = radius
+            glm::vec3 offset = from - glm::vec3(object.modelMatrix[3]);
+            float radius = object.halfExtents.x;
+            float a = glm::dot(dir, dir);
+            float b = glm::dot(offset, dir);
+            float c = glm::dot(offset, offset) - radius * radius;
+            float discriminant = b * b - a * c;
+            if (discriminant < 0.f)
+                continue;
+
+            t = std::max((-b - std::sqrt(discriminant)) / a, 0.f);
+            if (t > 1.f)
+                continue;
+        }
+        else
+        {
+            // the box in its own space
+            glm::mat4 inverse = glm::inverse(object.modelMatrix);
+            glm::vec3 localFrom = glm::vec3(inverse * glm::vec4(from, 1.f));
+            glm::vec3 localDir = glm::vec3(inverse * glm::vec4(dir, 0.f));
+            if (!intersectSegment(localFrom, localDir, -object.halfExtents, object.halfExtents, t))
+                continue;
+        }
 
         SelectedObject so;
-        so.userPointer = object->getUserPointer();
-        so.aabbMin = BulletGLM::getGLMVec3(aabbMin);
-        so.aabbMax = BulletGLM::getGLMVec3(aabbMax);
-        so.hitPointWorld = BulletGLM::getGLMVec3(rayCallback.m_hitPointWorld[i]);
+        so.userPointer = object.userPointer;
+        so.aabbMin = aabbMin;
+        so.aabbMax = aabbMax;
+        so.hitPointWorld = from + dir * t;
         selectedObjects.push_back(so);
     }
 
@@ -181,44 +484,161 @@ std::vector<SelectedObject> CullingManager::getObjects(glm::vec3 from, glm::vec3
     return selectedObjects;
 }
 
-std::vector<SelectedObject> CullingManager::getObjects(glm::vec3 aabbMin, glm::vec3 aabbMax, glm::vec3 viewPos)
+// leaves are tested against the box and the planes first, objects only against the planes the leaf crosses
+std::vector<SelectedObject> &CullingManager::getObjects(glm::vec3 aabbMin, glm::vec3 aabbMax, glm::vec3 viewPos)
 {
-    // auto start = std::chrono::high_resolution_clock::now();
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if (m_unsortedCount > m_objects.size() / 8)
+        sortObjects();
+    refitLeaves();
 
-    MyOverlapCallback *aabbCallback = new MyOverlapCallback();
-    btBroadphaseAabbCallback *callback = aabbCallback;
+    m_visibleObjects.clear();
+    m_stats.testedLeafCount = 0;
 
-    m_broadphase->aabbTest(BulletGLM::getBulletVec3(aabbMin), BulletGLM::getBulletVec3(aabbMax), *callback);
+    // volumes only read the bounds, the view cull owns the leaves
+    for (CullVolume &volume : m_volumes)
+        m_jobPool->submit(m_volumeJob, [this, &volume]() { cullVolume(volume); });
 
-    // view frustum culling
-    std::vector<SelectedObject> visibleObjects;
-    for (int i = 0; i < aabbCallback->m_overlappingObjects->size(); i++)
+    for (int i = 0; i < m_leaves.size(); i++)
     {
-        btCollisionObject *object = (*aabbCallback->m_overlappingObjects)[i];
+        CullLeaf &leaf = m_leaves[i];
+
+        if (glm::any(glm::lessThan(leaf.aabbMax, aabbMin)) || glm::any(glm::greaterThan(leaf.aabbMin, aabbMax)))
+            continue;
+        bool insideBox = glm::all(glm::greaterThanEqual(leaf.aabbMin, aabbMin)) && glm::all(glm::lessThanEqual(leaf.aabbMax, aabbMax));
+
+        int planeMask = classifyBox(leaf.aabbMin, leaf.aabbMax, m_planes, 6, leaf.lastFailedPlane);
+        if (planeMask == -1)
+            continue;
+
+        if (planeMask != 0 || !insideBox)
+            m_stats.testedLeafCount++;
+        cullLeaf(i, m_planes, planeMask, !insideBox, aabbMin, aabbMax, m_visibleObjects);
+    }
 
-        btTransform t = object->getWorldTransform();
-        btVector3 aabbMin, aabbMax;
-        object->getCollisionShape()->getAabb(t, aabbMin, aabbMax);
+    auto end = std::chrono::high_resolution_clock::now();
+    m_stats.objectCount = m_objects.size();
+    m_stats.leafCount = m_leaves.size();
+    m_stats.visibleCount = m_visibleObjects.size();
+    m_stats.cullTime = std::chrono::duration<float, std::milli>(end - start).count();
+
+    m_jobPool->wait(m_volumeJob);
+    end = std::chrono::high_resolution_clock::now();
+    m_stats.volumeObjectCount = 0;
+    for (const CullVolume &volume : m_volumes)
+        m_stats.volumeObjectCount += volume.objects.size();
+    m_stats.volumeTime = std::chrono::duration<float, std::milli>(end - start).count();
+
+    return m_visibleObjects;
+}
+
+void CullingManager::cullVolume(CullVolume &volume) const
+{
+    volume.objects.clear();
+    volume.testedLeafCount = 0;
+    volume.lastFailedPlanes.resize(m_leaves.size(), 0);
+    int planeCount = volume.planes.size();
+
+    for (int i = 0; i < m_leaves.size(); i++)
+    {
+        const CullLeaf &leaf = m_leaves[i];
+        int planeMask = classifyBox(leaf.aabbMin, leaf.aabbMax, volume.planes.data(), planeCount, volume.lastFailedPlanes[i]);
+        if (planeMask == -1)
+            continue;
+
+        if (planeMask != 0)
+            volume.testedLeafCount++;
+        cullLeaf(i, volume.planes.data(), planeMask, false, leaf.aabbMin, leaf.aabbMax, volume.objects);
+    }
+}
 
-        if (inFrustum(BulletGLM::getGLMVec3(aabbMin), BulletGLM::getGLMVec3(aabbMax), viewPos))
+// 8 objects at a time, a lane survives if no plane in the mask has its positive vertex behind
+void CullingManager::cullLeaf(int leafIndex, const glm::vec4 *planes, int planeMask, bool testBox, const glm::vec3 &aabbMin, const glm::vec3 &aabbMax,
+                              std::vector<SelectedObject> &objects) const
+{
+    int first = leafIndex * CULL_LEAF_SIZE;
+    int end = std::min(first + CULL_LEAF_SIZE, (int)m_objects.size());
+    bool fullyVisible = planeMask == 0 && !testBox;
+
+    for (int group = first; group < end; group += 8)
+    {
+        int visible = end - group >= 8 ? 0xff : (1 << (end - group)) - 1;
+
+        if (!fullyVisible)
         {
+            Lane8 minX = load8(&m_minX[group]), minY = load8(&m_minY[group]), minZ = load8(&m_minZ[group]);
+            Lane8 maxX = load8(&m_maxX[group]), maxY = load8(&m_maxY[group]), maxZ = load8(&m_maxZ[group]);
+
+            if (testBox)
+            {
+                visible &= ~(less8(maxX, set8(aabbMin.x)) | less8(maxY, set8(aabbMin.y)) | less8(maxZ, set8(aabbMin.z)) |
+                             less8(set8(aabbMax.x), minX) | less8(set8(aabbMax.y), minY) | less8(set8(aabbMax.z), minZ));
+            }
+
+            for (int plane = 0; planeMask >> plane && visible; plane++)
+            {
+                if (!(planeMask & (1 << plane)))
+                    continue;
+
+                const glm::vec4 &p = planes[plane];
+                Lane8 distance = add8(add8(mul8(set8(p.x), p.x > 0.f ? maxX : minX),
+                                           mul8(set8(p.y), p.y > 0.f ? maxY : minY)),
+                                      add8(mul8(set8(p.z), p.z > 0.f ? maxZ : minZ), set8(p.w)));
+                visible &= ~less8(distance, set8(0.f));
+            }
+        }
+
+        for (int lane = 0; lane < 8; lane++)
+        {
+            if (!(visible & (1 << lane)))
+                continue;
+
+            int index = group + lane;
             SelectedObject so;
-            so.userPointer = object->getUserPointer();
-            so.aabbMin = BulletGLM::getGLMVec3(aabbMin);
-            so.aabbMax = BulletGLM::getGLMVec3(aabbMax);
-            // TODO: ?
+            so.userPointer = m_objects[index].userPointer;
+            so.aabbMin = glm::vec3(m_minX[index], m_minY[index], m_minZ[index]);
+            so.aabbMax = glm::vec3(m_maxX[index], m_maxY[index], m_maxZ[index]);
             so.hitPointWorld = glm::vec3(0.f);
-            visibleObjects.push_back(so);
+            objects.push_back(so);
         }
     }
+}
 
-    // auto end = std::chrono::high_resolution_clock::now();
-    // auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-    // std::cout << "CullingManager::getObjects: elapsed time: " << duration.count() << " microseconds" << std::endl;
+void CullingManager::debugDraw()
+{
+    if (m_debugDrawer->getDebugMode() == btIDebugDraw::DBG_NoDebug)
+        return;
+
+    btVector3 color(1.f, 1.f, 1.f);
+    for (int i = 0; i < m_objects.size(); i++)
+    {
+        const CullObject &object = m_objects[i];
 
-    delete aabbCallback;
+        // boxes are drawn oriented, spheres as their bounds
+        glm::vec3 corners[8];
+        for (int j = 0; j < 8; j++)
+        {
+            if (object.sphere)
+            {
+                corners[j] = glm::vec3(j & 1 ? m_maxX[i] : m_minX[i], j & 2 ? m_maxY[i] : m_minY[i], j & 4 ? m_maxZ[i] : m_minZ[i]);
+                continue;
+            }
+            glm::vec3 local = glm::vec3(j & 1 ? 1.f : -1.f, j & 2 ? 1.f : -1.f, j & 4 ? 1.f : -1.f) * object.halfExtents;
+            corners[j] = glm::vec3(object.modelMatrix * glm::vec4(local, 1.f));
+        }
 
-    return visibleObjects;
+        // corners differing in one bit share an edge
+        for (int j = 0; j < 8; j++)
+        {
+            for (int bit = 1; bit < 8; bit <<= 1)
+            {
+                if (j & bit)
+                    continue;
+                m_debugDrawer->drawLine(BulletGLM::getBulletVec3(corners[j]), BulletGLM::getBulletVec3(corners[j | bit]), color);
+            }
+        }
+    }
 }
 
 bool CullingManager::inFrustum(const glm::vec3 &aabbMin, const glm::vec3 &aabbMax, const glm::vec3 &viewPos)
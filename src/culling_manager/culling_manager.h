@@ -6,14 +6,16 @@
 #include <map>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
-#include "btBulletDynamicsCommon.h"
 #include <glm/glm.hpp>
 
 #include "../camera/camera.h"
+#include "../job_pool/job_pool.h"
 #include "../physics_world/debug_drawer/debug_drawer.h"
 #include "../utils/bullet_glm.h"
+#include "occlusion_buffer.h"
 
 struct SelectedObject
 {
@@ -21,24 +23,113 @@ struct SelectedObject
     glm::vec3 aabbMax;
     glm::vec3 hitPointWorld;
     void *userPointer;
+    // behind occluders, set by testOcclusion
+    bool occluded = false;
+};
+
+// simplified mesh rasterized into the occlusion buffer
+struct Occluder
+{
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    glm::vec3 aabbMin;
+    glm::vec3 aabbMax;
+    glm::mat4 modelMatrix = glm::mat4(1.f);
+};
+
+struct OcclusionStats
+{
+    // occluders inside the frustum
+    int occluderCount = 0;
+    int triangleCount = 0;
+    int testedCount = 0;
+    int occludedCount = 0;
+    // worker time spent rasterizing, in ms
+    float rasterTime = 0.f;
+};
+
+// cold per object data, the hot bounds are kept apart in arrays
+struct CullObject
+{
+    void *userPointer;
+    glm::mat4 modelMatrix;
+    // half size of a box, radius of a sphere in x
+    glm::vec3 halfExtents;
+    bool sphere;
+};
+
+// fixed size run of objects in the bounds arrays
+struct CullLeaf
+{
+    glm::vec3 aabbMin;
+    glm::vec3 aabbMax;
+    // plane that rejected the leaf last time, tested first
+    int lastFailedPlane = 0;
+    bool dirty = true;
+};
+
+// convex volume culled apart from the view, like the caster volume of a shadow cascade
+// an object is selected if its bounds are not entirely behind one of the planes
+struct CullVolume
+{
+    std::vector<glm::vec4> planes;
+    std::vector<SelectedObject> objects;
+    // plane that rejected each leaf last time
+    std::vector<int> lastFailedPlanes;
+    int testedLeafCount = 0;
+};
+
+struct CullingStats
+{
+    int objectCount = 0;
+    int leafCount = 0;
+    // leaves that needed per object tests
+    int testedLeafCount = 0;
+    int visibleCount = 0;
+    // in ms
+    float cullTime = 0.f;
+    // objects selected by all volumes, duplicates included
+    int volumeObjectCount = 0;
+    // until every volume was culled, overlaps cullTime
+    float volumeTime = 0.f;
 };
 
 class CullingManager
 {
 public:
-    CullingManager();
+    CullingManager(JobPool *jobPool);
     ~CullingManager();
 
     DebugDrawer *m_debugDrawer;
-    btCollisionWorld *m_collisionWorld;
+    JobPool *m_jobPool;
+    CullingStats m_stats;
+
+    // occluders are rasterized on a worker while the frame is set up
+    bool m_occlusionCulling = true;
+    OcclusionBuffer *m_occlusionBuffer;
+    OcclusionStats m_occlusionStats;
 
     void setupFrame(glm::mat4 viewProjection);
-    btCollisionObject *addObject(void *userPointer, const float radius, const glm::mat4 &modelMatrix);
-    btCollisionObject *addObject(void *userPointer, const glm::vec3 &size, const glm::mat4 &modelMatrix);
+    void addObject(void *userPointer, const float radius, const glm::mat4 &modelMatrix);
+    void addObject(void *userPointer, const glm::vec3 &size, const glm::mat4 &modelMatrix);
     void removeObject(void *userPointer);
+    // refits the bounds of the object and its leaf
     void updateObject(void *userPointer, const glm::mat4 &modelMatrix);
     std::vector<SelectedObject> getObjects(glm::vec3 rayFrom, glm::vec3 rayTo);
-    std::vector<SelectedObject> getObjects(glm::vec3 aabbMin, glm::vec3 aabbMax, glm::vec3 viewPos);
+    // objects overlapping the box and the frustum, the result is reused by the next call
+    // m_volumes are culled on the job pool meanwhile and are ready when it returns
+    std::vector<SelectedObject> &getObjects(glm::vec3 aabbMin, glm::vec3 aabbMax, glm::vec3 viewPos);
+    // planes are set by the caller before getObjects
+    std::vector<CullVolume> m_volumes;
+    // object bounds as lines of the debug drawer, when its debug mode is set
+    void debugDraw();
+
+    // occlusion culling, positions are in model space
+    void addOccluder(void *userPointer, const std::vector<glm::vec3> &positions, const std::vector<unsigned int> &indices);
+    void removeOccluder(void *userPointer);
+    void updateOccluder(void *userPointer, const glm::mat4 &modelMatrix);
+    // waits for the occluders of the frame, then marks objects hidden behind them
+    void testOcclusion(std::vector<SelectedObject> &objects);
 
     // frustum culling
     glm::vec4 m_planes[6];
@@ -46,14 +137,32 @@ public:
     bool inFrustum(const glm::vec3 &aabbMin, const glm::vec3 &aabbMax, const glm::vec3 &viewPos);
 
 private:
-    btDefaultCollisionConfiguration *m_collisionConfiguration;
-    btCollisionDispatcher *m_dispatcher;
-    btBroadphaseInterface *m_broadphase;
+    std::vector<CullObject> m_objects;
+    std::unordered_map<void *, int> m_objectIndices;
+    // world bounds by object index, padded to whole simd groups
+    std::vector<float> m_minX, m_minY, m_minZ;
+    std::vector<float> m_maxX, m_maxY, m_maxZ;
+    std::vector<CullLeaf> m_leaves;
+    // objects added or moved by removals since the last reorder along a space filling curve
+    // reordering waits until enough changed, appended objects only loosen their leaves
+    int m_unsortedCount = 0;
+    std::vector<SelectedObject> m_visibleObjects;
 
-    std::map<void *, btCollisionObject *> m_collisionObjects;
+    std::map<void *, Occluder *> m_occluders;
+    glm::mat4 m_viewProjection;
+    JobGroup m_occlusionJob;
+    bool m_occlusionPending = false;
+    JobGroup m_volumeJob;
 
-    void init();
-    btCollisionObject *createCollisionObject(void *id, btCollisionShape *shape, const glm::mat4 &modelMatrix);
+    void addObject(const CullObject &object);
+    void updateBounds(int index);
+    void resizeBounds();
+    void sortObjects();
+    void refitLeaves();
+    void cullLeaf(int leafIndex, const glm::vec4 *planes, int planeMask, bool testBox, const glm::vec3 &aabbMin, const glm::vec3 &aabbMax,
+                  std::vector<SelectedObject> &objects) const;
+    void cullVolume(CullVolume &volume) const;
+    void rasterizeOccluders();
 };
 
 #endif /* culling_manager_hpp */
@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <cmath>
+
+#include "occlusion_buffer.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_SSE
+#include <emmintrin.h>
+#endif
+
+OcclusionBuffer::OcclusionBuffer(int width, int height)
+    : m_tileColumns((width + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE),
+      m_tileRows((height + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE),
+      m_triangleCount(0)
+{
+    m_width = m_tileColumns * OCCLUSION_TILE_SIZE;
+    m_height = m_tileRows * OCCLUSION_TILE_SIZE;
+    m_depth.resize(m_width * m_height, 1.f);
+    m_tileDepth.resize(m_tileColumns * m_tileRows, 1.f);
+}
+
+void OcclusionBuffer::clear()
+{
+    std::fill(m_depth.begin(), m_depth.end(), 1.f);
+    std::fill(m_tileDepth.begin(), m_tileDepth.end(), 1.f);
+    m_triangleCount = 0;
+}
+
+void OcclusionBuffer::rasterize(const std::vector<glm::vec3> &positions, const std::vector<unsigned int> &indices, const glm::mat4 &modelViewProjection)
+{
+    m_clip.resize(positions.size());
+    for (int i = 0; i < positions.size(); i++)
+        m_clip[i] = modelViewProjection * glm::vec4(positions[i], 1.f);
+
+    for (int i = 0; i + 2 < indices.size(); i += 3)
+    {
+        glm::vec4 triangle[3] = {m_clip[indices[i]], m_clip[indices[i + 1]], m_clip[indices[i + 2]]};
+
+        // all vertices outside the same plane
+        bool outside = false;
+        for (int axis = 0; axis < 3 && !outside; axis++)
+        {
+            outside = (triangle[0][axis] > triangle[0].w && triangle[1][axis] > triangle[1].w && triangle[2][axis] > triangle[2].w) ||
+                      (triangle[0][axis] < -triangle[0].w && triangle[1][axis] < -triangle[1].w && triangle[2][axis] < -triangle[2].w);
+        }
+        if (outside)
+            continue;
+
+        if (triangle[0].z >= -triangle[0].w && triangle[1].z >= -triangle[1].w && triangle[2].z >= -triangle[2].w)
+        {
+            rasterizeClipped(triangle, 3);
+            continue;
+        }
+
+        // near plane, z + w >= 0
+        glm::vec4 clipped[4];
+        int count = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            const glm::vec4 &a = triangle[k];
+            const glm::vec4 &b = triangle[(k + 1) % 3];
+            float da = a.z + a.w;
+            float db = b.z + b.w;
+
+            if (da >= 0.f)
+                clipped[count++] = a;
+            if ((da >= 0.f) != (db >= 0.f))
+                clipped[count++] = a + (b - a) * (da / (da - db));
+        }
+        rasterizeClipped(clipped, count);
+    }
+}
+
+void OcclusionBuffer::rasterizeClipped(const glm::vec4 *clip, int count)
+{
+    glm::vec3 screen[4];
+    for (int i = 0; i < count; i++)
+    {
+        glm::vec3 ndc = glm::vec3(clip[i]) / clip[i].w;
+        screen[i] = glm::vec3((ndc.x * 0.5f + 0.5f) * m_width, (ndc.y * 0.5f + 0.5f) * m_height, ndc.z * 0.5f + 0.5f);
+    }
+
+    for (int i = 2; i < count; i++)
+        rasterizeTriangle(screen[0], screen[i - 1], screen[i]);
+}
+
+// half space rasterization at pixel centers, 4 pixels of a row at a time
+void OcclusionBuffer::rasterizeTriangle(const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2)
+{
+    // counter clockwise is positive, back faces and degenerates are skipped
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (area <= 0.f)
+        return;
+
+    int minX = std::max(0, (int)std::floor(std::min(v0.x, std::min(v1.x, v2.x))));
+    int maxX = std::min(m_width - 1, (int)std::ceil(std::max(v0.x, std::max(v1.x, v2.x))));
+    int minY = std::max(0, (int)std::floor(std::min(v0.y, std::min(v1.y, v2.y))));
+    int maxY = std::min(m_height - 1, (int)std::ceil(std::max(v0.y, std::max(v1.y, v2.y))));
+    if (minX > maxX || minY > maxY)
+        return;
+
+    m_triangleCount++;
+
+    // edge i is opposite to vertex i, e = a * x + b * y + c
+    const glm::vec3 *vertices[3] = {&v0, &v1, &v2};
+    float a[3], b[3], c[3];
+    for (int i = 0; i < 3; i++)
+    {
+        const glm::vec3 &from = *vertices[(i + 1) % 3];
+        const glm::vec3 &to = *vertices[(i + 2) % 3];
+        a[i] = from.y - to.y;
+        b[i] = to.x - from.x;
+        c[i] = -(a[i] * from.x + b[i] * from.y);
+    }
+
+    // depth is linear in screen space
+    float dzdx = (a[0] * v0.z + a[1] * v1.z + a[2] * v2.z) / area;
+    float dzdy = (b[0] * v0.z + b[1] * v1.z + b[2] * v2.z) / area;
+    float dz = (c[0] * v0.z + c[1] * v1.z + c[2] * v2.z) / area;
+
+    // rows are a multiple of 4 wide, aligned groups never leave the row
+    int startX = minX & ~3;
+
+    for (int y = minY; y <= maxY; y++)
+    {
+        float py = y + 0.5f;
+        float *row = &m_depth[y * m_width];
+
+#ifdef OCCLUSION_SSE
+        __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        __m128 rowE0 = _mm_set1_ps(b[0] * py + c[0]);
+        __m128 rowE1 = _mm_set1_ps(b[1] * py + c[1]);
+        __m128 rowE2 = _mm_set1_ps(b[2] * py + c[2]);
+        __m128 rowZ = _mm_set1_ps(dzdy * py + dz);
+        __m128 zero = _mm_setzero_ps();
+
+        for (int x = startX; x <= maxX; x += 4)
+        {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+            __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[0]), px), rowE0);
+            __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[1]), px), rowE1);
+            __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[2]), px), rowE2);
+
+            // sign bits of the or are set if any edge is negative
+            __m128 outside = _mm_or_ps(_mm_or_ps(e0, e1), e2);
+            int mask = ~_mm_movemask_ps(outside) & 0xf;
+            if (mask == 0)
+                continue;
+
+            __m128 inside = _mm_cmpge_ps(_mm_min_ps(_mm_min_ps(e0, e1), e2), zero);
+            __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(dzdx), px), rowZ);
+            __m128 depth = _mm_loadu_ps(row + x);
+            __m128 nearer = _mm_min_ps(depth, z);
+            depth = _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, depth));
+            _mm_storeu_ps(row + x, depth);
+        }
+#else
+        for (int x = startX; x <= maxX; x++)
+        {
+            float px = x + 0.5f;
+            float e0 = a[0] * px + b[0] * py + c[0];
+            float e1 = a[1] * px + b[1] * py + c[1];
+            float e2 = a[2] * px + b[2] * py + c[2];
+            if (e0 < 0.f || e1 < 0.f || e2 < 0.f)
+                continue;
+
+            float z = dzdx * px + dzdy * py + dz;
+            row[x] = std::min(row[x], z);
+        }
+#endif
+    }
+}
+
+void OcclusionBuffer::buildHierarchy()
+{
+    for (int ty = 0; ty < m_tileRows; ty++)
+    {
+        for (int tx = 0; tx < m_tileColumns; tx++)
+        {
+            float farthest = 0.f;
+            for (int y = ty * OCCLUSION_TILE_SIZE; y < (ty + 1) * OCCLUSION_TILE_SIZE; y++)
+            {
+                const float *row = &m_depth[y * m_width + tx * OCCLUSION_TILE_SIZE];
+                for (int x = 0; x < OCCLUSION_TILE_SIZE; x++)
+                    farthest = std::max(farthest, row[x]);
+            }
+            m_tileDepth[ty * m_tileColumns + tx] = farthest;
+        }
+    }
+}
+
+// tiles entirely nearer than the box are skipped, the others are checked per pixel
+bool OcclusionBuffer::isVisible(const glm::vec3 &aabbMin, const glm::vec3 &aabbMax, const glm::mat4 &viewProjection) const
+{
+    glm::vec2 screenMin = glm::vec2(m_width, m_height);
+    glm::vec2 screenMax = glm::vec2(0.f);
+    float minZ = 1.f;
+
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec3 corner = glm::vec3(i & 1 ? aabbMax.x : aabbMin.x, i & 2 ? aabbMax.y : aabbMin.y, i & 4 ? aabbMax.z : aabbMin.z);
+        glm::vec4 clip = viewProjection * glm::vec4(corner, 1.f);
+
+        // crosses the near plane
+        if (clip.z < -clip.w)
+            return true;
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        glm::vec2 screen = glm::vec2((ndc.x * 0.5f + 0.5f) * m_width, (ndc.y * 0.5f + 0.5f) * m_height);
+        screenMin = glm::min(screenMin, screen);
+        screenMax = glm::max(screenMax, screen);
+        minZ = std::min(minZ, ndc.z * 0.5f + 0.5f);
+    }
+
+    int minX = std::max(0, (int)std::floor(screenMin.x));
+    int maxX = std::min(m_width - 1, (int)std::floor(screenMax.x));
+    int minY = std::max(0, (int)std::floor(screenMin.y));
+    int maxY = std::min(m_height - 1, (int)std::floor(screenMax.y));
+    if (minX > maxX || minY > maxY)
+        return true;
+
+    for (int ty = minY / OCCLUSION_TILE_SIZE; ty <= maxY / OCCLUSION_TILE_SIZE; ty++)
+    {
+        for (int tx = minX / OCCLUSION_TILE_SIZE; tx <= maxX / OCCLUSION_TILE_SIZE; tx++)
+        {
+            if (m_tileDepth[ty * m_tileColumns + tx] < minZ)
+                continue;
+
+            int startY = std::max(minY, ty * OCCLUSION_TILE_SIZE);
+            int endY = std::min(maxY, (ty + 1) * OCCLUSION_TILE_SIZE - 1);
+            int startX = std::max(minX, tx * OCCLUSION_TILE_SIZE);
+            int endX = std::min(maxX, (tx + 1) * OCCLUSION_TILE_SIZE - 1);
+            for (int y = startY; y <= endY; y++)
+            {
+                for (int x = startX; x <= endX; x++)
+                {
+                    if (m_depth[y * m_width + x] >= minZ)
+                        return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
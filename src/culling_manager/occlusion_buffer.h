@@ -0,0 +1,43 @@
+#ifndef occlusion_buffer_hpp
+#define occlusion_buffer_hpp
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// pixels per side of a depth tile
+#define OCCLUSION_TILE_SIZE 8
+
+// low resolution cpu depth buffer, occluders are rasterized and boxes tested against it without the gpu
+// depth is ndc z mapped to [0, 1], 1 is empty
+class OcclusionBuffer
+{
+public:
+    // width and height are rounded up to whole tiles
+    OcclusionBuffer(int width = 256, int height = 128);
+
+    int m_width, m_height;
+    int m_tileColumns, m_tileRows;
+    std::vector<float> m_depth;
+    // farthest depth of each tile
+    std::vector<float> m_tileDepth;
+    // triangles that reached the rasterizer since clear
+    int m_triangleCount;
+
+    void clear();
+    // back faces are skipped, triangles crossing the near plane are clipped
+    void rasterize(const std::vector<glm::vec3> &positions, const std::vector<unsigned int> &indices, const glm::mat4 &modelViewProjection);
+    // updates the tile depths, call after the last rasterize
+    void buildHierarchy();
+    // conservative, false only if the whole box is behind rasterized depth
+    bool isVisible(const glm::vec3 &aabbMin, const glm::vec3 &aabbMax, const glm::mat4 &viewProjection) const;
+
+private:
+    // clip space vertices of the mesh being rasterized
+    std::vector<glm::vec4> m_clip;
+
+    void rasterizeClipped(const glm::vec4 *clip, int count);
+    void rasterizeTriangle(const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2);
+};
+
+#endif /* occlusion_buffer_hpp */
@@ -15,6 +15,7 @@ Enigine::~Enigine()
     delete renderManager;
     delete inputManager;
     delete mainCamera;
+    delete jobPool;
 
     // cleanup ui
     delete systemMonitorUI;
@@ -106,8 +107,9 @@ int Enigine::init()
 
     shaderManager = new ShaderManager(executablePath);
     resourceManager = new ResourceManager(executablePath);
+    jobPool = new JobPool();
     mainCamera = new Camera(glm::vec3(10.0f, 3.0f, 10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    renderManager = new RenderManager(shaderManager, resourceManager, mainCamera);
+    renderManager = new RenderManager(shaderManager, resourceManager, jobPool, mainCamera);
     updateManager = new UpdateManager();
     inputManager = new InputManager(window);
 
@@ -127,7 +129,7 @@ int Enigine::init()
 
     // UI
     rootUI = new RootUI();
-    systemMonitorUI = new SystemMonitorUI();
+    systemMonitorUI = new SystemMonitorUI(renderManager);
     shadowmapUI = new ShadowmapUI(renderManager->m_shadowManager, renderManager->m_shadowmapManager);
     cameraUI = new CameraUI(mainCamera);
     resourceUI = new ResourceUI(resourceManager);
@@ -179,6 +181,11 @@ void Enigine::start()
         updateManager->update(deltaTime);
         timer.stop("updateManager");
 
+        // Update particles, after updatables set their emission
+        timer.start("particleManager");
+        renderManager->m_particleManager->update(deltaTime);
+        timer.stop("particleManager");
+
         // Update audio listener
         timer.start("soundEngine");
         soundEngine->setListenerPosition(mainCamera->position.x, mainCamera->position.y, mainCamera->position.z);
@@ -201,6 +208,9 @@ void Enigine::start()
         timer.start("renderManager::updateTransforms");
         renderManager->updateTransforms();
         timer.stop("renderManager::updateTransforms");
+        timer.start("renderManager::updateAnimators");
+        renderManager->updateAnimators();
+        timer.stop("renderManager::updateAnimators");
         timer.start("renderManager::renderDepth");
         renderManager->renderDepth();
         for (int i = 0; i < renderManager->m_forwardRenderables.size(); i++)
@@ -228,26 +238,24 @@ void Enigine::start()
 
         // TODO: move debug draws to each Renderable
         unsigned int vao = renderManager->vao;
-        unsigned int vbo = renderManager->vbo;
-        unsigned int ebo = renderManager->ebo;
 
         // Draw physics debug lines
         glm::mat4 mvp = renderManager->m_viewProjection;
-        debugDrawer->drawLines(renderManager->lineShader, mvp, vbo, vao, ebo);
+        debugDrawer->drawLines(renderManager->lineShader, mvp, vao);
 
         // culling debug
         renderManager->m_cullingManager->m_debugDrawer->getLines().clear();
-        renderManager->m_cullingManager->m_collisionWorld->debugDrawWorld();
-        renderManager->m_cullingManager->m_debugDrawer->drawLines(renderManager->lineShader, mvp, vbo, vao, ebo);
+        renderManager->m_cullingManager->debugDraw();
+        renderManager->m_cullingManager->m_debugDrawer->drawLines(renderManager->lineShader, mvp, vao);
 
         // Shadowmap debug
-        shadowmapUI->drawFrustum(renderManager->simpleShader, mvp, vbo, vao, ebo);
-        shadowmapUI->drawFrustumAABB(renderManager->simpleShader, mvp, vbo, vao, ebo);
-        shadowmapUI->drawLightAABB(renderManager->simpleShader, mvp, renderManager->m_inverseDepthViewMatrix, vbo, vao, ebo);
+        shadowmapUI->drawFrustum(renderManager->simpleShader, mvp);
+        shadowmapUI->drawFrustumAABB(renderManager->simpleShader, mvp);
+        shadowmapUI->drawLightAABB(renderManager->simpleShader, mvp, renderManager->m_inverseDepthViewMatrix);
 
         // render manager debug
         renderUI->drawSelectedSource(renderManager->simpleShader, mvp);
-        renderUI->drawSelectedNormals(renderManager->lineShader, mvp, vbo, vao, ebo);
+        renderUI->drawSelectedNormals(renderManager->lineShader, mvp);
         renderUI->drawSelectedArmature(renderManager->simpleShader);
         timer.stop("debugDrawer");
 
@@ -44,6 +44,7 @@
 #include "transform/transform.h"
 #include "update_manager/update_manager.h"
 #include "timer/timer.h"
+#include "job_pool/job_pool.h"
 
 class Enigine
 {
@@ -60,6 +61,7 @@ public:
     RenderManager *renderManager;
     UpdateManager *updateManager;
     InputManager *inputManager;
+    JobPool *jobPool;
 
     GLFWwindow *window;
     float deltaTime;
@@ -0,0 +1,122 @@
+#include <algorithm>
+
+#include "job_pool.h"
+
+JobPool::JobPool(int threadCount)
+    : m_threadCount(threadCount),
+      m_stop(false)
+{
+    if (m_threadCount <= 0)
+        m_threadCount = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+
+    for (int i = 0; i < m_threadCount; i++)
+        m_threads.push_back(std::thread(&JobPool::workerLoop, this));
+}
+
+JobPool::~JobPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_condition.notify_all();
+
+    for (int i = 0; i < m_threads.size(); i++)
+        m_threads[i].join();
+    m_threads.clear();
+}
+
+void JobPool::submit(JobGroup &group, std::function<void()> function)
+{
+    group.pending++;
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_jobs.push_back(Job{std::move(function), &group});
+    }
+    m_condition.notify_one();
+}
+
+void JobPool::wait(JobGroup &group)
+{
+    while (group.pending.load() > 0)
+    {
+        Job job;
+        if (tryPop(job))
+        {
+            run(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [&] { return group.pending.load() == 0 || !m_jobs.empty(); });
+    }
+}
+
+void JobPool::parallelFor(int count, const std::function<void(int start, int end)> &function, int minChunkSize)
+{
+    if (count <= 0)
+        return;
+
+    // a few chunks per thread to balance uneven jobs
+    int chunkCount = (m_threadCount + 1) * 4;
+    int chunkSize = std::max(minChunkSize, (count + chunkCount - 1) / chunkCount);
+
+    if (chunkSize >= count)
+    {
+        function(0, count);
+        return;
+    }
+
+    JobGroup group;
+    for (int start = 0; start < count; start += chunkSize)
+    {
+        int end = std::min(start + chunkSize, count);
+        submit(group, [&function, start, end] { function(start, end); });
+    }
+
+    wait(group);
+}
+
+void JobPool::workerLoop()
+{
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+
+            if (m_stop && m_jobs.empty())
+                return;
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        run(job);
+    }
+}
+
+bool JobPool::tryPop(Job &job)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_jobs.empty())
+        return false;
+
+    job = std::move(m_jobs.front());
+    m_jobs.pop_front();
+    return true;
+}
+
+void JobPool::run(Job &job)
+{
+    job.function();
+
+    if (--job.group->pending == 0)
+    {
+        // waiters sleep on the same condition as the workers
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.notify_all();
+    }
+}
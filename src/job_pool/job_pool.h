@@ -0,0 +1,51 @@
+#ifndef job_pool_hpp
+#define job_pool_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// jobs submitted together, waited together
+struct JobGroup
+{
+    std::atomic<int> pending{0};
+};
+
+struct Job
+{
+    std::function<void()> function;
+    JobGroup *group;
+};
+
+class JobPool
+{
+public:
+    // threadCount 0 uses every hardware thread except the calling one
+    JobPool(int threadCount = 0);
+    ~JobPool();
+
+    int m_threadCount;
+
+    void submit(JobGroup &group, std::function<void()> function);
+    // runs queued jobs on the calling thread until the group is done
+    void wait(JobGroup &group);
+    // splits [0, count) into chunks of at least minChunkSize and blocks until all chunks are done
+    void parallelFor(int count, const std::function<void(int start, int end)> &function, int minChunkSize = 1);
+
+private:
+    std::vector<std::thread> m_threads;
+    std::deque<Job> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stop;
+
+    void workerLoop();
+    bool tryPop(Job &job);
+    void run(Job &job);
+};
+
+#endif /* job_pool_hpp */
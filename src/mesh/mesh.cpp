@@ -1,50 +1,67 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include <glm/gtc/packing.hpp>
+
+#include "../render_manager/geometry_pool.h"
 #include "mesh.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
 
-Mesh::Mesh(std::string name, std::vector<Vertex> vertices, std::vector<unsigned int> indices, glm::vec3 aabbMin, glm::vec3 aabbMax, Material *material)
+Mesh::Mesh(std::string name, std::vector<Vertex> vertices, std::vector<unsigned int> indices, glm::vec3 aabbMin, glm::vec3 aabbMax, Material *material,
+           VertexLayout layout)
     : name(name),
       vertices(vertices),
       aabbMin(aabbMin),
       aabbMax(aabbMax),
       indices(indices),
-      material(material)
+      material(material),
+      layout(layout)
 {
+    lods.push_back(MeshLod{0, (int)this->indices.size(), 0.f});
+    if (this->vertices.size() < 65536)
+        indexType = GL_UNSIGNED_SHORT;
     setupMesh();
 }
 
 Mesh::~Mesh()
 {
+    if (pool)
+        pool->remove(this);
+
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
 }
 
-void Mesh::draw(Shader shader)
+void Mesh::draw(Shader &shader)
 {
     bindTextures(shader);
     bindProperties(shader);
 
     glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, indices.size(), indexType, 0);
     glBindVertexArray(0);
 
     unbindTextures(shader);
     unbindProperties(shader);
 }
 
-void Mesh::drawInstanced(Shader shader, int instanceCount)
+void Mesh::drawInstanced(Shader &shader, int instanceCount)
 {
     bindTextures(shader);
     bindProperties(shader);
 
     glBindVertexArray(VAO);
-    glDrawElementsInstanced(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0, instanceCount);
+    glDrawElementsInstanced(GL_TRIANGLES, indices.size(), indexType, 0, instanceCount);
     glBindVertexArray(0);
 
     unbindTextures(shader);
     unbindProperties(shader);
 }
 
-void Mesh::bindTextures(Shader shader)
+void Mesh::bindTextures(Shader &shader)
 {
     // bind appropriate textures
     unsigned int diffuseNr = 1;
@@ -60,31 +77,39 @@ void Mesh::bindTextures(Shader shader)
     {
         glActiveTexture(GL_TEXTURE0 + i);
 
-        std::string number;
-        std::string name = material->textures[i]->type;
+        int number = 0;
+        const std::string &name = material->textures[i]->type;
         if (name == "texture_diffuse")
-            number = std::to_string(diffuseNr++);
+            number = diffuseNr++;
         else if (name == "texture_specular")
-            number = std::to_string(specularNr++);
+            number = specularNr++;
         else if (name == "texture_normal")
-            number = std::to_string(normalNr++);
+            number = normalNr++;
         else if (name == "texture_height")
-            number = std::to_string(heightNr++);
+            number = heightNr++;
         else if (name == "texture_rough")
-            number = std::to_string(roughNr++);
+            number = roughNr++;
         else if (name == "texture_ao")
-            number = std::to_string(aoNr++);
+            number = aoNr++;
         else if (name == "texture_metal")
-            number = std::to_string(metalNr++);
+            number = metalNr++;
         else if (name == "texture_opacity")
-            number = std::to_string(opacityNr++);
+            number = opacityNr++;
         else if (name == "texture_unknown")
-            number = std::to_string(unknownNr++);
+            number = unknownNr++;
+
+        // names are hashed in parts instead of concatenated for every draw
+        char numberText[12] = "";
+        if (number > 0)
+            snprintf(numberText, sizeof(numberText), "%d", number);
+
+        uint32_t samplerHash = hashUniformName(numberText, hashUniformName(name.c_str()));
+        uint32_t uvScaleHash = hashUniformName(numberText, hashUniformName(name.c_str(), hashUniformName("uvScale_")));
 
-        glUniform1i(glGetUniformLocation(shader.id, (name + number).c_str()), i);
+        shader.setInt(UniformName(samplerHash), i);
         glBindTexture(GL_TEXTURE_2D, material->textures[i]->id);
 
-        shader.setVec2("uvScale_" + name + number, material->textures[i]->uvScale);
+        shader.setVec2(UniformName(uvScaleHash), material->textures[i]->uvScale);
     }
 
     shader.setBool("material.albedoMap", diffuseNr > 1);
@@ -97,7 +122,7 @@ void Mesh::bindTextures(Shader shader)
     shader.setBool("material.aoRoughMetalMap", unknownNr > 1);
 }
 
-void Mesh::unbindTextures(Shader shader)
+void Mesh::unbindTextures(Shader &shader)
 {
     for (unsigned int i = 0; i < material->textures.size(); i++)
     {
@@ -115,7 +140,7 @@ void Mesh::unbindTextures(Shader shader)
     shader.setBool("material.aoRoughMetalMap", false);
 }
 
-void Mesh::bindProperties(Shader shader)
+void Mesh::bindProperties(Shader &shader)
 {
     shader.setVec2("material.uvScale", material->uvScale);
     shader.setVec4("material.albedo", material->albedo);
@@ -137,7 +162,7 @@ void Mesh::bindProperties(Shader shader)
 }
 
 // TODO: remove?
-void Mesh::unbindProperties(Shader shader)
+void Mesh::unbindProperties(Shader &shader)
 {
     shader.setVec2("material.uvScale", glm::vec2(1.f));
     shader.setVec4("material.albedo", glm::vec4(1.f));
@@ -171,10 +196,136 @@ void Mesh::setupMesh()
     // A great thing about structs is that their memory layout is sequential for all its items.
     // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
     // again translates to 3/2 floats which translates to a byte array.
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+    if (layout == VertexLayout::packedStatic)
+    {
+        std::vector<PackedVertex> packed(vertices.size());
+        for (int i = 0; i < vertices.size(); i++)
+            packed[i] = packVertex(vertices[i]);
+        glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedVertex), packed.data(), GL_STATIC_DRAW);
+    }
+    else if (layout == VertexLayout::packedSkinned)
+    {
+        std::vector<PackedSkinnedVertex> packed(vertices.size());
+        for (int i = 0; i < vertices.size(); i++)
+            packed[i] = packSkinnedVertex(vertices[i]);
+        glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedSkinnedVertex), packed.data(), GL_STATIC_DRAW);
+    }
+    else
+    {
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+    }
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+    uploadIndices();
+
+    setupVertexAttributes(layout);
+
+    glBindVertexArray(0);
+}
+
+// each level is simplified from the full mesh so its error is measured against the original
+void Mesh::generateLods(const MeshLodSettings &settings)
+{
+    lods.resize(1);
+    lodIndices.clear();
+
+    int triangleCount = indices.size() / 3;
+    if (!settings.enabled || triangleCount < settings.minTriangleCount)
+        return;
+
+    int previousCount = indices.size();
+    float ratio = 1.f;
+    for (int i = 0; i < settings.maxLodCount; i++)
+    {
+        ratio *= settings.reduction;
+        int targetCount = (int)(triangleCount * ratio) * 3;
+        if (targetCount < 3)
+            break;
+
+        float error;
+        std::vector<unsigned int> lod = MeshSimplifier::simplify(vertices, indices, targetCount, settings.maxError, error);
+
+        // stuck on locked or high error regions, further levels would not be smaller
+        if (lod.size() > previousCount * 0.9f)
+            break;
+
+        // collapses keep the input order, which is no longer cache friendly around merged vertices
+        MeshOptimizer::optimizeVertexCache(lod, vertices.size());
+
+        lods.push_back(MeshLod{(int)(indices.size() + lodIndices.size()), (int)lod.size(), error});
+        lodIndices.insert(lodIndices.end(), lod.begin(), lod.end());
+        previousCount = lod.size();
+    }
+
+    if (lodIndices.empty())
+        return;
+
+    // element array binding is vertex array state
+    glBindVertexArray(VAO);
+    uploadIndices();
+    glBindVertexArray(0);
+}
+
+const MeshLod &Mesh::getLod(int level) const
+{
+    return lods[std::clamp(level, 0, (int)lods.size() - 1)];
+}
+
+int Mesh::getIndexSize() const
+{
+    return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+}
+
+// expects the vertex array bound
+void Mesh::uploadIndices()
+{
+    size_t indexCount = indices.size() + lodIndices.size();
+    if (indexType == GL_UNSIGNED_SHORT)
+    {
+        std::vector<uint16_t> elements;
+        elements.reserve(indexCount);
+        elements.insert(elements.end(), indices.begin(), indices.end());
+        elements.insert(elements.end(), lodIndices.begin(), lodIndices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(uint16_t), elements.data(), GL_STATIC_DRAW);
+    }
+    else
+    {
+        std::vector<unsigned int> elements = indices;
+        elements.insert(elements.end(), lodIndices.begin(), lodIndices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), elements.data(), GL_STATIC_DRAW);
+    }
+}
+
+size_t Mesh::getVertexBufferSize() const
+{
+    return vertices.size() * getVertexSize(layout);
+}
+
+void Mesh::setupVertexAttributes(VertexLayout layout)
+{
+    if (layout != VertexLayout::standard)
+    {
+        // same locations as the standard layout, no bitangent, shaders rebuild it from the tangent sign
+        int stride = getVertexSize(layout);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void *)offsetof(PackedVertex, position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void *)offsetof(PackedVertex, normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void *)offsetof(PackedVertex, texCoords));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void *)offsetof(PackedVertex, tangent));
+        glDisableVertexAttribArray(4);
+
+        if (layout == VertexLayout::packedSkinned)
+        {
+            glEnableVertexAttribArray(5);
+            glVertexAttribIPointer(5, 4, GL_UNSIGNED_BYTE, stride, (void *)offsetof(PackedSkinnedVertex, boneIDs));
+            glEnableVertexAttribArray(6);
+            glVertexAttribPointer(6, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void *)offsetof(PackedSkinnedVertex, weights));
+        }
+        return;
+    }
 
     // set the vertex attribute pointers
     // vertex Positions
@@ -198,6 +349,66 @@ void Mesh::setupMesh()
     // weights - for animation
     glEnableVertexAttribArray(6);
     glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, weights));
+}
 
-    glBindVertexArray(0);
+int Mesh::getVertexSize(VertexLayout layout)
+{
+    if (layout == VertexLayout::packedStatic)
+        return sizeof(PackedVertex);
+    if (layout == VertexLayout::packedSkinned)
+        return sizeof(PackedSkinnedVertex);
+    return sizeof(Vertex);
+}
+
+PackedVertex Mesh::packVertex(const Vertex &vertex)
+{
+    PackedVertex packed;
+    packed.position = vertex.position;
+
+    // missing normals and tangents stay zero
+    glm::vec3 normal = glm::length(vertex.normal) > 0.f ? glm::normalize(vertex.normal) : glm::vec3(0.f);
+    glm::vec3 tangent = glm::length(vertex.tangent) > 0.f ? glm::normalize(vertex.tangent) : glm::vec3(0.f);
+    float sign = glm::dot(glm::cross(normal, tangent), vertex.bitangent) < 0.f ? -1.f : 1.f;
+
+    packed.normal = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.f));
+    packed.tangent = glm::packSnorm3x10_1x2(glm::vec4(tangent, sign));
+    packed.texCoords[0] = glm::packHalf1x16(vertex.texCoords.x);
+    packed.texCoords[1] = glm::packHalf1x16(vertex.texCoords.y);
+    return packed;
+}
+
+PackedSkinnedVertex Mesh::packSkinnedVertex(const Vertex &vertex)
+{
+    PackedVertex base = packVertex(vertex);
+
+    PackedSkinnedVertex packed;
+    packed.position = base.position;
+    packed.normal = base.normal;
+    packed.tangent = base.tangent;
+    packed.texCoords[0] = base.texCoords[0];
+    packed.texCoords[1] = base.texCoords[1];
+
+    float total = 0.f;
+    for (int i = 0; i < MAX_BONE_PER_VERTEX; i++)
+        total += vertex.boneIDs[i] >= 0 ? vertex.weights[i] : 0.f;
+
+    // quantization error goes to the largest influence so weights still sum to one
+    int sum = 0;
+    int largest = 0;
+    for (int i = 0; i < MAX_BONE_PER_VERTEX; i++)
+    {
+        bool used = vertex.boneIDs[i] >= 0 && total > 0.f;
+        // larger ids are clamped, Model keeps such meshes in the standard layout
+        packed.boneIDs[i] = used ? (uint8_t)std::min(vertex.boneIDs[i], MAX_PACKED_BONE_ID) : 0;
+        packed.weights[i] = used ? (uint8_t)std::round(vertex.weights[i] / total * 255.f) : 0;
+        sum += packed.weights[i];
+
+        if (packed.weights[i] > packed.weights[largest])
+            largest = i;
+    }
+
+    if (sum > 0)
+        packed.weights[largest] = (uint8_t)(packed.weights[largest] + 255 - sum);
+
+    return packed;
 }
@@ -1,12 +1,17 @@
 #ifndef mesh_hpp
 #define mesh_hpp
 
+#include <cstdint>
 #include <string>
 
 #include "../material/material.h"
 #include "../shader/shader.h"
 
 #define MAX_BONE_PER_VERTEX 4
+// bone ids of the packed skinned layout are 8 bit
+#define MAX_PACKED_BONE_ID 255
+
+class GeometryPool;
 namespace enigine
 {
 struct Vertex
@@ -19,14 +24,70 @@ struct Vertex
     int boneIDs[MAX_BONE_PER_VERTEX];
     float weights[MAX_BONE_PER_VERTEX];
 };
+
+// gpu vertex of static meshes, 24 bytes
+// normal and tangent are snorm 10:10:10:2, tangent w keeps the bitangent sign
+struct PackedVertex
+{
+    glm::vec3 position;
+    uint32_t normal;
+    uint32_t tangent;
+    // half floats
+    uint16_t texCoords[2];
+};
+
+// gpu vertex of skinned meshes, 32 bytes
+// unused influences have bone 0 with a zero weight
+struct PackedSkinnedVertex
+{
+    glm::vec3 position;
+    uint32_t normal;
+    uint32_t tangent;
+    uint16_t texCoords[2];
+    uint8_t boneIDs[MAX_BONE_PER_VERTEX];
+    // unorm8, sums to 255
+    uint8_t weights[MAX_BONE_PER_VERTEX];
+};
 } // namespace enigine
 using namespace enigine;
 
+// lod generation at import
+struct MeshLodSettings
+{
+    bool enabled = true;
+    // detail levels below the full mesh
+    int maxLodCount = 3;
+    // triangle ratio of each level to the previous one
+    float reduction = 0.5f;
+    // meshes with fewer triangles keep a single level
+    int minTriangleCount = 256;
+    // relative to the mesh extent
+    float maxError = 0.05f;
+};
+
+// index range of a detail level in the element buffer
+struct MeshLod
+{
+    int firstIndex;
+    int indexCount;
+    // relative to the mesh extent
+    float error;
+};
+
+// layout of the vertex buffer on the gpu, cpu side vertices are always Vertex
+enum class VertexLayout
+{
+    standard,
+    packedStatic,
+    packedSkinned
+};
+
 class Mesh
 {
 public:
     // Constructors
-    Mesh(std::string name, std::vector<Vertex> vertices, std::vector<unsigned int> indices, glm::vec3 aabbMin, glm::vec3 aabbMax, Material *material);
+    Mesh(std::string name, std::vector<Vertex> vertices, std::vector<unsigned int> indices, glm::vec3 aabbMin, glm::vec3 aabbMax, Material *material,
+         VertexLayout layout = VertexLayout::standard);
     Mesh()
     {
     }
@@ -39,16 +100,44 @@ public:
     glm::vec3 aabbMin;
     glm::vec3 aabbMax;
     Material *material;
+    VertexLayout layout = VertexLayout::standard;
     glm::mat4 offset = glm::mat4(1.0f);
+    // lods[0] is the full mesh, coarser levels share the vertices and follow indices in the element buffer
+    std::vector<MeshLod> lods;
+    std::vector<unsigned int> lodIndices;
+    // element buffer is 16 bit when every vertex fits, cpu side indices stay 32 bit
+    unsigned int indexType = GL_UNSIGNED_INT;
+    // suballocation in a shared static geometry pool, offset is baked into the pooled vertices
+    // poolVAO is 0 when the mesh is only in its own buffers
+    unsigned int poolVAO = 0;
+    int poolBaseVertex = 0;
+    int poolFirstIndex = 0;
+    // releases the ranges when the mesh is deleted
+    GeometryPool *pool = nullptr;
     // Functions
-    void draw(Shader shader);
-    void drawInstanced(Shader shader, int instanceCount);
+    void draw(Shader &shader);
+    void drawInstanced(Shader &shader, int instanceCount);
 
     void setupMesh();
-    void bindTextures(Shader shader);
-    void unbindTextures(Shader shader);
-    void bindProperties(Shader shader);
-    void unbindProperties(Shader shader);
+    // bytes of the vertex buffer on the gpu
+    size_t getVertexBufferSize() const;
+    // bytes per index in the element buffer
+    int getIndexSize() const;
+    // full mesh followed by the lod levels
+    void uploadIndices();
+    void generateLods(const MeshLodSettings &settings);
+    // clamped to the coarsest level
+    const MeshLod &getLod(int level) const;
+
+    // attribute layout for the bound vertex array and buffer
+    static void setupVertexAttributes(VertexLayout layout);
+    static int getVertexSize(VertexLayout layout);
+    static PackedVertex packVertex(const Vertex &vertex);
+    static PackedSkinnedVertex packSkinnedVertex(const Vertex &vertex);
+    void bindTextures(Shader &shader);
+    void unbindTextures(Shader &shader);
+    void bindProperties(Shader &shader);
+    void unbindProperties(Shader &shader);
 };
 
 #endif /* mesh_hpp */
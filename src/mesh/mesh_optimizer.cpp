@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <cmath>
+
+#include "mesh_optimizer.h"
+
+// lru size the scores are tuned for
+#define VERTEX_CACHE_SIZE 32
+
+struct VertexScoreTable
+{
+    float cache[VERTEX_CACHE_SIZE + 3];
+    float valence[64];
+
+    VertexScoreTable()
+    {
+        // last triangle's vertices get a fixed score so the next one doesn't reuse all three
+        for (int i = 0; i < VERTEX_CACHE_SIZE + 3; i++)
+        {
+            if (i < 3)
+                cache[i] = 0.75f;
+            else if (i < VERTEX_CACHE_SIZE)
+                cache[i] = std::pow(1.f - (float)(i - 3) / (VERTEX_CACHE_SIZE - 3), 1.5f);
+            else
+                cache[i] = 0.f;
+        }
+
+        // few remaining triangles are boosted to finish a vertex off
+        valence[0] = 0.f;
+        for (int i = 1; i < 64; i++)
+            valence[i] = 2.f / std::sqrt((float)i);
+    }
+
+    float get(int cachePosition, int remaining) const
+    {
+        if (remaining == 0)
+            return -1.f;
+
+        float score = cachePosition < 0 ? 0.f : cache[cachePosition];
+        return score + valence[std::min(remaining, 63)];
+    }
+};
+
+void MeshOptimizer::optimizeVertexCache(std::vector<unsigned int> &indices, int vertexCount)
+{
+    static const VertexScoreTable table;
+
+    int triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // triangles of each vertex, packed
+    std::vector<int> remaining(vertexCount, 0);
+    for (unsigned int index : indices)
+        remaining[index]++;
+
+    std::vector<int> offsets(vertexCount + 1, 0);
+    for (int i = 0; i < vertexCount; i++)
+        offsets[i + 1] = offsets[i] + remaining[i];
+
+    std::vector<int> vertexTriangles(indices.size());
+    std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+    for (int i = 0; i < indices.size(); i++)
+        vertexTriangles[fill[indices[i]]++] = i / 3;
+
+    std::vector<float> vertexScores(vertexCount);
+    for (int i = 0; i < vertexCount; i++)
+        vertexScores[i] = table.get(-1, remaining[i]);
+
+    auto getTriangleScore = [&](int t) {
+        return vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+    };
+
+    std::vector<bool> emitted(triangleCount, false);
+    int bestTriangle = 0;
+    for (int t = 1; t < triangleCount; t++)
+    {
+        if (getTriangleScore(t) > getTriangleScore(bestTriangle))
+            bestTriangle = t;
+    }
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+
+    int cache[VERTEX_CACHE_SIZE + 3];
+    int cacheCount = 0;
+    int newCache[VERTEX_CACHE_SIZE + 3];
+
+    int cursor = 0;
+
+    while (bestTriangle != -1)
+    {
+        emitted[bestTriangle] = true;
+        const unsigned int *corners = &indices[bestTriangle * 3];
+        result.insert(result.end(), corners, corners + 3);
+
+        // emitted vertices move to the front, the rest keep their order
+        int newCount = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int vertex = corners[k];
+            newCache[newCount++] = vertex;
+
+            // drop the triangle from the vertex's list
+            int *begin = &vertexTriangles[offsets[vertex]];
+            int *end = begin + remaining[vertex];
+            *std::find(begin, end, bestTriangle) = *(end - 1);
+            remaining[vertex]--;
+        }
+        for (int i = 0; i < cacheCount; i++)
+        {
+            int vertex = cache[i];
+            if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2])
+                newCache[newCount++] = vertex;
+        }
+
+        for (int i = VERTEX_CACHE_SIZE; i < newCount; i++)
+            vertexScores[newCache[i]] = table.get(-1, remaining[newCache[i]]);
+
+        cacheCount = std::min(newCount, VERTEX_CACHE_SIZE);
+        std::copy(newCache, newCache + cacheCount, cache);
+
+        for (int i = 0; i < cacheCount; i++)
+            vertexScores[cache[i]] = table.get(i, remaining[cache[i]]);
+
+        // only triangles touching the cache changed their score
+        bestTriangle = -1;
+        float bestScore = -1.f;
+        for (int i = 0; i < cacheCount; i++)
+        {
+            int vertex = cache[i];
+            for (int j = offsets[vertex]; j < offsets[vertex] + remaining[vertex]; j++)
+            {
+                int t = vertexTriangles[j];
+                float score = getTriangleScore(t);
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        // dead end, continue with the next triangle in input order
+        if (bestTriangle == -1)
+        {
+            while (cursor < triangleCount && emitted[cursor])
+                cursor++;
+            if (cursor < triangleCount)
+                bestTriangle = cursor;
+        }
+    }
+
+    indices = result;
+}
+
+struct TriangleCluster
+{
+    int first;
+    int count;
+    float sortKey;
+};
+
+void MeshOptimizer::optimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<Vertex> &vertices, int cacheSize)
+{
+    int triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // a cluster starts where all three vertices miss a fifo cache, moving it costs no extra transforms
+    std::vector<int> cacheTimes(vertices.size(), -cacheSize - 1);
+    int time = 0;
+    std::vector<TriangleCluster> clusters;
+    for (int t = 0; t < triangleCount; t++)
+    {
+        int misses = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int vertex = indices[t * 3 + k];
+            if (time - cacheTimes[vertex] > cacheSize)
+            {
+                cacheTimes[vertex] = time++;
+                misses++;
+            }
+        }
+
+        if (misses == 3 || clusters.empty())
+            clusters.push_back(TriangleCluster{t, 0, 0.f});
+        clusters.back().count++;
+    }
+
+    if (clusters.size() == 1)
+        return;
+
+    glm::vec3 meshCenter = glm::vec3(0.f);
+    for (const Vertex &vertex : vertices)
+        meshCenter += vertex.position;
+    meshCenter /= (float)vertices.size();
+
+    // clusters facing away from the center are likely in front of the ones behind them
+    for (TriangleCluster &cluster : clusters)
+    {
+        glm::vec3 center = glm::vec3(0.f);
+        glm::vec3 normal = glm::vec3(0.f);
+        float area = 0.f;
+        for (int t = cluster.first; t < cluster.first + cluster.count; t++)
+        {
+            const glm::vec3 &a = vertices[indices[t * 3]].position;
+            const glm::vec3 &b = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3 &c = vertices[indices[t * 3 + 2]].position;
+
+            glm::vec3 cross = glm::cross(b - a, c - a);
+            float triangleArea = glm::length(cross);
+            center += (a + b + c) * (triangleArea / 3.f);
+            normal += cross;
+            area += triangleArea;
+        }
+
+        if (area > 0.f)
+            center /= area;
+        float normalLength = glm::length(normal);
+        if (normalLength > 0.f)
+            normal /= normalLength;
+
+        cluster.sortKey = glm::dot(center - meshCenter, normal);
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), [](const TriangleCluster &a, const TriangleCluster &b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (const TriangleCluster &cluster : clusters)
+        result.insert(result.end(), indices.begin() + cluster.first * 3, indices.begin() + (cluster.first + cluster.count) * 3);
+
+    indices = result;
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+{
+    std::vector<int> remap(vertices.size(), -1);
+    std::vector<Vertex> result;
+    result.reserve(vertices.size());
+
+    for (unsigned int &index : indices)
+    {
+        if (remap[index] == -1)
+        {
+            remap[index] = result.size();
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices = result;
+}
+
+float MeshOptimizer::getAcmr(const std::vector<unsigned int> &indices, int vertexCount, int cacheSize)
+{
+    int triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return 0.f;
+
+    std::vector<int> cacheTimes(vertexCount, -cacheSize - 1);
+    int time = 0;
+    int misses = 0;
+    for (unsigned int index : indices)
+    {
+        if (time - cacheTimes[index] > cacheSize)
+        {
+            cacheTimes[index] = time++;
+            misses++;
+        }
+    }
+
+    return (float)misses / triangleCount;
+}
@@ -0,0 +1,22 @@
+#ifndef mesh_optimizer_hpp
+#define mesh_optimizer_hpp
+
+#include <vector>
+
+#include "mesh.h"
+
+// triangle and vertex reordering of imported meshes, the rendered result is unchanged
+class MeshOptimizer
+{
+public:
+    // forsyth's linear speed ordering for a small lru post transform cache
+    static void optimizeVertexCache(std::vector<unsigned int> &indices, int vertexCount);
+    // splits the cache ordered list where the cache is cold anyway and draws outward facing clusters first
+    static void optimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<Vertex> &vertices, int cacheSize = 16);
+    // vertices in first use order, unreferenced ones are dropped
+    static void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices);
+    // average cache miss ratio, transformed vertices per triangle with a fifo cache
+    static float getAcmr(const std::vector<unsigned int> &indices, int vertexCount, int cacheSize = 16);
+};
+
+#endif /* mesh_optimizer_hpp */
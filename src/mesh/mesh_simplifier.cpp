@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+#include "mesh_simplifier.h"
+
+// symmetric 4x4 matrix of the squared distance to a set of planes
+struct Quadric
+{
+    // xx xy xz xw yy yz yw zz zw ww
+    double m[10] = {};
+
+    void addPlane(const glm::dvec3 &n, double d)
+    {
+        m[0] += n.x * n.x;
+        m[1] += n.x * n.y;
+        m[2] += n.x * n.z;
+        m[3] += n.x * d;
+        m[4] += n.y * n.y;
+        m[5] += n.y * n.z;
+        m[6] += n.y * d;
+        m[7] += n.z * n.z;
+        m[8] += n.z * d;
+        m[9] += d * d;
+    }
+
+    void add(const Quadric &other)
+    {
+        for (int i = 0; i < 10; i++)
+            m[i] += other.m[i];
+    }
+
+    double evaluate(const glm::vec3 &p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double value = m[0] * x * x + 2.0 * m[1] * x * y + 2.0 * m[2] * x * z + 2.0 * m[3] * x +
+                       m[4] * y * y + 2.0 * m[5] * y * z + 2.0 * m[6] * y +
+                       m[7] * z * z + 2.0 * m[8] * z +
+                       m[9];
+        return std::max(value, 0.0);
+    }
+};
+
+struct Collapse
+{
+    double cost;
+    unsigned int from;
+    unsigned int to;
+
+    bool operator>(const Collapse &other) const { return cost > other.cost; }
+};
+
+struct PositionHash
+{
+    size_t operator()(const glm::vec3 &p) const
+    {
+        uint32_t bits[3];
+        std::memcpy(bits, &p, sizeof(bits));
+        return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+    }
+};
+
+static glm::vec3 getNormal(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+{
+    return glm::cross(b - a, c - a);
+}
+
+std::vector<unsigned int> MeshSimplifier::simplify(const std::vector<Vertex> &vertices,
+                                                   const std::vector<unsigned int> &indices,
+                                                   int targetIndexCount, float maxError, float &error)
+{
+    error = 0.f;
+    int vertexCount = vertices.size();
+    int triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || indices.size() <= targetIndexCount)
+        return indices;
+
+    glm::vec3 min = vertices[0].position;
+    glm::vec3 max = vertices[0].position;
+    for (int i = 1; i < vertexCount; i++)
+    {
+        min = glm::min(min, vertices[i].position);
+        max = glm::max(max, vertices[i].position);
+    }
+    double extent = std::max((double)glm::length(max - min), 1e-6);
+    double maxCost = (maxError * extent) * (maxError * extent);
+
+    // seams share a position with another vertex
+    std::vector<bool> locked(vertexCount, false);
+    std::unordered_map<glm::vec3, int, PositionHash> positions;
+    for (int i = 0; i < vertexCount; i++)
+    {
+        auto it = positions.find(vertices[i].position);
+        if (it == positions.end())
+        {
+            positions[vertices[i].position] = i;
+            continue;
+        }
+
+        locked[i] = true;
+        locked[it->second] = true;
+    }
+
+    // open borders have edges used by a single triangle
+    std::unordered_map<uint64_t, int> edgeCounts;
+    for (int i = 0; i < triangleCount * 3; i++)
+    {
+        unsigned int a = indices[i];
+        unsigned int b = indices[i % 3 == 2 ? i - 2 : i + 1];
+        uint64_t key = ((uint64_t)std::min(a, b) << 32) | std::max(a, b);
+        edgeCounts[key]++;
+    }
+    for (auto &edge : edgeCounts)
+    {
+        if (edge.second != 1)
+            continue;
+        locked[edge.first >> 32] = true;
+        locked[edge.first & 0xffffffff] = true;
+    }
+
+    std::vector<unsigned int> triangles = indices;
+    std::vector<bool> removed(triangleCount, false);
+    std::vector<std::vector<int>> vertexTriangles(vertexCount);
+    std::vector<Quadric> quadrics(vertexCount);
+
+    for (int t = 0; t < triangleCount; t++)
+    {
+        const glm::vec3 &a = vertices[triangles[t * 3]].position;
+        const glm::vec3 &b = vertices[triangles[t * 3 + 1]].position;
+        const glm::vec3 &c = vertices[triangles[t * 3 + 2]].position;
+
+        glm::dvec3 normal = glm::dvec3(getNormal(a, b, c));
+        double length = glm::length(normal);
+        if (length > 0.0)
+            normal /= length;
+        double d = -glm::dot(normal, glm::dvec3(a));
+
+        for (int k = 0; k < 3; k++)
+        {
+            quadrics[triangles[t * 3 + k]].addPlane(normal, d);
+            vertexTriangles[triangles[t * 3 + k]].push_back(t);
+        }
+    }
+
+    std::vector<unsigned int> remap(vertexCount);
+    for (int i = 0; i < vertexCount; i++)
+        remap[i] = i;
+
+    auto getCost = [&](unsigned int from, unsigned int to) {
+        Quadric quadric = quadrics[from];
+        quadric.add(quadrics[to]);
+        return quadric.evaluate(vertices[to].position);
+    };
+
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+    for (int i = 0; i < triangleCount * 3; i++)
+    {
+        unsigned int a = triangles[i];
+        unsigned int b = triangles[i % 3 == 2 ? i - 2 : i + 1];
+        if (!locked[a])
+            queue.push(Collapse{getCost(a, b), a, b});
+        if (!locked[b])
+            queue.push(Collapse{getCost(b, a), b, a});
+    }
+
+    int liveCount = triangleCount;
+    double maxCollapseCost = 0.0;
+    while (liveCount * 3 > targetIndexCount && !queue.empty())
+    {
+        Collapse collapse = queue.top();
+        queue.pop();
+
+        unsigned int from = collapse.from;
+        unsigned int to = collapse.to;
+        while (remap[to] != to)
+            to = remap[to];
+        if (remap[from] != from || from == to)
+            continue;
+
+        // quadrics only grow, a stale entry is re-queued with its current cost
+        double cost = getCost(from, to);
+        if (to != collapse.to || cost > collapse.cost * 1.0001 + 1e-12)
+        {
+            queue.push(Collapse{cost, from, to});
+            continue;
+        }
+
+        if (cost > maxCost)
+            break;
+
+        // reject collapses that fold a remaining triangle over
+        bool valid = true;
+        for (int t : vertexTriangles[from])
+        {
+            if (removed[t])
+                continue;
+
+            unsigned int *corners = &triangles[t * 3];
+            if (corners[0] == to || corners[1] == to || corners[2] == to)
+                continue;
+
+            glm::vec3 before = getNormal(vertices[corners[0]].position, vertices[corners[1]].position, vertices[corners[2]].position);
+            glm::vec3 moved[3];
+            for (int k = 0; k < 3; k++)
+                moved[k] = vertices[corners[k] == from ? to : corners[k]].position;
+            glm::vec3 after = getNormal(moved[0], moved[1], moved[2]);
+
+            float beforeLength = glm::length(before);
+            float afterLength = glm::length(after);
+            if (afterLength <= 0.f || (beforeLength > 0.f && glm::dot(before, after) < 0.2f * beforeLength * afterLength))
+            {
+                valid = false;
+                break;
+            }
+        }
+        if (!valid)
+            continue;
+
+        remap[from] = to;
+        quadrics[to].add(quadrics[from]);
+        maxCollapseCost = std::max(maxCollapseCost, cost);
+
+        for (int t : vertexTriangles[from])
+        {
+            if (removed[t])
+                continue;
+
+            unsigned int *corners = &triangles[t * 3];
+            for (int k = 0; k < 3; k++)
+            {
+                if (corners[k] == from)
+                    corners[k] = to;
+            }
+
+            if (corners[0] == corners[1] || corners[1] == corners[2] || corners[0] == corners[2])
+            {
+                removed[t] = true;
+                liveCount--;
+                continue;
+            }
+
+            vertexTriangles[to].push_back(t);
+        }
+        vertexTriangles[from].clear();
+
+        // costs around the merged vertex changed
+        for (int t : vertexTriangles[to])
+        {
+            if (removed[t])
+                continue;
+
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int other = triangles[t * 3 + k];
+                if (other == to)
+                    continue;
+                if (!locked[other])
+                    queue.push(Collapse{getCost(other, to), other, to});
+                if (!locked[to])
+                    queue.push(Collapse{getCost(to, other), to, other});
+            }
+        }
+    }
+
+    std::vector<unsigned int> result;
+    result.reserve(liveCount * 3);
+    for (int t = 0; t < triangleCount; t++)
+    {
+        if (removed[t])
+            continue;
+        result.insert(result.end(), &triangles[t * 3], &triangles[t * 3] + 3);
+    }
+
+    error = (float)(std::sqrt(maxCollapseCost) / extent);
+    return result;
+}
@@ -0,0 +1,19 @@
+#ifndef mesh_simplifier_hpp
+#define mesh_simplifier_hpp
+
+#include <vector>
+
+#include "mesh.h"
+
+// quadric error edge collapse, vertices are only removed, the vertex buffer is shared by every level
+// seams and open borders are locked so uv charts and outlines stay intact
+class MeshSimplifier
+{
+public:
+    // returns the reduced index list, error is the largest collapse error relative to the mesh extent
+    static std::vector<unsigned int> simplify(const std::vector<Vertex> &vertices,
+                                              const std::vector<unsigned int> &indices,
+                                              int targetIndexCount, float maxError, float &error);
+};
+
+#endif /* mesh_simplifier_hpp */
@@ -1,4 +1,5 @@
 #include "model.h"
+#include "../mesh/mesh_optimizer.h"
 
 Model::Model(ResourceManager *resourceManager, std::string const &path)
     : m_resourceManager(resourceManager),
@@ -45,7 +46,7 @@ Model::~Model()
     meshes.clear();
 }
 
-void Model::draw(Shader shader, bool drawOpaque)
+void Model::draw(Shader &shader, bool drawOpaque)
 {
     if (drawOpaque)
     {
@@ -65,7 +66,7 @@ void Model::draw(Shader shader, bool drawOpaque)
     }
 }
 
-void Model::drawInstanced(Shader shader, int instanceCount)
+void Model::drawInstanced(Shader &shader, int instanceCount)
 {
     for (unsigned int i = 0; i < meshes.size(); i++)
     {
@@ -93,10 +94,11 @@ void Model::loadModel(std::string const &path)
     unsigned int start = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 
     // read file via ASSIMP
-    m_scene = m_importer->ReadFile(path,
-                                   aiProcessPreset_TargetRealtime_MaxQuality |
-                                       aiProcess_FlipUVs |
-                                       aiProcess_GenBoundingBoxes);
+    // assimp's cache locality step is replaced by the mesh optimizer
+    unsigned int flags = aiProcessPreset_TargetRealtime_MaxQuality | aiProcess_FlipUVs | aiProcess_GenBoundingBoxes;
+    if (m_resourceManager->m_optimizeMeshes)
+        flags &= ~aiProcess_ImproveCacheLocality;
+    m_scene = m_importer->ReadFile(path, flags);
 
     // check for errors
     if (!m_scene || m_scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !m_scene->mRootNode) // if is Not Zero
@@ -128,10 +130,33 @@ void Model::loadModel(std::string const &path)
         aabbMax.z = std::max(aabbMax.z, meshes[i]->aabbMax.z);
     }
 
+    size_t vertexBufferSize = 0;
+    size_t standardSize = 0;
+    size_t indexBufferSize = 0;
+    size_t wideIndexSize = 0;
+    int triangleCount = 0;
+    for (int i = 0; i < meshes.size(); i++)
+    {
+        vertexBufferSize += meshes[i]->getVertexBufferSize();
+        standardSize += meshes[i]->vertices.size() * sizeof(Vertex);
+
+        size_t indexCount = meshes[i]->indices.size() + meshes[i]->lodIndices.size();
+        indexBufferSize += indexCount * meshes[i]->getIndexSize();
+        wideIndexSize += indexCount * sizeof(unsigned int);
+        triangleCount += meshes[i]->indices.size() / 3;
+    }
+    triangleCount = std::max(triangleCount, 1);
+    float acmrBefore = std::round(m_cacheMissesBefore / triangleCount * 100.f) / 100.f;
+    float acmrAfter = std::round(m_cacheMissesAfter / triangleCount * 100.f) / 100.f;
+
     unsigned int end = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
     unsigned int duration = end - start;
     std::string fileName = path.substr(path.find_last_of('/'), path.size());
-    std::cout << std::setfill(' ') << std::setw(4) << duration << "ms - Model - " << fileName << std::endl;
+    std::cout << std::setfill(' ') << std::setw(4) << duration << "ms - Model - " << fileName
+              << " - vertices: " << vertexBufferSize / 1024 << "/" << standardSize / 1024 << " KB"
+              << " - indices: " << indexBufferSize / 1024 << "/" << wideIndexSize / 1024 << " KB"
+              << " - acmr: " << acmrBefore << " -> " << acmrAfter
+              << std::endl;
 }
 
 void Model::processNode(aiNode *node, glm::mat4 parentTransform)
@@ -224,12 +249,49 @@ Mesh *Model::processMesh(aiMesh *mesh)
     // animation
     extractBoneWeightForVertices(vertices, mesh);
 
-    return new Mesh(mesh->mName.C_Str(),
-                    vertices,
-                    indices,
-                    AssimpToGLM::getGLMVec3(mesh->mAABB.mMin),
-                    AssimpToGLM::getGLMVec3(mesh->mAABB.mMax),
-                    mat);
+    // triangle order for the post transform cache, then overdraw, vertex order follows the final indices
+    int triangleCount = indices.size() / 3;
+    m_cacheMissesBefore += MeshOptimizer::getAcmr(indices, vertices.size()) * triangleCount;
+    if (m_resourceManager->m_optimizeMeshes)
+    {
+        MeshOptimizer::optimizeVertexCache(indices, vertices.size());
+        MeshOptimizer::optimizeOverdraw(indices, vertices);
+        MeshOptimizer::optimizeVertexFetch(vertices, indices);
+    }
+    m_cacheMissesAfter += MeshOptimizer::getAcmr(indices, vertices.size()) * triangleCount;
+
+    // bone data is only uploaded for skinned meshes
+    VertexLayout layout = VertexLayout::standard;
+    if (m_resourceManager->m_packVertices)
+        layout = mesh->HasBones() ? VertexLayout::packedSkinned : VertexLayout::packedStatic;
+
+    if (layout == VertexLayout::packedSkinned)
+    {
+        int maxBoneID = -1;
+        for (const Vertex &vertex : vertices)
+        {
+            for (int i = 0; i < MAX_BONE_PER_VERTEX; i++)
+                maxBoneID = std::max(maxBoneID, vertex.boneIDs[i]);
+        }
+
+        if (maxBoneID > MAX_PACKED_BONE_ID)
+        {
+            std::cout << "Model: " << mesh->mName.C_Str() << " uses bone id " << maxBoneID
+                      << ", over the packed limit of " << MAX_PACKED_BONE_ID << ", kept in the standard layout" << std::endl;
+            layout = VertexLayout::standard;
+        }
+    }
+
+    Mesh *result = new Mesh(mesh->mName.C_Str(),
+                            vertices,
+                            indices,
+                            AssimpToGLM::getGLMVec3(mesh->mAABB.mMin),
+                            AssimpToGLM::getGLMVec3(mesh->mAABB.mMax),
+                            mat,
+                            layout);
+    result->generateLods(m_resourceManager->m_meshLod);
+
+    return result;
 }
 
 // TODO: move to resource manager
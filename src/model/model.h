@@ -56,11 +56,15 @@ public:
     Assimp::Importer *m_importer;
     const aiScene *m_scene;
 
-    void draw(Shader shader, bool drawOpaque = true);
-    void drawInstanced(Shader shader, int instanceCount);
+    void draw(Shader &shader, bool drawOpaque = true);
+    void drawInstanced(Shader &shader, int instanceCount);
     void updateMeshTypes();
 
 private:
+    // transformed vertices over all meshes before and after the import optimization, for the load log
+    float m_cacheMissesBefore = 0.f;
+    float m_cacheMissesAfter = 0.f;
+
     void loadModel(std::string const &path);
     void processNode(aiNode *node, glm::mat4 parentTransform);
     Mesh *processMesh(aiMesh *mesh);
@@ -0,0 +1,246 @@
+// cpu pool against transform feedback for one dense emitter, built with ENIGINE_BUILD_BENCHMARKS
+// run from the build directory, shaders are read from assets/shaders
+// usage: particle_benchmark [live particles] [frames]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "../shader/shader.h"
+#include "../shader_manager/shader_manager.h"
+#include "../stream_buffer/stream_buffer.h"
+#include "particle_feedback.h"
+#include "particle_pool.h"
+
+#define BENCHMARK_WIDTH 1280
+#define BENCHMARK_HEIGHT 720
+#define BENCHMARK_WARMUP 240
+#define BENCHMARK_DELTA_TIME (1.f / 60.f)
+
+// looking at the emitter from the side
+static const glm::vec3 viewPosition(0.f, 0.f, -20.f);
+
+struct BenchmarkResult
+{
+    int liveCount;
+    // cpu time of the simulation, 0 on the gpu
+    float simulationTime;
+    float frameTime;
+};
+
+// milliseconds since the first call, small enough to keep float precision
+static float getTime()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void setDrawUniforms(Shader &shader)
+{
+    glm::mat4 viewProjection(0.1f);
+    viewProjection[2][2] = 0.01f;
+    viewProjection[3][3] = 1.f;
+
+    shader.use();
+    shader.setMat4("u_viewProjection", viewProjection);
+    shader.setVec3("u_worldOrigin", glm::vec3(0.f));
+    shader.setVec3("u_viewPosition", viewPosition);
+    shader.setFloat("u_particleScale", 0.02f);
+}
+
+// emission carries the fraction of a particle to the next frame, both backends emit the same counts
+static int getEmitCount(float rate, float &carry)
+{
+    float particles = rate * BENCHMARK_DELTA_TIME + carry;
+    int count = (int)particles;
+    carry = particles - count;
+    return count;
+}
+
+// pool step, packing and the stream upload, drawn as billboards from the uploaded points
+static BenchmarkResult runCpu(Shader &billboardShader, const ParticleEmission &emission, float rate, int capacity, int frames)
+{
+    ParticlePool pool(capacity, 1234u);
+    StreamBuffer buffer;
+    std::vector<Particle> instances;
+    unsigned int vao;
+    glGenVertexArrays(1, &vao);
+
+    float carry = 0.f;
+    float start = 0.f;
+    float simulationTime = 0.f;
+    for (int frame = 0; frame < BENCHMARK_WARMUP + frames; frame++)
+    {
+        if (frame == BENCHMARK_WARMUP)
+        {
+            glFinish();
+            start = getTime();
+            simulationTime = 0.f;
+        }
+
+        StreamBuffer::beginFrame();
+
+        float simulationStart = getTime();
+        pool.emit(getEmitCount(rate, carry), emission);
+        pool.integrate(BENCHMARK_DELTA_TIME, viewPosition);
+        instances.resize(pool.m_count);
+        pool.pack(instances.data());
+        simulationTime += getTime() - simulationStart;
+
+        size_t offset = buffer.upload(instances.data(), instances.size() * sizeof(Particle));
+
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer.m_buffer);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (void *)offset);
+
+        setDrawUniforms(billboardShader);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glDrawArrays(GL_POINTS, 0, instances.size());
+        glBindVertexArray(0);
+
+        glFinish();
+    }
+
+    float frameTime = (getTime() - start) / frames;
+    glDeleteVertexArrays(1, &vao);
+
+    return BenchmarkResult{pool.m_count, simulationTime / frames, frameTime};
+}
+
+// feedback step and the draw of the captured points, nothing is uploaded
+static BenchmarkResult runGpu(Shader &updateShader, Shader &billboardShader, const ParticleEmission &emission, float rate, int capacity, int frames)
+{
+    ParticleFeedback feedback(capacity, &updateShader, 1234u);
+
+    float carry = 0.f;
+    float start = 0.f;
+    for (int frame = 0; frame < BENCHMARK_WARMUP + frames; frame++)
+    {
+        if (frame == BENCHMARK_WARMUP)
+        {
+            glFinish();
+            start = getTime();
+        }
+
+        feedback.simulate(BENCHMARK_DELTA_TIME, getEmitCount(rate, carry), emission, viewPosition);
+
+        setDrawUniforms(billboardShader);
+        glClear(GL_COLOR_BUFFER_BIT);
+        feedback.draw();
+
+        glFinish();
+    }
+
+    float frameTime = (getTime() - start) / frames;
+
+    // live count stays on the gpu, the billboard geometry shader emits two triangles per particle
+    unsigned int query;
+    glGenQueries(1, &query);
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBeginQuery(GL_PRIMITIVES_GENERATED, query);
+    setDrawUniforms(billboardShader);
+    feedback.draw();
+    glEndQuery(GL_PRIMITIVES_GENERATED);
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    unsigned int primitives = 0;
+    glGetQueryObjectuiv(query, GL_QUERY_RESULT, &primitives);
+    glDeleteQueries(1, &query);
+
+    return BenchmarkResult{(int)primitives / 2, 0.f, frameTime};
+}
+
+int main(int argc, char **argv)
+{
+    int liveCount = argc > 1 ? atoi(argv[1]) : 100000;
+    int frames = argc > 2 ? atoi(argv[2]) : 120;
+
+    if (!glfwInit())
+    {
+        fprintf(stderr, "particle_benchmark: glfw init failed\n");
+        return 1;
+    }
+
+    // same context as the engine, never shown
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow(BENCHMARK_WIDTH, BENCHMARK_HEIGHT, "particle_benchmark", NULL, NULL);
+    if (!window)
+    {
+        fprintf(stderr, "particle_benchmark: window creation failed\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+
+    glewExperimental = true;
+    if (glewInit() != GLEW_OK)
+    {
+        fprintf(stderr, "particle_benchmark: glew init failed\n");
+        glfwTerminate();
+        return 1;
+    }
+    printf("%s, %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+
+    {
+        // hidden windows may have no pixels, drawn offscreen instead
+        unsigned int framebuffer, renderbuffer;
+        glGenFramebuffers(1, &framebuffer);
+        glGenRenderbuffers(1, &renderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffer);
+        glViewport(0, 0, BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        // shaders of the engine, the billboard with a particle effect as RenderManager builds it
+        ShaderManager shaderManager(".");
+        Shader updateShader;
+        Shader billboardShader;
+        updateShader.m_feedbackVaryings = ParticleFeedback::getVaryings();
+        shaderManager.addShader(ShaderDynamic(&updateShader, "assets/shaders/particle-update.vs", "assets/shaders/particle-update.fs", "assets/shaders/particle-update.gs"));
+        shaderManager.addShader(ShaderDynamic(&billboardShader, "assets/shaders/particle-billboard.vs", "assets/shaders/smoke.fs", "assets/shaders/particle-billboard.gs"));
+
+        ParticleEmission emission;
+        emission.position = glm::vec3(0.f);
+        emission.direction = glm::vec3(0.f, 1.f, 0.f);
+        emission.randomness = 1.f;
+        emission.minVelocity = 0.5f;
+        emission.maxVelocity = 2.f;
+        emission.minDuration = 1.f;
+        emission.maxDuration = 3.f;
+
+        // mean duration of 2 seconds, the capacity leaves room for the variance
+        float rate = liveCount / 2.f;
+        int capacity = liveCount * 3 / 2;
+
+        BenchmarkResult cpu = runCpu(billboardShader, emission, rate, capacity, frames);
+        BenchmarkResult gpu = runGpu(updateShader, billboardShader, emission, rate, capacity, frames);
+
+        printf("cpu: live: %d, frame: %.3f ms, simulation: %.3f ms, upload and draw: %.3f ms\n",
+               cpu.liveCount, cpu.frameTime, cpu.simulationTime, cpu.frameTime - cpu.simulationTime);
+        printf("gpu: live: %d, frame: %.3f ms\n", gpu.liveCount, gpu.frameTime);
+
+        GLenum error = glGetError();
+        if (error != GL_NO_ERROR)
+            fprintf(stderr, "particle_benchmark: gl error 0x%x\n", error);
+
+        glDeleteRenderbuffers(1, &renderbuffer);
+        glDeleteFramebuffers(1, &framebuffer);
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
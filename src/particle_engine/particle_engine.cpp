@@ -1,23 +1,29 @@
 #include "particle_engine.h"
 
-float randomFloat(float min, float max);
-
-ParticleEngine::ParticleEngine(ResourceManager *resourceManager, Model *particleCopy, Camera *viewCamera)
-    : m_viewCamera(viewCamera)
+ParticleEngine::ParticleEngine(ResourceManager *resourceManager, Model *particleCopy, Camera *viewCamera, int maxParticles)
+    : m_viewCamera(viewCamera),
+      m_backend(ParticleBackend::cpu),
+      m_feedback(nullptr),
+      m_feedbackTime(0.f),
+      m_feedbackEmission(0)
 {
     m_model = resourceManager->getModelFullPath(particleCopy->m_path, true);
-    setupBuffer();
+    m_pool = new ParticlePool(maxParticles, (uint32_t)rand());
+    m_arrayBuffer = nullptr;
 }
 
 ParticleEngine::~ParticleEngine()
 {
     delete m_model;
+    delete m_pool;
+    delete m_feedback;
+    delete m_arrayBuffer;
 }
 
-void ParticleEngine::setupBuffer()
+// the instance attributes follow the particle buffer to the offset of its last upload
+void ParticleEngine::setupBuffer(unsigned int buffer, size_t offset)
 {
-    glGenBuffers(1, &m_arrayBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, m_arrayBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
 
     for (size_t i = 0; i < m_model->meshes.size(); i++)
     {
@@ -27,22 +33,22 @@ void ParticleEngine::setupBuffer()
         float size = sizeof(Particle);
 
         glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, size, (void *)0);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, size, (void *)offset);
 
         glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, size, (void *)offsetof(Particle, emitPosition));
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, size, (void *)(offset + offsetof(Particle, emitPosition)));
 
         glEnableVertexAttribArray(5);
-        glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, size, (void *)offsetof(Particle, velocity));
+        glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, size, (void *)(offset + offsetof(Particle, velocity)));
 
         glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 1, GL_FLOAT, GL_FALSE, size, (void *)offsetof(Particle, duration));
+        glVertexAttribPointer(6, 1, GL_FLOAT, GL_FALSE, size, (void *)(offset + offsetof(Particle, duration)));
 
         glEnableVertexAttribArray(7);
-        glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, size, (void *)offsetof(Particle, maxDuration));
+        glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, size, (void *)(offset + offsetof(Particle, maxDuration)));
 
         glEnableVertexAttribArray(8);
-        glVertexAttribPointer(8, 1, GL_FLOAT, GL_FALSE, size, (void *)offsetof(Particle, distance));
+        glVertexAttribPointer(8, 1, GL_FLOAT, GL_FALSE, size, (void *)(offset + offsetof(Particle, distance)));
 
         glVertexAttribDivisor(3, 1);
         glVertexAttribDivisor(4, 1);
@@ -55,75 +61,93 @@ void ParticleEngine::setupBuffer()
     glBindVertexArray(0);
 }
 
-void ParticleEngine::update(float deltaTime)
+void ParticleEngine::setBackend(ParticleBackend backend, Shader *updateShader)
 {
-    emitParticles(deltaTime);
-    updateParticles(deltaTime);
+    if (backend == m_backend)
+        return;
 
-    // TODO: optional - when?
-    // std::sort(m_particles.begin(), m_particles.end(), [](Particle a, Particle b)
-    //           { return a.distance > b.distance; });
+    // particles are not carried over
+    m_backend = backend;
+    m_pool->clear();
+    delete m_feedback;
+    m_feedback = nullptr;
+    m_feedbackTime = 0.f;
+    m_feedbackEmission = 0;
 
-    // for (int i = 0; i < m_particles.size(); i++)
-    // {
-    //     Particle &particle = m_particles[i];
-    //     std::cout << "sorted: index: " << i << ", distance: " << particle.distance << std::endl;
-    // }
+    if (m_backend == ParticleBackend::gpu)
+        m_feedback = new ParticleFeedback(m_pool->m_capacity, updateShader, (uint32_t)rand());
 }
 
-void ParticleEngine::updateParticles(float deltaTime)
+void ParticleEngine::update(float deltaTime)
 {
-    for (int i = 0; i < m_particles.size();)
+    int emitCount = getEmitCount(deltaTime);
+
+    if (m_backend == ParticleBackend::gpu)
     {
-        // update
-        Particle &particle = m_particles[i];
-        particle.duration -= deltaTime;
-        particle.position += particle.velocity * deltaTime;
-        particle.distance = glm::distance(m_viewCamera->position, particle.position);
-
-        // velocity change?
-
-        if (particle.duration < 0.f)
-            m_particles.erase(m_particles.begin() + i);
-        else
-            ++i;
+        m_feedbackTime += deltaTime;
+        m_feedbackEmission += emitCount;
+        return;
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_arrayBuffer);
-    glBufferData(GL_ARRAY_BUFFER, m_particles.size() * sizeof(Particle), m_particles.data(), GL_STATIC_DRAW);
+    m_pool->emit(emitCount, getEmission());
+    updateParticles(deltaTime);
 }
 
-void ParticleEngine::emitParticles(float deltaTime)
+void ParticleEngine::updateParticles(float deltaTime)
 {
-    int newParticle = deltaTime * m_particlesPerSecond;
+    m_pool->integrate(deltaTime, m_viewCamera->position);
+}
+
+int ParticleEngine::getEmitCount(float deltaTime)
+{
+    // the fraction of a particle is emitted with its probability
+    float particles = deltaTime * m_particlesPerSecond * m_emissionScale;
+    int newParticle = (int)particles;
+    if (m_pool->random() < particles - newParticle)
+        newParticle++;
+
+    return newParticle;
+}
 
-    // if 0 - emit with probabilty
-    if (newParticle == 0)
+ParticleEmission ParticleEngine::getEmission()
+{
+    ParticleEmission emission;
+    emission.position = m_position;
+    emission.direction = m_direction;
+    emission.randomness = m_randomness;
+    emission.minVelocity = m_minVelocity;
+    emission.maxVelocity = m_maxVelocity;
+    emission.minDuration = m_minDuration;
+    emission.maxDuration = m_maxDuration;
+    return emission;
+}
+
+// TODO: instancing - compute shaders
+void ParticleEngine::drawParticles(Shader *shader, glm::mat4 viewProjection, glm::vec3 worldOrigin)
+{
+    if (m_backend == ParticleBackend::gpu)
     {
-        float particleProbabilty = deltaTime * m_particlesPerSecond;
-        float probabilty = randomFloat(0.f, 1.f);
-        if (probabilty < particleProbabilty)
-        {
-            newParticle = 1;
-        }
+        drawFeedback(shader, viewProjection, worldOrigin);
+        return;
     }
 
-    for (int i = 0; i < newParticle; i++)
-    {
-        float duration = randomFloat(m_minDuration, m_maxDuration);
-        float velocityForce = randomFloat(m_minVelocity, m_maxVelocity);
+    if (m_pool->m_count == 0)
+        return;
 
-        glm::vec3 randomVector = glm::sphericalRand(1.0f);
-        glm::vec3 velocityDirection = glm::normalize(m_direction + m_randomness * randomVector);
+    if (!m_arrayBuffer)
+        m_arrayBuffer = new StreamBuffer();
 
-        m_particles.push_back(Particle(m_position, m_position, velocityDirection * velocityForce, duration, duration));
-    }
+    // uploaded when drawn, on the gl thread and only for drawn engines
+    m_instances.resize(m_pool->m_count);
+    m_pool->pack(m_instances.data());
+    int offset = m_arrayBuffer->upload(m_instances.data(), m_instances.size() * sizeof(Particle));
+
+    drawInstances(shader, viewProjection, worldOrigin, m_arrayBuffer->m_buffer, offset, m_instances.size());
 }
 
-// TODO: instancing - compute shaders
-void ParticleEngine::drawParticles(Shader *shader, glm::mat4 viewProjection, glm::vec3 worldOrigin)
+void ParticleEngine::drawInstances(Shader *shader, glm::mat4 viewProjection, glm::vec3 worldOrigin, unsigned int buffer, size_t offset, int count)
 {
-    if (m_particles.empty())
+    if (count == 0)
         return;
 
     shader->use();
@@ -132,11 +156,30 @@ void ParticleEngine::drawParticles(Shader *shader, glm::mat4 viewProjection, glm
     shader->setVec3("u_viewPosition", m_viewCamera->position);
     shader->setFloat("u_particleScale", m_particleScale);
 
-    m_model->drawInstanced(*shader, m_particles.size());
+    setupBuffer(buffer, offset);
+
+    m_model->drawInstanced(*shader, count);
 }
 
-float randomFloat(float min, float max)
+// steps the pending time first, nothing is uploaded
+void ParticleEngine::drawFeedback(Shader *shader, glm::mat4 viewProjection, glm::vec3 worldOrigin)
 {
-    float random = ((float)rand()) / (float)RAND_MAX;
-    return min + (random * (max - min));
+    if (m_feedbackTime > 0.f)
+    {
+        m_feedback->simulate(m_feedbackTime, m_feedbackEmission, getEmission(), m_viewCamera->position);
+        m_feedbackTime = 0.f;
+        m_feedbackEmission = 0;
+    }
+
+    shader->use();
+    shader->setMat4("u_viewProjection", viewProjection);
+    shader->setVec3("u_worldOrigin", worldOrigin);
+    shader->setVec3("u_viewPosition", m_viewCamera->position);
+    shader->setFloat("u_particleScale", m_particleScale);
+
+    // textures of the effect, as the instanced draw binds them
+    Mesh *mesh = m_model->meshes[0];
+    mesh->bindTextures(*shader);
+    m_feedback->draw();
+    mesh->unbindTextures(*shader);
 }
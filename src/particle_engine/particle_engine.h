@@ -8,42 +8,46 @@
 #include <vector>
 
 #include <glm/glm.hpp>
-#include <glm/gtc/random.hpp>
 
 #include "../shader/shader.h"
 #include "../model/model.h"
 #include "../camera/camera.h"
+#include "../stream_buffer/stream_buffer.h"
+#include "particle_feedback.h"
+#include "particle_pool.h"
 
-struct Particle
+enum class ParticleBackend
 {
-    glm::vec3 position;
-    glm::vec3 emitPosition;
-    glm::vec3 velocity;
-    float duration;
-    float maxDuration;
-    float distance;
-
-    Particle(glm::vec3 position, glm::vec3 emitPosition, glm::vec3 velocity, float duration, float maxDuration)
-        : position(position),
-          emitPosition(emitPosition),
-          velocity(velocity),
-          duration(duration),
-          maxDuration(maxDuration) {}
+    // pool simulated on the cpu, instances uploaded every draw
+    cpu,
+    // transform feedback, for dense effects, drawn as billboards from points
+    gpu
 };
 
 class ParticleEngine
 {
 public:
-    ParticleEngine(ResourceManager *resourceManager, Model *particleCopy, Camera *viewCamera);
+    ParticleEngine(ResourceManager *resourceManager, Model *particleCopy, Camera *viewCamera, int maxParticles = 4096);
     ~ParticleEngine();
+    // gpu engines only count the emission here, the step runs with their next draw on the gl thread
     void update(float deltaTime);
+    // updateShader links the feedback varyings, the draw shader of a gpu engine takes points
+    // see RenderManager::setParticleBackend for sources
+    void setBackend(ParticleBackend backend, Shader *updateShader = nullptr);
+    // packs and uploads its own particles
     void drawParticles(Shader *shader, glm::mat4 viewProjection, glm::vec3 worldOrigin);
+    // count instances already uploaded to buffer at offset
+    void drawInstances(Shader *shader, glm::mat4 viewProjection, glm::vec3 worldOrigin, unsigned int buffer, size_t offset, int count);
 
     // TODO: getAABB
 
     Model *m_model;
     Camera *m_viewCamera;
-    std::vector<Particle> m_particles;
+    ParticleBackend m_backend;
+    // emission stops while full
+    ParticlePool *m_pool;
+    // gpu backend only
+    ParticleFeedback *m_feedback;
     glm::vec3 m_position = glm::vec3(0.f, 0.f, 0.f);
     glm::vec3 m_direction = glm::vec3(0.f, 1.f, 0.f);
     float m_particlesPerSecond = 250.f;
@@ -53,13 +57,23 @@ public:
     float m_minDuration = 1.0f;
     float m_maxDuration = 3.0f;
     float m_particleScale = 0.1f;
+    // multiplies m_particlesPerSecond, lowered by the particle manager for budget and distance
+    float m_emissionScale = 1.f;
 
 private:
-    unsigned int m_arrayBuffer;
+    // created on the first drawParticles, managed engines draw from the manager buffer
+    StreamBuffer *m_arrayBuffer;
+    // packed from the pool when drawn
+    std::vector<Particle> m_instances;
+    // gpu backend, since the last step
+    float m_feedbackTime;
+    int m_feedbackEmission;
 
-    void setupBuffer();
+    void setupBuffer(unsigned int buffer, size_t offset);
     void updateParticles(float deltaTime);
-    void emitParticles(float deltaTime);
+    int getEmitCount(float deltaTime);
+    void drawFeedback(Shader *shader, glm::mat4 viewProjection, glm::vec3 worldOrigin);
+    ParticleEmission getEmission();
 };
 
 #endif /* particle_engine_hpp */
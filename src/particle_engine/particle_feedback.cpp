@@ -0,0 +1,132 @@
+#include "particle_feedback.h"
+
+#include <algorithm>
+#include <cstddef>
+
+static constexpr Uniform<int> uniformEmit("u_emit");
+static constexpr Uniform<int> uniformSeed("u_seed");
+static constexpr Uniform<float> uniformDeltaTime("u_deltaTime");
+static constexpr Uniform<glm::vec3> uniformViewPosition("u_viewPosition");
+static constexpr Uniform<glm::vec3> uniformEmitPosition("u_emitPosition");
+static constexpr Uniform<glm::vec3> uniformEmitDirection("u_emitDirection");
+static constexpr Uniform<float> uniformRandomness("u_randomness");
+static constexpr Uniform<glm::vec2> uniformVelocity("u_velocity");
+static constexpr Uniform<glm::vec2> uniformDuration("u_duration");
+
+ParticleFeedback::ParticleFeedback(int capacity, Shader *updateShader, uint32_t seed)
+    : m_capacity(capacity),
+      m_updateShader(updateShader),
+      m_current(0),
+      m_captured(false),
+      m_seed(seed)
+{
+    glGenBuffers(2, m_buffers);
+    glGenTransformFeedbacks(2, m_feedbacks);
+    glGenVertexArrays(2, m_vaos);
+
+    for (int i = 0; i < 2; i++)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffers[i]);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(Particle), nullptr, GL_DYNAMIC_COPY);
+
+        // same attributes for the update and the draw
+        glBindVertexArray(m_vaos[i]);
+        float size = sizeof(Particle);
+
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, size, (void *)offsetof(Particle, position));
+
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, size, (void *)offsetof(Particle, emitPosition));
+
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, size, (void *)offsetof(Particle, velocity));
+
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, size, (void *)offsetof(Particle, duration));
+
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, size, (void *)offsetof(Particle, maxDuration));
+
+        glEnableVertexAttribArray(5);
+        glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, size, (void *)offsetof(Particle, distance));
+
+        glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, m_feedbacks[i]);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_buffers[i]);
+    }
+
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+ParticleFeedback::~ParticleFeedback()
+{
+    glDeleteVertexArrays(2, m_vaos);
+    glDeleteTransformFeedbacks(2, m_feedbacks);
+    glDeleteBuffers(2, m_buffers);
+}
+
+std::vector<std::string> ParticleFeedback::getVaryings()
+{
+    return {"tf_position", "tf_emitPosition", "tf_velocity", "tf_duration", "tf_maxDuration", "tf_distance"};
+}
+
+void ParticleFeedback::simulate(float deltaTime, int emitCount, const ParticleEmission &emission, const glm::vec3 &viewPosition)
+{
+    int target = 1 - m_current;
+    // weyl sequence, the shader hash does the mixing
+    m_seed += 0x9e3779b9u;
+
+    Shader *shader = m_updateShader;
+    shader->use();
+    shader->set(uniformSeed, (int)m_seed);
+    shader->set(uniformDeltaTime, deltaTime);
+    shader->set(uniformViewPosition, viewPosition);
+    shader->set(uniformEmitPosition, emission.position);
+    shader->set(uniformEmitDirection, emission.direction);
+    shader->set(uniformRandomness, emission.randomness);
+    shader->set(uniformVelocity, glm::vec2(emission.minVelocity, emission.maxVelocity));
+    shader->set(uniformDuration, glm::vec2(emission.minDuration, emission.maxDuration));
+
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, m_feedbacks[target]);
+    glBindVertexArray(m_vaos[m_current]);
+    glBeginTransformFeedback(GL_POINTS);
+
+    // live particles first so a full buffer drops new ones, the geometry shader skips the expired
+    shader->set(uniformEmit, 0);
+    if (m_captured)
+        glDrawTransformFeedback(GL_POINTS, m_feedbacks[m_current]);
+
+    // appended to the same capture, the attributes read are ignored
+    emitCount = std::min(emitCount, m_capacity);
+    if (emitCount > 0)
+    {
+        shader->set(uniformEmit, 1);
+        glDrawArrays(GL_POINTS, 0, emitCount);
+    }
+
+    glEndTransformFeedback();
+    glBindVertexArray(0);
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    m_current = target;
+    m_captured = true;
+}
+
+void ParticleFeedback::draw()
+{
+    if (!m_captured)
+        return;
+
+    glBindVertexArray(m_vaos[m_current]);
+    glDrawTransformFeedback(GL_POINTS, m_feedbacks[m_current]);
+    glBindVertexArray(0);
+}
+
+void ParticleFeedback::clear()
+{
+    m_captured = false;
+}
@@ -0,0 +1,48 @@
+#ifndef particle_feedback_hpp
+#define particle_feedback_hpp
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "../shader/shader.h"
+#include "particle_pool.h"
+
+// particles simulated with transform feedback, they never leave the gpu
+// each step reads one buffer and writes the live particles and the new ones into the other
+// the written count stays on the gpu and is drawn with glDrawTransformFeedback
+class ParticleFeedback
+{
+public:
+    // updateShader is linked with getVaryings, draws take points with the Particle attributes on 0-5
+    ParticleFeedback(int capacity, Shader *updateShader, uint32_t seed);
+    ~ParticleFeedback();
+
+    // outputs of the update shader, in the Particle layout
+    static std::vector<std::string> getVaryings();
+
+    int m_capacity;
+    Shader *m_updateShader;
+
+    // emission beyond the capacity is dropped, like a full pool
+    void simulate(float deltaTime, int emitCount, const ParticleEmission &emission, const glm::vec3 &viewPosition);
+    // points, one per live particle, with the bound program
+    void draw();
+    void clear();
+
+private:
+    unsigned int m_buffers[2];
+    unsigned int m_feedbacks[2];
+    unsigned int m_vaos[2];
+    // written by the last step
+    int m_current;
+    // glDrawTransformFeedback needs a finished capture
+    bool m_captured;
+    // advanced each step, hashed with the particle index on the gpu
+    uint32_t m_seed;
+};
+
+#endif /* particle_feedback_hpp */
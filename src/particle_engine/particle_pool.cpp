@@ -0,0 +1,205 @@
+#include "particle_pool.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#define PARTICLE_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PARTICLE_SSE
+#include <emmintrin.h>
+#endif
+
+// random values drawn per emitted particle
+#define PARTICLE_RANDOMS 4
+
+ParticlePool::ParticlePool(int capacity, uint32_t seed)
+    : m_capacity(capacity),
+      m_count(0),
+      // xorshift never leaves zero
+      m_state(seed ? seed : 0x9e3779b9u)
+{
+    std::vector<float> *lanes[] = {&m_positionX, &m_positionY, &m_positionZ,
+                                   &m_velocityX, &m_velocityY, &m_velocityZ,
+                                   &m_emitX, &m_emitY, &m_emitZ,
+                                   &m_duration, &m_maxDuration, &m_distance};
+    for (std::vector<float> *lane : lanes)
+        lane->resize(capacity);
+}
+
+float ParticlePool::random()
+{
+    m_state ^= m_state << 13;
+    m_state ^= m_state >> 17;
+    m_state ^= m_state << 5;
+    // top 24 bits, exact in a float
+    return (m_state >> 8) * (1.f / 16777216.f);
+}
+
+int ParticlePool::emit(int count, const ParticleEmission &emission)
+{
+    count = std::min(count, m_capacity - m_count);
+    if (count <= 0)
+        return 0;
+
+    // all random values of the batch first, the loop below has no dependency on the generator
+    m_randoms.resize(count * PARTICLE_RANDOMS);
+    for (int i = 0; i < m_randoms.size(); i++)
+        m_randoms[i] = random();
+
+    const float twoPi = 6.28318530718f;
+    for (int i = 0; i < count; i++)
+    {
+        const float *r = &m_randoms[i * PARTICLE_RANDOMS];
+
+        // uniform on the unit sphere from a height and an angle
+        float z = r[0] * 2.f - 1.f;
+        float angle = r[1] * twoPi;
+        float ring = std::sqrt(1.f - z * z);
+        glm::vec3 spread(ring * std::cos(angle), ring * std::sin(angle), z);
+
+        glm::vec3 direction = glm::normalize(emission.direction + emission.randomness * spread);
+        glm::vec3 velocity = direction * (emission.minVelocity + r[2] * (emission.maxVelocity - emission.minVelocity));
+        float duration = emission.minDuration + r[3] * (emission.maxDuration - emission.minDuration);
+
+        int index = m_count + i;
+        m_positionX[index] = emission.position.x;
+        m_positionY[index] = emission.position.y;
+        m_positionZ[index] = emission.position.z;
+        m_emitX[index] = emission.position.x;
+        m_emitY[index] = emission.position.y;
+        m_emitZ[index] = emission.position.z;
+        m_velocityX[index] = velocity.x;
+        m_velocityY[index] = velocity.y;
+        m_velocityZ[index] = velocity.z;
+        m_duration[index] = duration;
+        m_maxDuration[index] = duration;
+        m_distance[index] = 0.f;
+    }
+
+    m_count += count;
+    return count;
+}
+
+void ParticlePool::integrate(float deltaTime, const glm::vec3 &viewPosition)
+{
+    float *px = m_positionX.data(), *py = m_positionY.data(), *pz = m_positionZ.data();
+    const float *vx = m_velocityX.data(), *vy = m_velocityY.data(), *vz = m_velocityZ.data();
+    float *duration = m_duration.data();
+    float *distance = m_distance.data();
+
+    m_expired.clear();
+
+    int i = 0;
+#if defined(PARTICLE_AVX)
+    __m256 dt = _mm256_set1_ps(deltaTime);
+    __m256 viewX = _mm256_set1_ps(viewPosition.x);
+    __m256 viewY = _mm256_set1_ps(viewPosition.y);
+    __m256 viewZ = _mm256_set1_ps(viewPosition.z);
+    for (; i + 8 <= m_count; i += 8)
+    {
+        __m256 x = _mm256_add_ps(_mm256_loadu_ps(px + i), _mm256_mul_ps(_mm256_loadu_ps(vx + i), dt));
+        __m256 y = _mm256_add_ps(_mm256_loadu_ps(py + i), _mm256_mul_ps(_mm256_loadu_ps(vy + i), dt));
+        __m256 z = _mm256_add_ps(_mm256_loadu_ps(pz + i), _mm256_mul_ps(_mm256_loadu_ps(vz + i), dt));
+        _mm256_storeu_ps(px + i, x);
+        _mm256_storeu_ps(py + i, y);
+        _mm256_storeu_ps(pz + i, z);
+        __m256 age = _mm256_sub_ps(_mm256_loadu_ps(duration + i), dt);
+        _mm256_storeu_ps(duration + i, age);
+        addExpired(i, _mm256_movemask_ps(_mm256_cmp_ps(age, _mm256_setzero_ps(), _CMP_LT_OQ)));
+
+        __m256 dx = _mm256_sub_ps(x, viewX);
+        __m256 dy = _mm256_sub_ps(y, viewY);
+        __m256 dz = _mm256_sub_ps(z, viewZ);
+        __m256 lengthSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+        _mm256_storeu_ps(distance + i, _mm256_sqrt_ps(lengthSquared));
+    }
+#elif defined(PARTICLE_SSE)
+    __m128 dt = _mm_set1_ps(deltaTime);
+    __m128 viewX = _mm_set1_ps(viewPosition.x);
+    __m128 viewY = _mm_set1_ps(viewPosition.y);
+    __m128 viewZ = _mm_set1_ps(viewPosition.z);
+    for (; i + 4 <= m_count; i += 4)
+    {
+        __m128 x = _mm_add_ps(_mm_loadu_ps(px + i), _mm_mul_ps(_mm_loadu_ps(vx + i), dt));
+        __m128 y = _mm_add_ps(_mm_loadu_ps(py + i), _mm_mul_ps(_mm_loadu_ps(vy + i), dt));
+        __m128 z = _mm_add_ps(_mm_loadu_ps(pz + i), _mm_mul_ps(_mm_loadu_ps(vz + i), dt));
+        _mm_storeu_ps(px + i, x);
+        _mm_storeu_ps(py + i, y);
+        _mm_storeu_ps(pz + i, z);
+        __m128 age = _mm_sub_ps(_mm_loadu_ps(duration + i), dt);
+        _mm_storeu_ps(duration + i, age);
+        addExpired(i, _mm_movemask_ps(_mm_cmplt_ps(age, _mm_setzero_ps())));
+
+        __m128 dx = _mm_sub_ps(x, viewX);
+        __m128 dy = _mm_sub_ps(y, viewY);
+        __m128 dz = _mm_sub_ps(z, viewZ);
+        __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        _mm_storeu_ps(distance + i, _mm_sqrt_ps(lengthSquared));
+    }
+#endif
+    for (; i < m_count; i++)
+    {
+        px[i] += vx[i] * deltaTime;
+        py[i] += vy[i] * deltaTime;
+        pz[i] += vz[i] * deltaTime;
+        duration[i] -= deltaTime;
+        if (duration[i] < 0.f)
+            m_expired.push_back(i);
+
+        float dx = px[i] - viewPosition.x;
+        float dy = py[i] - viewPosition.y;
+        float dz = pz[i] - viewPosition.z;
+        distance[i] = std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+
+    // swap remove from the back, everything after the removed index is alive so the last particle is too
+    for (int j = m_expired.size() - 1; j >= 0; j--)
+        move(--m_count, m_expired[j]);
+}
+
+// one bit per particle from index
+void ParticlePool::addExpired(int index, int mask)
+{
+    for (; mask; index++, mask >>= 1)
+    {
+        if (mask & 1)
+            m_expired.push_back(index);
+    }
+}
+
+void ParticlePool::pack(Particle *instances)
+{
+    for (int i = 0; i < m_count; i++)
+    {
+        Particle &particle = instances[i];
+        particle.position = glm::vec3(m_positionX[i], m_positionY[i], m_positionZ[i]);
+        particle.emitPosition = glm::vec3(m_emitX[i], m_emitY[i], m_emitZ[i]);
+        particle.velocity = glm::vec3(m_velocityX[i], m_velocityY[i], m_velocityZ[i]);
+        particle.duration = m_duration[i];
+        particle.maxDuration = m_maxDuration[i];
+        particle.distance = m_distance[i];
+    }
+}
+
+void ParticlePool::clear()
+{
+    m_count = 0;
+}
+
+void ParticlePool::move(int from, int to)
+{
+    m_positionX[to] = m_positionX[from];
+    m_positionY[to] = m_positionY[from];
+    m_positionZ[to] = m_positionZ[from];
+    m_velocityX[to] = m_velocityX[from];
+    m_velocityY[to] = m_velocityY[from];
+    m_velocityZ[to] = m_velocityZ[from];
+    m_emitX[to] = m_emitX[from];
+    m_emitY[to] = m_emitY[from];
+    m_emitZ[to] = m_emitZ[from];
+    m_duration[to] = m_duration[from];
+    m_maxDuration[to] = m_maxDuration[from];
+    m_distance[to] = m_distance[from];
+}
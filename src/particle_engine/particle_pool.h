@@ -0,0 +1,72 @@
+#ifndef particle_pool_hpp
+#define particle_pool_hpp
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// instance data of one particle, as read by the particle shaders
+struct Particle
+{
+    glm::vec3 position;
+    glm::vec3 emitPosition;
+    glm::vec3 velocity;
+    float duration;
+    float maxDuration;
+    float distance;
+};
+
+// spawn parameters of a batch of particles
+struct ParticleEmission
+{
+    glm::vec3 position;
+    glm::vec3 direction;
+    float randomness;
+    float minVelocity;
+    float maxVelocity;
+    float minDuration;
+    float maxDuration;
+};
+
+// live particles packed at the front of fixed size lanes, one lane per component
+// expired particles are replaced by the last one, order is not kept
+class ParticlePool
+{
+public:
+    ParticlePool(int capacity, uint32_t seed);
+
+    int m_capacity;
+    int m_count;
+
+    std::vector<float> m_positionX, m_positionY, m_positionZ;
+    std::vector<float> m_velocityX, m_velocityY, m_velocityZ;
+    std::vector<float> m_emitX, m_emitY, m_emitZ;
+    std::vector<float> m_duration, m_maxDuration;
+    // to the view position of the last integrate
+    std::vector<float> m_distance;
+
+    // returns the emitted count, less than count when the pool is full
+    int emit(int count, const ParticleEmission &emission);
+    // moves and ages every particle, then removes the expired ones
+    void integrate(float deltaTime, const glm::vec3 &viewPosition);
+    // interleaved instance data of the live particles, m_count entries
+    void pack(Particle *instances);
+    void clear();
+
+    // uniform in [0, 1)
+    float random();
+
+private:
+    // xorshift, each pool has its own so pools can be updated in parallel
+    uint32_t m_state;
+    // per batch random values, reused between emits
+    std::vector<float> m_randoms;
+    // ascending indices of the particles expired by the last integrate
+    std::vector<int> m_expired;
+
+    void move(int from, int to);
+    void addExpired(int index, int mask);
+};
+
+#endif /* particle_pool_hpp */
@@ -0,0 +1,135 @@
+#include "particle_manager.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "../utils/common.h"
+
+// sources per job, most emit only a few particles a frame
+#define PARTICLE_MANAGER_CHUNK 8
+
+ParticleManager::ParticleManager(JobPool *jobPool, Camera *viewCamera)
+    : m_jobPool(jobPool),
+      m_viewCamera(viewCamera)
+{
+    m_instanceBuffer = new StreamBuffer();
+}
+
+ParticleManager::~ParticleManager()
+{
+    delete m_instanceBuffer;
+}
+
+void ParticleManager::addSource(RenderParticleSource *source)
+{
+    m_sources.push_back(source);
+}
+
+float ParticleManager::getDistanceScale(const glm::vec3 &position)
+{
+    float distance = glm::distance(position, m_viewCamera->position);
+    float t = (distance - m_throttleNear) / std::max(m_throttleFar - m_throttleNear, 0.001f);
+    return glm::mix(1.f, m_minEmission, glm::clamp(t, 0.f, 1.f));
+}
+
+void ParticleManager::update(float deltaTime)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    int sourceCount = m_sources.size();
+    m_distanceScales.resize(sourceCount);
+    m_firstInstances.resize(sourceCount);
+
+    // emitter placement and the emission this frame would request, cheap so on this thread
+    int liveCount = 0;
+    float requested = 0.f;
+    for (int i = 0; i < sourceCount; i++)
+    {
+        RenderParticleSource *source = m_sources[i];
+        ParticleEngine *engine = source->particleEngine;
+        if (source->transformLink)
+        {
+            glm::mat4 model = source->transformLink->getModelMatrix();
+            engine->m_position = CommonUtil::positionFromModel(model);
+            engine->m_direction = glm::normalize(glm::mat3(model) * glm::vec3(0.f, 0.f, 1.f));
+        }
+
+        m_distanceScales[i] = getDistanceScale(engine->m_position);
+        // gpu engines are bounded by their own buffers, the budget is for the cpu pools
+        if (engine->m_backend == ParticleBackend::gpu)
+            continue;
+
+        requested += engine->m_particlesPerSecond * m_distanceScales[i] * deltaTime;
+        liveCount += engine->m_pool->m_count;
+    }
+
+    // over budget every source gives up the same share, particles expiring this frame are not counted as room
+    float budgetScale = 1.f;
+    float available = (float)std::max(m_particleBudget - liveCount, 0);
+    if (requested > available)
+        budgetScale = available / requested;
+
+    m_stats.throttledCount = 0;
+    for (int i = 0; i < sourceCount; i++)
+    {
+        ParticleEngine *engine = m_sources[i]->particleEngine;
+        float scale = m_distanceScales[i] * (engine->m_backend == ParticleBackend::gpu ? 1.f : budgetScale);
+        engine->m_emissionScale = scale;
+        if (scale < 1.f && engine->m_particlesPerSecond > 0.f)
+            m_stats.throttledCount++;
+    }
+
+    // every engine has its own pool and generator, gpu engines only count their emission
+    m_jobPool->parallelFor(sourceCount, [this, deltaTime](int start, int end) {
+        for (int i = start; i < end; i++)
+            m_sources[i]->particleEngine->update(deltaTime);
+    }, PARTICLE_MANAGER_CHUNK);
+
+    int instanceCount = 0;
+    for (int i = 0; i < sourceCount; i++)
+    {
+        m_firstInstances[i] = instanceCount;
+        instanceCount += m_sources[i]->particleEngine->m_pool->m_count;
+    }
+
+    m_instances.resize(instanceCount);
+    m_jobPool->parallelFor(sourceCount, [this](int start, int end) {
+        for (int i = start; i < end; i++)
+            m_sources[i]->particleEngine->m_pool->pack(m_instances.data() + m_firstInstances[i]);
+    }, PARTICLE_MANAGER_CHUNK);
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    m_stats.sourceCount = sourceCount;
+    m_stats.particleCount = instanceCount;
+    m_stats.budgetScale = budgetScale;
+    m_stats.updateTime = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+void ParticleManager::draw(const glm::mat4 &viewProjection, const glm::vec3 &worldOrigin)
+{
+    size_t offset = 0;
+    if (!m_instances.empty())
+        offset = m_instanceBuffer->upload(m_instances.data(), m_instances.size() * sizeof(Particle));
+
+    for (int i = 0; i < m_sources.size(); i++)
+    {
+        RenderParticleSource *source = m_sources[i];
+        // simulated on the gpu before drawing, the billboard shader is set by RenderManager::setParticleBackend
+        if (source->particleEngine->m_backend == ParticleBackend::gpu)
+        {
+            if (source->billboardShader)
+                source->particleEngine->drawParticles(source->billboardShader, viewProjection, worldOrigin);
+            continue;
+        }
+
+        // counts as packed, sources added after the last update have nothing yet
+        if (i >= m_firstInstances.size())
+            continue;
+
+        int end = i + 1 < m_firstInstances.size() ? m_firstInstances[i + 1] : m_instances.size();
+        int count = end - m_firstInstances[i];
+        source->particleEngine->drawInstances(source->shader, viewProjection, worldOrigin, m_instanceBuffer->m_buffer,
+                                              offset + m_firstInstances[i] * sizeof(Particle), count);
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef particle_manager_hpp
+#define particle_manager_hpp
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "../camera/camera.h"
+#include "../job_pool/job_pool.h"
+#include "../particle_engine/particle_engine.h"
+#include "../shader/shader.h"
+#include "../stream_buffer/stream_buffer.h"
+#include "../transform_link/transform_link.h"
+
+// TODO: remove?
+class RenderParticleSource
+{
+public:
+    Shader *shader;
+    Model *model;
+    ParticleEngine *particleEngine;
+    TransformLink *transformLink = nullptr;
+    // gpu backend, billboards from points with the fragment shader of shader
+    Shader *billboardShader = nullptr;
+
+    RenderParticleSource(Shader *shader, Model *model, ParticleEngine *particleEngine)
+        : shader(shader),
+          model(model),
+          particleEngine(particleEngine){};
+
+    RenderParticleSource(Shader *shader, Model *model, ParticleEngine *particleEngine, TransformLink *transformLink)
+        : shader(shader),
+          model(model),
+          particleEngine(particleEngine),
+          transformLink(transformLink){};
+};
+
+struct ParticleStats
+{
+    int sourceCount = 0;
+    int particleCount = 0;
+    // emitting below their rate because of distance or budget
+    int throttledCount = 0;
+    // applied to every source while over budget
+    float budgetScale = 1.f;
+    // cpu time of simulation and packing, in ms
+    float updateTime = 0.f;
+};
+
+// simulates every particle source in parallel and packs all instances into one buffer
+// emission is lowered with view distance and when the live particles near the budget
+class ParticleManager
+{
+public:
+    ParticleManager(JobPool *jobPool, Camera *viewCamera);
+    ~ParticleManager();
+
+    JobPool *m_jobPool;
+    Camera *m_viewCamera;
+    std::vector<RenderParticleSource *> m_sources;
+    ParticleStats m_stats;
+
+    // live particles over all sources
+    int m_particleBudget = 32768;
+    // full emission closer than near, m_minEmission from far on
+    float m_throttleNear = 25.f;
+    float m_throttleFar = 150.f;
+    float m_minEmission = 0.1f;
+
+    void addSource(RenderParticleSource *source);
+    // once per frame before rendering, sources are updated concurrently so engines must not share state
+    void update(float deltaTime);
+    // one upload for all cpu sources, then a draw per source in order, gpu sources step here
+    void draw(const glm::mat4 &viewProjection, const glm::vec3 &worldOrigin);
+
+private:
+    StreamBuffer *m_instanceBuffer;
+    // instances of every source, packed by update
+    std::vector<Particle> m_instances;
+    // by source index
+    std::vector<int> m_firstInstances;
+    std::vector<float> m_distanceScales;
+
+    float getDistanceScale(const glm::vec3 &position);
+};
+
+#endif /* particle_manager_hpp */
@@ -51,7 +51,7 @@ void PbrManager::setupCubemap(Model *cube, Shader &hdrToCubemapShader)
     hdrToCubemapShader.setMat4("model", glm::scale(glm::mat4(1.0), glm::vec3(1.f, -1.f, 1.f)));
     hdrToCubemapShader.setInt("equirectangularMap", 0);
     glActiveTexture(GL_TEXTURE0);
-    glUniform1i(glGetUniformLocation(hdrToCubemapShader.id, "equirectangularMap"), 0);
+    hdrToCubemapShader.setInt("equirectangularMap", 0);
     glBindTexture(GL_TEXTURE_2D, m_environmentTexture->id);
 
     glViewport(0, 0, m_cubemapFaceSize, m_cubemapFaceSize);
@@ -92,7 +92,7 @@ void PbrManager::setupIrradianceMap(Model *cube, Shader &irradianceShader)
     irradianceShader.setMat4("projection", captureProjection);
     irradianceShader.setInt("environmentMap", 0);
     glActiveTexture(GL_TEXTURE0);
-    glUniform1i(glGetUniformLocation(irradianceShader.id, "environmentMap"), 0);
+    irradianceShader.setInt("environmentMap", 0);
     glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
 
     glViewport(0, 0, m_irradianceSize, m_irradianceSize);
@@ -133,7 +133,7 @@ void PbrManager::setupPrefilterMap(Model *cube, Shader &prefilterShader)
     prefilterShader.setInt("environmentMap", 0);
     prefilterShader.setInt("u_cubemapFaceSize", m_cubemapFaceSize);
     glActiveTexture(GL_TEXTURE0);
-    glUniform1i(glGetUniformLocation(prefilterShader.id, "environmentMap"), 0);
+    prefilterShader.setInt("environmentMap", 0);
     glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
 
     glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
@@ -2,10 +2,12 @@
 
 DebugDrawer::DebugDrawer()
 {
+    m_vertexBuffer = new StreamBuffer();
 }
 
 DebugDrawer::~DebugDrawer()
 {
+    delete m_vertexBuffer;
 }
 
 void DebugDrawer::drawLine(const btVector3 &from, const btVector3 &to, const btVector3 &color)
@@ -19,14 +21,13 @@ void DebugDrawer::drawLine(const btVector3 &from, const btVector3 &to, const btV
 }
 
 // TODO: own shader with only lines
-void DebugDrawer::drawLines(Shader &lineShader, glm::mat4 mvp, unsigned int vbo, unsigned int vao, unsigned int ebo)
+void DebugDrawer::drawLines(Shader &lineShader, glm::mat4 mvp, unsigned int vao)
 {
     if (this->lines.size() == 0)
         return;
 
     std::vector<GLfloat> vertices;
-    std::vector<GLuint> indices;
-    unsigned int indexI = 0;
+    vertices.reserve(lines.size() * 12);
 
     for (std::vector<DebugDrawer::Line>::iterator it = lines.begin(); it != lines.end(); it++)
     {
@@ -46,30 +47,23 @@ void DebugDrawer::drawLines(Shader &lineShader, glm::mat4 mvp, unsigned int vbo,
         vertices.push_back(l.color.x);
         vertices.push_back(l.color.y);
         vertices.push_back(l.color.z);
-
-        indices.push_back(indexI);
-        indices.push_back(indexI + 1);
-        indexI += 2;
     }
 
-    glBindVertexArray(vao);
-
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    // skipped while nothing moves, lines are drawn as consecutive vertex pairs without indices
+    size_t offset = m_vertexBuffer->uploadChanged(vertices.data(), vertices.size() * sizeof(float));
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(float), indices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer->m_buffer);
 
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)offset);
 
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)(3 * sizeof(float)));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)(offset + 3 * sizeof(float)));
 
     lineShader.use();
     lineShader.setMat4("MVP", mvp);
 
-    glBindVertexArray(vao);
-    glDrawElements(GL_LINES, indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawArrays(GL_LINES, 0, lines.size() * 2);
     glBindVertexArray(0);
 }
@@ -13,6 +13,7 @@
 #include "btBulletDynamicsCommon.h"
 
 #include "../../shader/shader.h"
+#include "../../stream_buffer/stream_buffer.h"
 
 class DebugDrawer : public btIDebugDraw
 {
@@ -40,10 +41,11 @@ public:
     virtual int getDebugMode() const { return m_debugMode; }
 
     std::vector<Line> &getLines() { return lines; }
-    void drawLines(Shader &lineShader, glm::mat4 mvp, unsigned int vbo, unsigned int vao, unsigned int ebo);
+    void drawLines(Shader &lineShader, glm::mat4 mvp, unsigned int vao);
 
 private:
     int m_debugMode = 1;
+    StreamBuffer *m_vertexBuffer;
     std::vector<Line> lines;
 };
 #endif /* debug_drawer_hpp */
@@ -632,7 +632,6 @@ void Ragdoll::syncNodeToAnimation(RagdollNodeData *node, btQuaternion offset, bo
 
     Bone *bone = m_animation->getBone(node->animNode->name);
     bone->m_rotations[0].value = BulletGLM::getGLMQuat(boneOrientation);
-    bone->updatePose();
 }
 
 void Ragdoll::syncFromAnimation(glm::mat4 characterModel)
@@ -0,0 +1,45 @@
+#include "bone_palette.h"
+
+BonePalette::BonePalette()
+{
+    m_buffer = new StreamBuffer(StreamMode::orphan);
+    glGenTextures(1, &m_texture);
+
+    // the texture follows the buffer object when its storage is replaced
+    glBindTexture(GL_TEXTURE_BUFFER, m_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_buffer->m_buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+BonePalette::~BonePalette()
+{
+    glDeleteTextures(1, &m_texture);
+    delete m_buffer;
+}
+
+void BonePalette::clear()
+{
+    m_matrices.clear();
+}
+
+int BonePalette::add(const std::vector<glm::mat4> &matrices)
+{
+    int offset = m_matrices.size();
+    m_matrices.insert(m_matrices.end(), matrices.begin(), matrices.end());
+    return offset;
+}
+
+void BonePalette::upload()
+{
+    if (m_matrices.empty())
+        return;
+
+    m_buffer->upload(m_matrices.data(), m_matrices.size() * sizeof(glm::mat4));
+}
+
+void BonePalette::bind()
+{
+    glActiveTexture(GL_TEXTURE0 + BONE_PALETTE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, m_texture);
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,34 @@
+#ifndef bone_palette_hpp
+#define bone_palette_hpp
+
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "../stream_buffer/stream_buffer.h"
+
+// texture unit of the palette for skinned shaders
+#define BONE_PALETTE_TEXTURE_UNIT 15
+
+// bone matrices of all visible skeletons in one texture buffer
+// packed and uploaded once per frame, draws select their range with an offset in matrices
+class BonePalette
+{
+public:
+    BonePalette();
+    ~BonePalette();
+
+    // orphaned, texture buffers take no offset in 4.1
+    StreamBuffer *m_buffer;
+    unsigned int m_texture;
+    std::vector<glm::mat4> m_matrices;
+
+    void clear();
+    // returns the offset of the first matrix
+    int add(const std::vector<glm::mat4> &matrices);
+    void upload();
+    void bind();
+};
+
+#endif /* bone_palette_hpp */
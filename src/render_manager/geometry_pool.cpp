@@ -0,0 +1,217 @@
+#include <algorithm>
+
+#include "geometry_pool.h"
+
+GeometryPool::GeometryPool(int vertexCapacity, int indexCapacity)
+    : m_vertexCount(0),
+      m_vertexCapacity(vertexCapacity),
+      m_indexCount(0),
+      m_indexCapacity(indexCapacity),
+      m_meshCount(0)
+{
+    glGenVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_vbo);
+    glGenBuffers(1, &m_ebo);
+
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, m_vertexCapacity * sizeof(PackedVertex), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indexCapacity * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+    Mesh::setupVertexAttributes(VertexLayout::packedStatic);
+    glBindVertexArray(0);
+}
+
+GeometryPool::~GeometryPool()
+{
+    // meshes outliving the pool must not point into it
+    for (auto &entry : m_entries)
+    {
+        entry.first->poolVAO = 0;
+        entry.first->pool = nullptr;
+    }
+
+    glDeleteVertexArrays(1, &m_vao);
+    glDeleteBuffers(1, &m_vbo);
+    glDeleteBuffers(1, &m_ebo);
+}
+
+void GeometryPool::add(Model *model)
+{
+    if (model->m_boneCounter > 0)
+    {
+        std::cout << "GeometryPool: skinned model is not pooled: " << model->m_path << std::endl;
+        return;
+    }
+
+    for (int i = 0; i < model->meshes.size(); i++)
+        add(model->meshes[i]);
+}
+
+void GeometryPool::add(Mesh *mesh)
+{
+    if (mesh->poolVAO != 0 || mesh->vertices.empty() || mesh->indices.empty())
+        return;
+
+    int vertexCount = mesh->vertices.size();
+    // coarser levels follow the full index list, lod ranges stay valid from poolFirstIndex
+    std::vector<unsigned int> indices = mesh->indices;
+    indices.insert(indices.end(), mesh->lodIndices.begin(), mesh->lodIndices.end());
+    int indexCount = indices.size();
+
+    // freed ranges first, otherwise appended
+    int baseVertex = takeRange(m_freeVertices, vertexCount);
+    int firstIndex = takeRange(m_freeIndices, indexCount);
+    reserve(baseVertex < 0 ? m_vertexCount + vertexCount : m_vertexCount,
+            firstIndex < 0 ? m_indexCount + indexCount : m_indexCount);
+    if (baseVertex < 0)
+    {
+        baseVertex = m_vertexCount;
+        m_vertexCount += vertexCount;
+    }
+    if (firstIndex < 0)
+    {
+        firstIndex = m_indexCount;
+        m_indexCount += indexCount;
+    }
+
+    // mesh offset is baked so meshes of a source can share one draw, shaders normalize after transform
+    glm::mat3 offset = glm::mat3(mesh->offset);
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(offset));
+    std::vector<PackedVertex> vertices(vertexCount);
+    for (int i = 0; i < vertexCount; i++)
+    {
+        Vertex vertex = mesh->vertices[i];
+        vertex.position = glm::vec3(mesh->offset * glm::vec4(vertex.position, 1.f));
+        vertex.normal = normalMatrix * vertex.normal;
+        vertex.tangent = offset * vertex.tangent;
+        vertex.bitangent = offset * vertex.bitangent;
+        vertices[i] = Mesh::packVertex(vertex);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, baseVertex * sizeof(PackedVertex), vertexCount * sizeof(PackedVertex), vertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // element array binding is vertex array state
+    glBindVertexArray(m_vao);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, firstIndex * sizeof(unsigned int), indexCount * sizeof(unsigned int), indices.data());
+    glBindVertexArray(0);
+
+    mesh->poolVAO = m_vao;
+    mesh->poolBaseVertex = baseVertex;
+    mesh->poolFirstIndex = firstIndex;
+    mesh->pool = this;
+
+    m_entries[mesh] = PoolEntry{PoolRange{baseVertex, vertexCount}, PoolRange{firstIndex, indexCount}};
+    m_meshCount++;
+}
+
+void GeometryPool::remove(Model *model)
+{
+    for (int i = 0; i < model->meshes.size(); i++)
+        remove(model->meshes[i]);
+}
+
+void GeometryPool::remove(Mesh *mesh)
+{
+    auto it = m_entries.find(mesh);
+    if (it == m_entries.end())
+        return;
+
+    releaseRange(m_freeVertices, m_vertexCount, it->second.vertices);
+    releaseRange(m_freeIndices, m_indexCount, it->second.indices);
+    m_entries.erase(it);
+    m_meshCount--;
+
+    mesh->poolVAO = 0;
+    mesh->poolBaseVertex = 0;
+    mesh->poolFirstIndex = 0;
+    mesh->pool = nullptr;
+}
+
+// grows by copying into new storage on the gpu, the vertex array is pointed at the new buffers
+void GeometryPool::reserve(int vertexCount, int indexCount)
+{
+    if (vertexCount <= m_vertexCapacity && indexCount <= m_indexCapacity)
+        return;
+
+    int vertexCapacity = std::max(vertexCount, m_vertexCapacity * 2);
+    int indexCapacity = std::max(indexCount, m_indexCapacity * 2);
+
+    unsigned int buffers[2];
+    glGenBuffers(2, buffers);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[0]);
+    glBufferData(GL_COPY_WRITE_BUFFER, vertexCapacity * sizeof(PackedVertex), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_vbo);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, m_vertexCount * sizeof(PackedVertex));
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[1]);
+    glBufferData(GL_COPY_WRITE_BUFFER, indexCapacity * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_ebo);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, m_indexCount * sizeof(unsigned int));
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    glDeleteBuffers(1, &m_vbo);
+    glDeleteBuffers(1, &m_ebo);
+    m_vbo = buffers[0];
+    m_ebo = buffers[1];
+    m_vertexCapacity = vertexCapacity;
+    m_indexCapacity = indexCapacity;
+
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+    Mesh::setupVertexAttributes(VertexLayout::packedStatic);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    std::cout << "GeometryPool: grown to " << m_vertexCapacity << " vertices, " << m_indexCapacity << " indices" << std::endl;
+}
+
+// first fit, -1 when no free range is large enough
+int GeometryPool::takeRange(std::vector<PoolRange> &freeRanges, int count)
+{
+    for (int i = 0; i < freeRanges.size(); i++)
+    {
+        PoolRange &range = freeRanges[i];
+        if (range.count < count)
+            continue;
+
+        int first = range.first;
+        range.first += count;
+        range.count -= count;
+        if (range.count == 0)
+            freeRanges.erase(freeRanges.begin() + i);
+        return first;
+    }
+
+    return -1;
+}
+
+// merged with its neighbours, a range reaching the end moves the end back instead
+void GeometryPool::releaseRange(std::vector<PoolRange> &freeRanges, int &end, PoolRange range)
+{
+    auto it = std::lower_bound(freeRanges.begin(), freeRanges.end(), range.first,
+                               [](const PoolRange &freeRange, int first) { return freeRange.first < first; });
+    it = freeRanges.insert(it, range);
+
+    if (it + 1 != freeRanges.end() && it->first + it->count == (it + 1)->first)
+    {
+        it->count += (it + 1)->count;
+        freeRanges.erase(it + 1);
+    }
+    if (it != freeRanges.begin() && (it - 1)->first + (it - 1)->count == it->first)
+    {
+        (it - 1)->count += it->count;
+        it = freeRanges.erase(it) - 1;
+    }
+    if (it->first + it->count == end)
+    {
+        end = it->first;
+        freeRanges.erase(it);
+    }
+}
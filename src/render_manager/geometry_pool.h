@@ -0,0 +1,58 @@
+#ifndef geometry_pool_hpp
+#define geometry_pool_hpp
+
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "../model/model.h"
+
+struct PoolRange
+{
+    int first;
+    int count;
+};
+
+struct PoolEntry
+{
+    PoolRange vertices;
+    PoolRange indices;
+};
+
+// vertices and indices of many static meshes suballocated in one vertex array, always in the packed static layout
+// meshes keep their own buffers, pooled draws use base vertex and first index instead
+// ranges of removed meshes are reused first fit
+class GeometryPool
+{
+public:
+    GeometryPool(int vertexCapacity = 1 << 16, int indexCapacity = 1 << 18);
+    ~GeometryPool();
+
+    unsigned int m_vao, m_vbo, m_ebo;
+    // end of the used ranges, free ranges below are not counted out
+    int m_vertexCount, m_vertexCapacity;
+    int m_indexCount, m_indexCapacity;
+    int m_meshCount;
+
+    // pools every mesh of the model that is not pooled yet, skinned models are skipped
+    void add(Model *model);
+    void add(Mesh *mesh);
+    // releases the ranges, the meshes draw from their own buffers again
+    void remove(Model *model);
+    void remove(Mesh *mesh);
+
+private:
+    std::unordered_map<Mesh *, PoolEntry> m_entries;
+    // sorted by first, adjacent ranges merged
+    std::vector<PoolRange> m_freeVertices;
+    std::vector<PoolRange> m_freeIndices;
+
+    void reserve(int vertexCount, int indexCount);
+    static int takeRange(std::vector<PoolRange> &freeRanges, int count);
+    static void releaseRange(std::vector<PoolRange> &freeRanges, int &end, PoolRange range);
+};
+
+#endif /* geometry_pool_hpp */
@@ -0,0 +1,282 @@
+#include "light_clusters.h"
+#include "render_manager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LIGHT_CLUSTERS_SSE
+#include <emmintrin.h>
+#endif
+
+#define LIGHT_CLUSTER_COUNT (LIGHT_CLUSTER_X * LIGHT_CLUSTER_Y * LIGHT_CLUSTER_Z)
+
+LightClusters::LightClusters()
+    : m_sliceScale(0.f),
+      m_sliceBias(0.f),
+      m_projection(0.f),
+      m_near(0.f),
+      m_far(0.f)
+{
+    m_clusterBuffer = new StreamBuffer(StreamMode::orphan);
+    m_indexBuffer = new StreamBuffer(StreamMode::orphan);
+    m_lightBuffer = new StreamBuffer(StreamMode::orphan);
+
+    StreamBuffer *buffers[3] = {m_clusterBuffer, m_indexBuffer, m_lightBuffer};
+    unsigned int *textures[3] = {&m_clusterTexture, &m_indexTexture, &m_lightTexture};
+    GLenum formats[3] = {GL_RG32UI, GL_R32UI, GL_RGBA32F};
+
+    for (int i = 0; i < 3; i++)
+    {
+        glGenTextures(1, textures[i]);
+        glBindTexture(GL_TEXTURE_BUFFER, *textures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]->m_buffer);
+    }
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    m_minX.resize(LIGHT_CLUSTER_COUNT);
+    m_minY.resize(LIGHT_CLUSTER_COUNT);
+    m_minZ.resize(LIGHT_CLUSTER_COUNT);
+    m_maxX.resize(LIGHT_CLUSTER_COUNT);
+    m_maxY.resize(LIGHT_CLUSTER_COUNT);
+    m_maxZ.resize(LIGHT_CLUSTER_COUNT);
+    m_clusterData.resize(LIGHT_CLUSTER_COUNT * 2);
+}
+
+LightClusters::~LightClusters()
+{
+    glDeleteTextures(1, &m_clusterTexture);
+    glDeleteTextures(1, &m_indexTexture);
+    glDeleteTextures(1, &m_lightTexture);
+    delete m_clusterBuffer;
+    delete m_indexBuffer;
+    delete m_lightBuffer;
+}
+
+// view space bounds of every cluster, only when the projection changes
+void LightClusters::buildGrid(const glm::mat4 &projection, float near, float far)
+{
+    m_projection = projection;
+    m_near = near;
+    m_far = far;
+
+    float logRatio = std::log(far / near);
+    m_sliceScale = LIGHT_CLUSTER_Z / logRatio;
+    m_sliceBias = -LIGHT_CLUSTER_Z * std::log(near) / logRatio;
+
+    // tile corners on the near and far planes, a line per corner works for ortho too
+    glm::mat4 inverseProjection = glm::inverse(projection);
+    const int cornerX = LIGHT_CLUSTER_X + 1;
+    std::vector<glm::vec3> nearCorners(cornerX * (LIGHT_CLUSTER_Y + 1));
+    std::vector<glm::vec3> farCorners(nearCorners.size());
+    for (int y = 0; y <= LIGHT_CLUSTER_Y; y++)
+    {
+        for (int x = 0; x <= LIGHT_CLUSTER_X; x++)
+        {
+            float ndcX = -1.f + 2.f * x / LIGHT_CLUSTER_X;
+            float ndcY = -1.f + 2.f * y / LIGHT_CLUSTER_Y;
+            glm::vec4 nearPoint = inverseProjection * glm::vec4(ndcX, ndcY, -1.f, 1.f);
+            glm::vec4 farPoint = inverseProjection * glm::vec4(ndcX, ndcY, 1.f, 1.f);
+            nearCorners[y * cornerX + x] = glm::vec3(nearPoint) / nearPoint.w;
+            farCorners[y * cornerX + x] = glm::vec3(farPoint) / farPoint.w;
+        }
+    }
+
+    for (int z = 0; z < LIGHT_CLUSTER_Z; z++)
+    {
+        float depths[2] = {near * std::pow(far / near, (float)z / LIGHT_CLUSTER_Z),
+                           near * std::pow(far / near, (float)(z + 1) / LIGHT_CLUSTER_Z)};
+
+        for (int y = 0; y < LIGHT_CLUSTER_Y; y++)
+        {
+            for (int x = 0; x < LIGHT_CLUSTER_X; x++)
+            {
+                glm::vec3 min(1e30f);
+                glm::vec3 max(-1e30f);
+                for (int c = 0; c < 4; c++)
+                {
+                    int corner = (y + c / 2) * cornerX + x + c % 2;
+                    glm::vec3 a = nearCorners[corner];
+                    glm::vec3 b = farCorners[corner];
+                    for (int d = 0; d < 2; d++)
+                    {
+                        // view space looks down -z
+                        float t = (depths[d] + a.z) / (a.z - b.z);
+                        glm::vec3 point = a + (b - a) * t;
+                        min = glm::min(min, point);
+                        max = glm::max(max, point);
+                    }
+                }
+
+                int index = (z * LIGHT_CLUSTER_Y + y) * LIGHT_CLUSTER_X + x;
+                m_minX[index] = min.x;
+                m_minY[index] = min.y;
+                m_minZ[index] = min.z;
+                m_maxX[index] = max.x;
+                m_maxY[index] = max.y;
+                m_maxZ[index] = max.z;
+            }
+        }
+    }
+}
+
+int LightClusters::getSlice(float depth)
+{
+    int slice = (int)std::floor(std::log(std::max(depth, m_near)) * m_sliceScale + m_sliceBias);
+    return std::min(std::max(slice, 0), LIGHT_CLUSTER_Z - 1);
+}
+
+// center in view space
+void LightClusters::binLight(int lightIndex, const glm::vec3 &center, float radius, const glm::mat4 &projection)
+{
+    int sliceMin = getSlice(-center.z - radius);
+    int sliceMax = getSlice(-center.z + radius);
+
+    // screen rect of the view space box, the whole screen when it crosses the near plane
+    int tileMinX = 0, tileMaxX = LIGHT_CLUSTER_X - 1;
+    int tileMinY = 0, tileMaxY = LIGHT_CLUSTER_Y - 1;
+    if (-center.z - radius > m_near)
+    {
+        glm::vec2 ndcMin(1e30f);
+        glm::vec2 ndcMax(-1e30f);
+        for (int i = 0; i < 8; i++)
+        {
+            glm::vec3 corner = center + glm::vec3(i & 1 ? radius : -radius, i & 2 ? radius : -radius, i & 4 ? radius : -radius);
+            glm::vec4 clip = projection * glm::vec4(corner, 1.f);
+            glm::vec2 ndc = glm::vec2(clip) / clip.w;
+            ndcMin = glm::min(ndcMin, ndc);
+            ndcMax = glm::max(ndcMax, ndc);
+        }
+
+        if (ndcMax.x < -1.f || ndcMin.x > 1.f || ndcMax.y < -1.f || ndcMin.y > 1.f)
+            return;
+
+        tileMinX = std::max((int)((ndcMin.x * 0.5f + 0.5f) * LIGHT_CLUSTER_X), 0);
+        tileMaxX = std::min((int)((ndcMax.x * 0.5f + 0.5f) * LIGHT_CLUSTER_X), LIGHT_CLUSTER_X - 1);
+        tileMinY = std::max((int)((ndcMin.y * 0.5f + 0.5f) * LIGHT_CLUSTER_Y), 0);
+        tileMaxY = std::min((int)((ndcMax.y * 0.5f + 0.5f) * LIGHT_CLUSTER_Y), LIGHT_CLUSTER_Y - 1);
+    }
+
+    float radiusSquared = radius * radius;
+    for (int z = sliceMin; z <= sliceMax; z++)
+    {
+        for (int y = tileMinY; y <= tileMaxY; y++)
+        {
+            int row = (z * LIGHT_CLUSTER_Y + y) * LIGHT_CLUSTER_X;
+
+            // sphere against four cluster boxes of the row at once
+            for (int x = tileMinX & ~3; x <= tileMaxX; x += 4)
+            {
+                int index = row + x;
+                int mask = 0;
+#if defined(LIGHT_CLUSTERS_SSE)
+                __m128 zero = _mm_setzero_ps();
+                __m128 d = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_minX[index]), _mm_set1_ps(center.x)), zero),
+                                      _mm_max_ps(_mm_sub_ps(_mm_set1_ps(center.x), _mm_loadu_ps(&m_maxX[index])), zero));
+                __m128 distance = _mm_mul_ps(d, d);
+                d = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_minY[index]), _mm_set1_ps(center.y)), zero),
+                               _mm_max_ps(_mm_sub_ps(_mm_set1_ps(center.y), _mm_loadu_ps(&m_maxY[index])), zero));
+                distance = _mm_add_ps(distance, _mm_mul_ps(d, d));
+                d = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_minZ[index]), _mm_set1_ps(center.z)), zero),
+                               _mm_max_ps(_mm_sub_ps(_mm_set1_ps(center.z), _mm_loadu_ps(&m_maxZ[index])), zero));
+                distance = _mm_add_ps(distance, _mm_mul_ps(d, d));
+                mask = _mm_movemask_ps(_mm_cmple_ps(distance, _mm_set1_ps(radiusSquared)));
+#else
+                for (int i = 0; i < 4; i++)
+                {
+                    float dx = std::max(m_minX[index + i] - center.x, 0.f) + std::max(center.x - m_maxX[index + i], 0.f);
+                    float dy = std::max(m_minY[index + i] - center.y, 0.f) + std::max(center.y - m_maxY[index + i], 0.f);
+                    float dz = std::max(m_minZ[index + i] - center.z, 0.f) + std::max(center.z - m_maxZ[index + i], 0.f);
+                    if (dx * dx + dy * dy + dz * dz <= radiusSquared)
+                        mask |= 1 << i;
+                }
+#endif
+                for (int i = 0; i < 4; i++)
+                {
+                    if ((mask & (1 << i)) && x + i >= tileMinX && x + i <= tileMaxX)
+                    {
+                        m_pairLights.push_back(lightIndex);
+                        m_pairClusters.push_back(index + i);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void LightClusters::update(const std::vector<LightSource> &lights, const glm::mat4 &view, const glm::mat4 &projection, float near, float far)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if (projection != m_projection || near != m_near || far != m_far)
+        buildGrid(projection, near, far);
+
+    m_lightData.clear();
+    m_visibleLights.clear();
+    m_pairLights.clear();
+    m_pairClusters.clear();
+
+    for (int i = 0; i < lights.size(); i++)
+    {
+        const LightSource &light = lights[i];
+        glm::vec3 center = glm::vec3(view * glm::vec4(light.position, 1.f));
+        if (-center.z + light.radius < near || -center.z - light.radius > far)
+            continue;
+
+        int pairCount = m_pairLights.size();
+        binLight(m_lightData.size() / 2, center, light.radius, projection);
+        if (m_pairLights.size() == pairCount)
+            continue;
+
+        m_lightData.push_back(glm::vec4(light.position, light.radius));
+        m_lightData.push_back(glm::vec4(light.color * light.intensity, 0.f));
+        m_visibleLights.push_back(i);
+    }
+
+    // counting sort of the pairs by cluster
+    std::fill(m_clusterData.begin(), m_clusterData.end(), 0);
+    for (int i = 0; i < m_pairClusters.size(); i++)
+        m_clusterData[m_pairClusters[i] * 2 + 1]++;
+
+    unsigned int offset = 0;
+    int maxClusterLights = 0;
+    for (int i = 0; i < LIGHT_CLUSTER_COUNT; i++)
+    {
+        m_clusterData[i * 2] = offset;
+        offset += m_clusterData[i * 2 + 1];
+        maxClusterLights = std::max(maxClusterLights, (int)m_clusterData[i * 2 + 1]);
+        // counts again while filling
+        m_clusterData[i * 2 + 1] = 0;
+    }
+
+    m_indices.resize(m_pairLights.size());
+    for (int i = 0; i < m_pairLights.size(); i++)
+    {
+        int cluster = m_pairClusters[i];
+        m_indices[m_clusterData[cluster * 2] + m_clusterData[cluster * 2 + 1]++] = m_pairLights[i];
+    }
+
+    // unchanged while the camera and the lights stay still
+    m_clusterBuffer->uploadChanged(m_clusterData.data(), m_clusterData.size() * sizeof(unsigned int));
+    m_indexBuffer->uploadChanged(m_indices.data(), m_indices.size() * sizeof(unsigned int));
+    m_lightBuffer->uploadChanged(m_lightData.data(), m_lightData.size() * sizeof(glm::vec4));
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_stats.lightCount = lights.size();
+    m_stats.visibleCount = m_visibleLights.size();
+    m_stats.indexCount = m_indices.size();
+    m_stats.maxClusterLights = maxClusterLights;
+    m_stats.buildTime = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+void LightClusters::bind()
+{
+    glActiveTexture(GL_TEXTURE0 + LIGHT_CLUSTERS_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, m_clusterTexture);
+    glActiveTexture(GL_TEXTURE0 + LIGHT_CLUSTERS_TEXTURE_UNIT + 1);
+    glBindTexture(GL_TEXTURE_BUFFER, m_indexTexture);
+    glActiveTexture(GL_TEXTURE0 + LIGHT_CLUSTERS_TEXTURE_UNIT + 2);
+    glBindTexture(GL_TEXTURE_BUFFER, m_lightTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
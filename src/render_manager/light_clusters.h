@@ -0,0 +1,81 @@
+#ifndef light_clusters_hpp
+#define light_clusters_hpp
+
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "../stream_buffer/stream_buffer.h"
+
+// screen tiles and exponential depth slices of the cluster grid, x is a multiple of 4
+#define LIGHT_CLUSTER_X 16
+#define LIGHT_CLUSTER_Y 9
+#define LIGHT_CLUSTER_Z 24
+
+// first of the three texture units of the cluster buffers
+#define LIGHT_CLUSTERS_TEXTURE_UNIT 12
+
+struct LightSource;
+
+struct LightClusterStats
+{
+    int lightCount = 0;
+    // inside the view frustum
+    int visibleCount = 0;
+    // light references over all clusters
+    int indexCount = 0;
+    int maxClusterLights = 0;
+    // cpu time of culling, binning and upload, in ms
+    float buildTime = 0.f;
+};
+
+// point lights binned into view space clusters on the cpu
+// a deferred pass finds the lights of a pixel from its cluster instead of drawing a volume per light
+class LightClusters
+{
+public:
+    LightClusters();
+    ~LightClusters();
+
+    LightClusterStats m_stats;
+    // indices into the lights of the last update that touch a cluster
+    std::vector<int> m_visibleLights;
+    // slice of a view depth is log(depth) * m_sliceScale + m_sliceBias
+    float m_sliceScale;
+    float m_sliceBias;
+
+    // culls the lights, bins them and uploads the buffers, view and projection of the shading camera
+    void update(const std::vector<LightSource> &lights, const glm::mat4 &view, const glm::mat4 &projection, float near, float far);
+    // cluster ranges, light indices and light data on three units starting at LIGHT_CLUSTERS_TEXTURE_UNIT
+    void bind();
+
+private:
+    // orphaned, texture buffers take no offset in 4.1
+    // per cluster first index and count
+    StreamBuffer *m_clusterBuffer;
+    StreamBuffer *m_indexBuffer;
+    // position and radius, then color of each visible light
+    StreamBuffer *m_lightBuffer;
+    unsigned int m_clusterTexture, m_indexTexture, m_lightTexture;
+
+    // the grid is rebuilt when these change
+    glm::mat4 m_projection;
+    float m_near, m_far;
+    // view space bounds by cluster index, x fastest
+    std::vector<float> m_minX, m_minY, m_minZ;
+    std::vector<float> m_maxX, m_maxY, m_maxZ;
+
+    std::vector<glm::vec4> m_lightData;
+    // visible light and cluster of every overlap, in light order
+    std::vector<int> m_pairLights;
+    std::vector<int> m_pairClusters;
+    std::vector<unsigned int> m_clusterData;
+    std::vector<unsigned int> m_indices;
+
+    void buildGrid(const glm::mat4 &projection, float near, float far);
+    int getSlice(float depth);
+    void binLight(int lightIndex, const glm::vec3 &center, float radius, const glm::mat4 &projection);
+};
+
+#endif /* light_clusters_hpp */
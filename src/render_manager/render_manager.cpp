@@ -1,20 +1,31 @@
 #include "render_manager.h"
 
-RenderManager::RenderManager(ShaderManager *shaderManager, ResourceManager *resourceManager, Camera *camera)
+// per draw uniforms, hashed at compile time
+static constexpr Uniform<glm::mat4> uniformModel("model");
+static constexpr Uniform<glm::mat4> uniformMVP("MVP");
+static constexpr Uniform<int> uniformBoneOffset("u_boneOffset");
+
+RenderManager::RenderManager(ShaderManager *shaderManager, ResourceManager *resourceManager, JobPool *jobPool, Camera *camera)
     : m_shaderManager(shaderManager),
       m_resourceManager(resourceManager),
+      m_jobPool(jobPool),
       m_camera(camera),
       m_worldOrigin(glm::vec3(0.f)),
       m_shadowBias(glm::vec3(0.015, 0.050, 0.200))
 {
     shaderManager->addShader(ShaderDynamic(&pbrDeferredPre, "assets/shaders/pbr.vs", "assets/shaders/pbr-deferred-pre.fs"));
     shaderManager->addShader(ShaderDynamic(&pbrDeferredPreAnim, "assets/shaders/anim.vs", "assets/shaders/pbr-deferred-pre.fs"));
+    shaderManager->addShader(ShaderDynamic(&pbrDeferredPreInstanced, "assets/shaders/pbr-instanced.vs", "assets/shaders/pbr-deferred-pre.fs"));
     shaderManager->addShader(ShaderDynamic(&pbrDeferredAfter, "assets/shaders/pbr-deferred-after.vs", "assets/shaders/pbr-deferred-after.fs"));
     shaderManager->addShader(ShaderDynamic(&pbrDeferredPointLight, "assets/shaders/pbr-deferred-point-light.vs", "assets/shaders/pbr-deferred-point-light.fs"));
+    shaderManager->addShader(ShaderDynamic(&pbrDeferredClustered, "assets/shaders/pbr-deferred-clustered.vs", "assets/shaders/pbr-deferred-clustered.fs"));
     shaderManager->addShader(ShaderDynamic(&pbrTransmission, "assets/shaders/pbr.vs", "assets/shaders/pbr.fs"));
+    particleUpdateShader.m_feedbackVaryings = ParticleFeedback::getVaryings();
+    shaderManager->addShader(ShaderDynamic(&particleUpdateShader, "assets/shaders/particle-update.vs", "assets/shaders/particle-update.fs", "assets/shaders/particle-update.gs"));
 
     shaderManager->addShader(ShaderDynamic(&depthShader, "assets/shaders/simple-shader.vs", "assets/shaders/depth-shader.fs"));
     shaderManager->addShader(ShaderDynamic(&depthShaderAnim, "assets/shaders/anim.vs", "assets/shaders/depth-shader.fs"));
+    shaderManager->addShader(ShaderDynamic(&depthShaderInstanced, "assets/shaders/simple-shader-instanced.vs", "assets/shaders/depth-shader.fs"));
     shaderManager->addShader(ShaderDynamic(&lightVolume, "assets/shaders/light-volume.vs", "assets/shaders/light-volume.fs"));
     shaderManager->addShader(ShaderDynamic(&lightVolumeDebug, "assets/shaders/light-volume.vs", "assets/shaders/simple-shader.fs"));
 
@@ -67,17 +78,22 @@ RenderManager::RenderManager(ShaderManager *shaderManager, ResourceManager *reso
     std::vector<unsigned int> shaderIds;
     shaderIds.push_back(pbrDeferredPre.id);
     shaderIds.push_back(pbrDeferredPreAnim.id);
+    shaderIds.push_back(pbrDeferredPreInstanced.id);
     // shaderIds.push_back(terrainPBRShader.id);
     // shaderIds.push_back(terrainBasicShader.id);
 
     m_shadowManager = new ShadowManager(m_camera, shaderIds);
     m_shadowmapManager = new ShadowmapManager(m_shadowManager->m_splitCount, 512);
 
-    m_cullingManager = new CullingManager();
+    m_cullingManager = new CullingManager(m_jobPool);
+    m_particleManager = new ParticleManager(m_jobPool, m_camera);
     m_gBuffer = new GBuffer(1, 1);
     m_ssao = new SSAO(1, 1);
     m_postProcess = new PostProcess(1, 1);
     m_bloomManager = new BloomManager(&downsampleShader, &upsampleShader, quad_vao);
+    m_bonePalette = new BonePalette();
+    m_geometryPool = new GeometryPool();
+    m_lightClusters = new LightClusters();
 
     setupLights();
     setWorldOrigin(m_worldOrigin);
@@ -89,6 +105,15 @@ RenderManager::~RenderManager()
     delete m_debugCamera;
     delete m_postProcess;
     delete m_bloomManager;
+    delete m_bonePalette;
+    delete m_geometryPool;
+    delete m_lightClusters;
+    delete m_lightArrayBuffer;
+    delete m_particleManager;
+    delete m_shadowmapManager;
+
+    for (auto &pair : m_particleBillboardShaders)
+        delete pair.second;
 
     for (int i = 0; i < m_pbrSources.size(); i++)
     {
@@ -118,15 +143,22 @@ void RenderManager::setWorldOrigin(glm::vec3 newWorldOrigin)
 
     // udpate for culling manager
     for (int i = 0; i < m_pbrSources.size(); i++)
+    {
         m_cullingManager->updateObject(m_pbrSources[i], m_originTransform * m_pbrSources[i]->transform.getModelMatrix());
+        m_cullingManager->updateOccluder(m_pbrSources[i], m_originTransform * m_pbrSources[i]->modelMatrix);
+    }
 }
 
 void RenderManager::setupLights()
 {
-    glGenBuffers(1, &m_lightArrayBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, m_lightArrayBuffer);
-    // TODO: ?
-    glBufferData(GL_ARRAY_BUFFER, m_pointLights.size() * sizeof(LightInstance), m_lightBufferList.data(), GL_STATIC_DRAW);
+    m_lightArrayBuffer = new StreamBuffer();
+    setupLightInstances(0);
+}
+
+// the instance attributes follow the light buffer to the offset of its last upload
+void RenderManager::setupLightInstances(size_t offset)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, m_lightArrayBuffer->m_buffer);
 
     for (unsigned int i = 0; i < pointLightVolume->meshes.size(); i++)
     {
@@ -136,25 +168,25 @@ void RenderManager::setupLights()
         float size = sizeof(LightInstance);
 
         glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, size, (void *)0);
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, size, (void *)offset);
         glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, size, (void *)(sizeof(glm::vec4)));
+        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, size, (void *)(offset + sizeof(glm::vec4)));
         glEnableVertexAttribArray(5);
-        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, size, (void *)(2 * sizeof(glm::vec4)));
+        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, size, (void *)(offset + 2 * sizeof(glm::vec4)));
         glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, size, (void *)(3 * sizeof(glm::vec4)));
+        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, size, (void *)(offset + 3 * sizeof(glm::vec4)));
 
         glEnableVertexAttribArray(7);
-        glVertexAttribPointer(7, 3, GL_FLOAT, GL_FALSE, size, (void *)offsetof(LightInstance, lightColor));
+        glVertexAttribPointer(7, 3, GL_FLOAT, GL_FALSE, size, (void *)(offset + offsetof(LightInstance, lightColor)));
 
         glEnableVertexAttribArray(8);
-        glVertexAttribPointer(8, 1, GL_FLOAT, GL_FALSE, size, (void *)offsetof(LightInstance, radius));
+        glVertexAttribPointer(8, 1, GL_FLOAT, GL_FALSE, size, (void *)(offset + offsetof(LightInstance, radius)));
 
         glEnableVertexAttribArray(9);
-        glVertexAttribPointer(9, 1, GL_FLOAT, GL_FALSE, size, (void *)offsetof(LightInstance, linear));
+        glVertexAttribPointer(9, 1, GL_FLOAT, GL_FALSE, size, (void *)(offset + offsetof(LightInstance, linear)));
 
         glEnableVertexAttribArray(10);
-        glVertexAttribPointer(10, 1, GL_FLOAT, GL_FALSE, size, (void *)offsetof(LightInstance, quadratic));
+        glVertexAttribPointer(10, 1, GL_FLOAT, GL_FALSE, size, (void *)(offset + offsetof(LightInstance, quadratic)));
 
         glVertexAttribDivisor(3, 1);
         glVertexAttribDivisor(4, 1);
@@ -179,13 +211,102 @@ void RenderManager::updateTransforms()
     }
 }
 
+// poses are independent of each other, evaluate them across the job pool
+// should be called after setupFrame and before renderDepth uploads the bone matrices
+void RenderManager::updateAnimators()
+{
+    for (int i = 0; i < (int)AnimationLod::COUNT; i++)
+        m_animationLodCounts[i] = 0;
+
+    m_dueAnimators.clear();
+    for (int i = 0; i < m_pbrSources.size(); i++)
+    {
+        RenderSource *source = m_pbrSources[i];
+        Animator *animator = source->animator;
+        if (!animator || !animator->m_evaluationPending)
+            continue;
+
+        // same animator could be shared by multiple sources
+        animator->m_evaluationPending = false;
+
+        animator->m_batchBlending = m_batchPoseBlending;
+
+        AnimationLod lod = getAnimationLod(source);
+        animator->setLod(lod, m_animationLod);
+        m_animationLodCounts[(int)lod]++;
+
+        if (lod != AnimationLod::offscreen)
+            m_dueAnimators.push_back(animator);
+    }
+
+    m_jobPool->parallelFor(m_dueAnimators.size(), [this](int start, int end) {
+        for (int i = start; i < end; i++)
+            m_dueAnimators[i]->evaluate();
+    });
+
+    // one upload for every visible or shadow casting skeleton, passes only select the range
+    m_bonePalette->clear();
+    for (int i = 0; i < 2; i++)
+    {
+        std::vector<RenderSource *> &sources = i == 0 ? m_visiblePbrAnimSources : m_shadowAnimSources;
+        for (RenderSource *source : sources)
+            source->paletteOffset = m_bonePalette->add(source->animator->m_finalBoneMatrices);
+    }
+    m_bonePalette->upload();
+}
+
 void RenderManager::addLight(LightSource light)
 {
     m_pointLights.push_back(light);
 }
 
+void RenderManager::addStaticGeometry(Model *model)
+{
+    m_geometryPool->add(model);
+}
+
+void RenderManager::removeStaticGeometry(Model *model)
+{
+    m_geometryPool->remove(model);
+}
+
+void RenderManager::setOccluder(RenderSource *source, bool occluder)
+{
+    source->occluder = occluder;
+    if (!occluder)
+    {
+        m_cullingManager->removeOccluder(source);
+        return;
+    }
+
+    // only vertices used by the coarsest level, offsets baked
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    for (Mesh *mesh : source->model->opaqueMeshes)
+    {
+        const MeshLod &lod = mesh->lods.back();
+        std::vector<int> remap(mesh->vertices.size(), -1);
+        for (int i = lod.firstIndex; i < lod.firstIndex + lod.indexCount; i++)
+        {
+            unsigned int index = i < mesh->indices.size() ? mesh->indices[i] : mesh->lodIndices[i - mesh->indices.size()];
+            if (remap[index] == -1)
+            {
+                remap[index] = positions.size();
+                positions.push_back(glm::vec3(mesh->offset * glm::vec4(mesh->vertices[index].position, 1.f)));
+            }
+            indices.push_back(remap[index]);
+        }
+    }
+
+    m_cullingManager->addOccluder(source, positions, indices);
+    m_cullingManager->updateOccluder(source, m_originTransform * source->modelMatrix);
+}
+
 void RenderManager::setupFrame(GLFWwindow *window)
 {
+    m_frameIndex++;
+    StreamBuffer::beginFrame();
+
     // clear window
     glClearColor(0.f, 0.f, 0.f, 1.f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -218,24 +339,41 @@ void RenderManager::setupFrame(GLFWwindow *window)
         m_debugCamera->m_far = m_camera->m_far;
     }
 
+    // starts rasterizing occluders on a worker
+    m_cullingManager->setupFrame(m_cullViewProjection);
+
     // setup shadowmap
     if (m_debugCulling)
         m_shadowManager->m_camera = m_debugCamera;
     else
         m_shadowManager->m_camera = m_camera;
+    m_shadowManager->m_stableCascades = m_shadowCache.enabled;
+    m_shadowManager->m_shadowmapSize = m_shadowmapManager->getSize();
     m_shadowManager->setupFrustum((float)m_screenW, (float)m_screenH, m_cullProjection, m_worldOrigin);
     m_depthViewMatrix = m_shadowManager->getDepthViewMatrix();
     m_inverseDepthViewMatrix = glm::inverse(m_depthViewMatrix);
 
+    // caster volumes of the cascades are culled on the job pool along with the view
+    std::vector<CullVolume> &volumes = m_cullingManager->m_volumes;
+    volumes.resize(m_shadowManager->m_splitCount);
+    for (int i = 0; i < volumes.size(); i++)
+        m_shadowManager->getCasterPlanes(i, volumes[i].planes);
+
     // view frustum culling
-    m_cullingManager->setupFrame(m_cullViewProjection);
     m_visiblePbrSources.clear();
     m_visiblePbrAnimSources.clear();
 
-    std::vector<SelectedObject> objects = m_cullingManager->getObjects(m_shadowManager->m_aabb.min,
-                                                                       m_shadowManager->m_aabb.max,
-                                                                       m_cullViewPos);
-    std::vector<aabb> objectAabbs;
+    for (int i = 0; i < m_pbrSources.size(); i++)
+    {
+        m_pbrSources[i]->cullIndex = -1;
+        m_pbrSources[i]->shadowCascades = 0;
+    }
+
+    std::vector<SelectedObject> &objects = m_cullingManager->getObjects(m_shadowManager->m_aabb.min,
+                                                                        m_shadowManager->m_aabb.max,
+                                                                        m_cullViewPos);
+    m_cullingManager->testOcclusion(objects);
+    m_visibleAabbs.clear();
 
     for (int i = 0; i < objects.size(); i++)
     {
@@ -243,7 +381,8 @@ void RenderManager::setupFrame(GLFWwindow *window)
         RenderSource *source = static_cast<RenderSource *>(object.userPointer);
 
         source->cullIndex = i;
-        objectAabbs.push_back(aabb(object.aabbMin, object.aabbMax));
+        source->occluded = object.occluded;
+        m_visibleAabbs.push_back(aabb(object.aabbMin, object.aabbMax));
 
         if (source->animator)
             m_visiblePbrAnimSources.push_back(source);
@@ -251,7 +390,31 @@ void RenderManager::setupFrame(GLFWwindow *window)
             m_visiblePbrSources.push_back(source);
     }
 
-    m_shadowManager->setupLightAabb(objectAabbs);
+    // casters outside the view are drawn into the shadow maps only
+    m_shadowCasters.resize(volumes.size());
+    m_casterAabbs.resize(volumes.size());
+    m_shadowAnimSources.clear();
+    for (int i = 0; i < volumes.size(); i++)
+    {
+        m_shadowCasters[i].clear();
+        m_casterAabbs[i].clear();
+
+        for (const SelectedObject &object : volumes[i].objects)
+        {
+            RenderSource *source = static_cast<RenderSource *>(object.userPointer);
+            if (source->cullIndex == -1 && source->shadowCascades == 0 && source->animator)
+                m_shadowAnimSources.push_back(source);
+
+            source->shadowCascades |= 1 << i;
+            m_shadowCasters[i].push_back(source);
+            m_casterAabbs[i].push_back(aabb(object.aabbMin, object.aabbMax));
+        }
+    }
+
+    m_shadowManager->setupLightAabb(m_casterAabbs);
+    updateMeshLods();
+    updateShadowCache();
+    buildRenderQueue();
 
     // TODO: variable size
     const std::vector<float> &frustumDistances = m_shadowManager->m_frustumDistances;
@@ -264,15 +427,22 @@ void RenderManager::setupFrame(GLFWwindow *window)
 void RenderManager::renderDepth()
 {
     m_shadowmapManager->bindFramebuffer();
-    // TODO: frustum culling per split
+    m_bonePalette->bind();
+
+    // stable cascades leave casters nearer to the light than their box to depth clamping
+    if (m_shadowCache.enabled)
+        glEnable(GL_DEPTH_CLAMP);
+
     for (int i = 0; i < m_shadowManager->m_splitCount; i++)
     {
+        const ShadowCascadeCache &cache = m_cascadeCaches[i];
+        if (!cache.update)
+            continue;
+
         m_frustumIndex = i;
-        m_shadowmapManager->bindTextureArray(i);
         m_depthP = m_shadowManager->m_depthPMatrices[i];
         m_depthVP = m_depthP * m_depthViewMatrix;
 
-        // Draw each terrain
         glm::vec3 nearPlaneEdges[4];
         for (int j = 0; j < 4; j++)
         {
@@ -282,58 +452,64 @@ void RenderManager::renderDepth()
         }
         m_depthNearPlaneCenter = (nearPlaneEdges[0] + nearPlaneEdges[1] + nearPlaneEdges[2] + nearPlaneEdges[3]) / 4.0f;
 
-        // render each renderable
-        for (int i = 0; i < m_renderables.size(); i++)
+        if (!m_shadowCache.enabled)
         {
-            Renderable *renderable = m_renderables[i];
-            renderable->renderDepth();
+            m_shadowmapManager->bindTextureArray(i);
+            renderDepthPass((RenderPass)((int)RenderPass::depth + i), true);
+            continue;
         }
 
-        // Draw objects
-        glEnable(GL_CULL_FACE);
-        glFrontFace(GL_CCW);
-        if (m_cullFront)
-            glCullFace(GL_FRONT);
-        else
-            glCullFace(GL_BACK);
-
-        // draw each object
-        for (int i = 0; i < m_visiblePbrSources.size(); i++)
+        // terrain and other renderables are static
+        if (cache.rebuild)
         {
-            RenderSource *source = m_visiblePbrSources[i];
+            m_shadowmapManager->bindCacheLayer(i);
+            renderDepthPass((RenderPass)((int)RenderPass::staticDepth + i), true);
+        }
 
-            if (!inShadowFrustum(source, m_frustumIndex))
-                continue;
+        m_shadowmapManager->restoreCacheLayer(i);
+        renderDepthPass((RenderPass)((int)RenderPass::depth + i), false);
+    }
 
-            depthShader.use();
-            depthShader.setMat4("MVP", m_depthVP * m_originTransform * source->modelMatrix);
-            source->model->draw(depthShader, true);
-        }
-        for (int i = 0; i < m_visiblePbrAnimSources.size(); i++)
-        {
-            RenderSource *source = m_visiblePbrAnimSources[i];
+    glDisable(GL_DEPTH_CLAMP);
+}
 
-            if (!inShadowFrustum(source, m_frustumIndex))
-                continue;
+// into the bound layer with the matrices of m_frustumIndex
+void RenderManager::renderDepthPass(RenderPass pass, bool renderables)
+{
+    // render each renderable
+    for (int i = 0; i < m_renderables.size() && renderables; i++)
+    {
+        Renderable *renderable = m_renderables[i];
+        renderable->renderDepth();
+    }
 
-            if (source->animator)
-            {
-                depthShaderAnim.use();
-                depthShaderAnim.setMat4("projection", m_depthP);
-                depthShaderAnim.setMat4("view", m_depthViewMatrix);
+    // Draw objects
+    glFrontFace(GL_CCW);
 
-                // TODO: set as block
-                auto transforms = source->animator->m_finalBoneMatrices;
-                for (int i = 0; i < transforms.size(); ++i)
-                    depthShaderAnim.setMat4("finalBonesMatrices[" + std::to_string(i) + "]", transforms[i]);
+    depthShaderAnim.use();
+    depthShaderAnim.setMat4("projection", m_depthP);
+    depthShaderAnim.setMat4("view", m_depthViewMatrix);
+    depthShaderAnim.setInt("u_bonePalette", BONE_PALETTE_TEXTURE_UNIT);
 
-                depthShaderAnim.setMat4("model", m_originTransform * source->modelMatrix);
-                source->model->draw(depthShaderAnim, true);
+    m_renderQueue.submit(
+        pass,
+        [this](const DrawItem &item, bool instanced) {
+            RenderSource *source = item.source;
+            if (instanced)
+            {
+                depthShaderInstanced.set(uniformMVP, m_depthVP * m_originTransform);
             }
-        }
-
-        glDisable(GL_CULL_FACE);
-    }
+            else if (source->animator)
+            {
+                depthShaderAnim.set(uniformBoneOffset, source->paletteOffset);
+                depthShaderAnim.set(uniformModel, m_originTransform * source->modelMatrix);
+            }
+            else
+            {
+                depthShader.set(uniformMVP, m_depthVP * m_originTransform * source->modelMatrix);
+            }
+        },
+        nullptr, m_frustumIndex + 1);
 }
 
 void RenderManager::renderOpaque()
@@ -363,97 +539,41 @@ void RenderManager::renderOpaque()
 
     glFrontFace(GL_CCW);
 
-    if (!m_visiblePbrSources.empty())
+    // frame uniforms of both programs, draws come from the queue in key order
+    Shader *shaders[3] = {&pbrDeferredPre, &pbrDeferredPreAnim, &pbrDeferredPreInstanced};
+    for (int i = 0; i < 3; i++)
     {
-        // setup pbr shader
-        pbrDeferredPre.use();
-        pbrDeferredPre.setMat4("view", m_view);
-        pbrDeferredPre.setMat4("projection", m_projection);
-        pbrDeferredPre.setVec3("lightDirection", m_shadowManager->m_lightPos);
-        pbrDeferredPre.setVec4("FrustumDistances", m_frustumDistances);
-        pbrDeferredPre.setVec3("u_camPosition", m_camera->position);
-        pbrDeferredPre.setFloat("u_shadowFar", m_shadowManager->m_far);
-        pbrDeferredPre.setVec3("Bias", m_shadowBias);
-
-        glActiveTexture(GL_TEXTURE0 + 8);
-        glUniform1i(glGetUniformLocation(pbrDeferredPre.id, "ShadowMap"), 8);
-        glBindTexture(GL_TEXTURE_2D_ARRAY, m_shadowmapManager->m_textureArray);
-
-        // draw each pbr
-        for (int i = 0; i < m_visiblePbrSources.size(); i++)
-        {
-            RenderSource *source = m_visiblePbrSources[i];
-            pbrDeferredPre.setMat4("model", m_originTransform * source->modelMatrix);
-
-            if (source->faceCullType == FaceCullType::none)
-                glDisable(GL_CULL_FACE);
-            else
-                glEnable(GL_CULL_FACE);
-
-            if (source->faceCullType == FaceCullType::backFaces)
-                glCullFace(GL_BACK);
-            else if (source->faceCullType == FaceCullType::frontFaces)
-                glCullFace(GL_FRONT);
-
-            if (source->polygonMode == PolygonMode::fill)
-                glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-            else if (source->polygonMode == PolygonMode::line)
-                glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-            else if (source->polygonMode == PolygonMode::point)
-                glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
-
-            source->model->draw(pbrDeferredPre, true);
-        }
-
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        Shader *shader = shaders[i];
+        shader->use();
+        shader->setMat4("view", m_view);
+        shader->setMat4("projection", m_projection);
+        shader->setVec3("lightDirection", m_shadowManager->m_lightPos);
+        shader->setVec4("FrustumDistances", m_frustumDistances);
+        shader->setVec3("u_camPosition", m_camera->position);
+        shader->setFloat("u_shadowFar", m_shadowManager->m_far);
+        shader->setVec3("Bias", m_shadowBias);
+        shader->setInt("ShadowMap", 8);
     }
+    pbrDeferredPreAnim.setInt("u_bonePalette", BONE_PALETTE_TEXTURE_UNIT);
 
-    // setup pbr anim shader
-    if (!m_visiblePbrAnimSources.empty())
-    {
-        pbrDeferredPreAnim.use();
-        pbrDeferredPreAnim.setMat4("view", m_view);
-        pbrDeferredPreAnim.setMat4("projection", m_projection);
-        pbrDeferredPreAnim.setVec3("lightDirection", m_shadowManager->m_lightPos);
-        pbrDeferredPreAnim.setVec4("FrustumDistances", m_frustumDistances);
-        pbrDeferredPreAnim.setVec3("u_camPosition", m_camera->position);
-        pbrDeferredPreAnim.setFloat("u_shadowFar", m_shadowManager->m_far);
-        pbrDeferredPreAnim.setVec3("Bias", m_shadowBias);
-
-        glActiveTexture(GL_TEXTURE0 + 8);
-        glUniform1i(glGetUniformLocation(pbrDeferredPreAnim.id, "ShadowMap"), 8);
-        glBindTexture(GL_TEXTURE_2D_ARRAY, m_shadowmapManager->m_textureArray);
+    glActiveTexture(GL_TEXTURE0 + 8);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_shadowmapManager->m_textureArray);
+    m_bonePalette->bind();
 
-        // render each anim
-        for (int i = 0; i < m_visiblePbrAnimSources.size(); i++)
+    m_renderQueue.submit(RenderPass::opaque, [this](const DrawItem &item, bool instanced) {
+        RenderSource *source = item.source;
+        if (instanced)
         {
-            RenderSource *source = m_visiblePbrAnimSources[i];
-
-            if (source->animator)
-            {
-                // TODO: set as block
-                auto transforms = source->animator->m_finalBoneMatrices;
-                for (int i = 0; i < transforms.size(); ++i)
-                    pbrDeferredPreAnim.setMat4("finalBonesMatrices[" + std::to_string(i) + "]", transforms[i]);
-            }
-
-            pbrDeferredPreAnim.setMat4("model", m_originTransform * source->modelMatrix);
-
-            if (source->faceCullType == FaceCullType::none)
-                glDisable(GL_CULL_FACE);
-            else
-                glEnable(GL_CULL_FACE);
-
-            if (source->faceCullType == FaceCullType::backFaces)
-                glCullFace(GL_BACK);
-            else if (source->faceCullType == FaceCullType::frontFaces)
-                glCullFace(GL_FRONT);
-
-            source->model->draw(pbrDeferredPreAnim, true);
+            // model matrices are per instance, only the origin is shared
+            pbrDeferredPreInstanced.set(uniformModel, m_originTransform);
+            return;
         }
-    }
 
-    glDisable(GL_CULL_FACE);
+        if (source->animator)
+            item.shader->set(uniformBoneOffset, source->paletteOffset);
+
+        item.shader->set(uniformModel, m_originTransform * source->modelMatrix);
+    });
 }
 
 void RenderManager::renderSSAO()
@@ -464,8 +584,7 @@ void RenderManager::renderSSAO()
 
     shaderSSAO.use();
     // Send kernel + rotation
-    for (unsigned int i = 0; i < 64; ++i)
-        shaderSSAO.setVec3("samples[" + std::to_string(i) + "]", m_ssao->ssaoKernel[i]);
+    shaderSSAO.setVec3("samples", m_ssao->ssaoKernel.data(), 64);
     shaderSSAO.setMat4("projection", m_projection);
     shaderSSAO.setMat4("view", m_view);
     shaderSSAO.setInt("kernelSize", m_ssao->kernelSize);
@@ -476,14 +595,14 @@ void RenderManager::renderSSAO()
     shaderSSAO.setVec2("noiseScale", glm::vec2(m_screenW, m_screenH) / (float)m_ssao->noiseSize);
 
     glActiveTexture(GL_TEXTURE0);
-    glUniform1i(glGetUniformLocation(shaderSSAO.id, "gPosition"), 0);
+    shaderSSAO.setInt("gPosition", 0);
     glBindTexture(GL_TEXTURE_2D, m_gBuffer->m_gPosition);
     glActiveTexture(GL_TEXTURE0 + 1);
-    glUniform1i(glGetUniformLocation(shaderSSAO.id, "gNormal"), 1);
+    shaderSSAO.setInt("gNormal", 1);
     glBindTexture(GL_TEXTURE_2D, m_gBuffer->m_gNormalShadow);
 
     glActiveTexture(GL_TEXTURE0 + 2);
-    glUniform1i(glGetUniformLocation(shaderSSAO.id, "texNoise"), 2);
+    shaderSSAO.setInt("texNoise", 2);
     glBindTexture(GL_TEXTURE_2D, m_ssao->noiseTexture);
 
     glBindVertexArray(quad_vao);
@@ -498,7 +617,7 @@ void RenderManager::renderSSAO()
     shaderSSAOBlur.use();
 
     glActiveTexture(GL_TEXTURE0);
-    glUniform1i(glGetUniformLocation(shaderSSAOBlur.id, "ssaoInput"), 0);
+    shaderSSAOBlur.setInt("ssaoInput", 0);
     glBindTexture(GL_TEXTURE_2D, m_ssao->ssaoColorBuffer);
 
     glBindVertexArray(quad_vao);
@@ -545,35 +664,35 @@ void RenderManager::renderDeferredShading()
     pbrDeferredAfter.setVec4("fogColor", fogColor);
 
     glActiveTexture(GL_TEXTURE0 + 0);
-    glUniform1i(glGetUniformLocation(pbrDeferredAfter.id, "gPosition"), 0);
+    pbrDeferredAfter.setInt("gPosition", 0);
     glBindTexture(GL_TEXTURE_2D, m_gBuffer->m_gPosition);
 
     glActiveTexture(GL_TEXTURE0 + 1);
-    glUniform1i(glGetUniformLocation(pbrDeferredAfter.id, "gNormalShadow"), 1);
+    pbrDeferredAfter.setInt("gNormalShadow", 1);
     glBindTexture(GL_TEXTURE_2D, m_gBuffer->m_gNormalShadow);
 
     glActiveTexture(GL_TEXTURE0 + 2);
-    glUniform1i(glGetUniformLocation(pbrDeferredAfter.id, "gAlbedo"), 2);
+    pbrDeferredAfter.setInt("gAlbedo", 2);
     glBindTexture(GL_TEXTURE_2D, m_gBuffer->m_gAlbedo);
 
     glActiveTexture(GL_TEXTURE0 + 3);
-    glUniform1i(glGetUniformLocation(pbrDeferredAfter.id, "gAoRoughMetal"), 3);
+    pbrDeferredAfter.setInt("gAoRoughMetal", 3);
     glBindTexture(GL_TEXTURE_2D, m_gBuffer->m_gAoRoughMetal);
 
     glActiveTexture(GL_TEXTURE0 + 4);
-    glUniform1i(glGetUniformLocation(pbrDeferredAfter.id, "ssaoSampler"), 4);
+    pbrDeferredAfter.setInt("ssaoSampler", 4);
     glBindTexture(GL_TEXTURE_2D, m_ssao->ssaoColorBufferBlur);
 
     glActiveTexture(GL_TEXTURE0 + 8);
-    glUniform1i(glGetUniformLocation(pbrDeferredAfter.id, "irradianceMap"), 8);
+    pbrDeferredAfter.setInt("irradianceMap", 8);
     glBindTexture(GL_TEXTURE_CUBE_MAP, m_pbrManager->irradianceMap);
 
     glActiveTexture(GL_TEXTURE0 + 9);
-    glUniform1i(glGetUniformLocation(pbrDeferredAfter.id, "prefilterMap"), 9);
+    pbrDeferredAfter.setInt("prefilterMap", 9);
     glBindTexture(GL_TEXTURE_CUBE_MAP, m_pbrManager->prefilterMap);
 
     glActiveTexture(GL_TEXTURE0 + 10);
-    glUniform1i(glGetUniformLocation(pbrDeferredAfter.id, "brdfLUT"), 10);
+    pbrDeferredAfter.setInt("brdfLUT", 10);
     glBindTexture(GL_TEXTURE_2D, m_pbrManager->brdfLUTTexture);
 
     glDepthMask(GL_FALSE);
@@ -589,10 +708,18 @@ void RenderManager::renderDeferredShading()
     skyboxShader.setVec3("sunDirection", m_shadowManager->m_lightPos);
     skyboxShader.setVec3("sunColor", m_sunColor * m_sunIntensity);
     glActiveTexture(GL_TEXTURE0);
-    glUniform1i(glGetUniformLocation(skyboxShader.id, "environmentMap"), 0);
+    skyboxShader.setInt("environmentMap", 0);
     glBindTexture(GL_TEXTURE_CUBE_MAP, m_pbrManager->envCubemap);
     cube->draw(skyboxShader);
 
+    // the debug views draw the volumes
+    if (m_clusteredLighting && !m_lightSurfaceDebug && !m_lightAreaDebug)
+    {
+        glDisable(GL_STENCIL_TEST);
+        renderClusteredLights();
+        return;
+    }
+
     // TODO: frustum culling
 
     std::vector<LightSource> lightsInsideCam;
@@ -679,19 +806,19 @@ void RenderManager::renderLightVolumes(std::vector<LightSource> &lights, bool ca
         pbrDeferredPointLight.setVec2("screenSize", glm::vec2(m_screenW, m_screenH));
 
         glActiveTexture(GL_TEXTURE0 + 0);
-        glUniform1i(glGetUniformLocation(pbrDeferredPointLight.id, "gPosition"), 0);
+        pbrDeferredPointLight.setInt("gPosition", 0);
         glBindTexture(GL_TEXTURE_2D, m_gBuffer->m_gPosition);
 
         glActiveTexture(GL_TEXTURE0 + 1);
-        glUniform1i(glGetUniformLocation(pbrDeferredPointLight.id, "gNormalShadow"), 1);
+        pbrDeferredPointLight.setInt("gNormalShadow", 1);
         glBindTexture(GL_TEXTURE_2D, m_gBuffer->m_gNormalShadow);
 
         glActiveTexture(GL_TEXTURE0 + 2);
-        glUniform1i(glGetUniformLocation(pbrDeferredPointLight.id, "gAlbedo"), 2);
+        pbrDeferredPointLight.setInt("gAlbedo", 2);
         glBindTexture(GL_TEXTURE_2D, m_gBuffer->m_gAlbedo);
 
         glActiveTexture(GL_TEXTURE0 + 3);
-        glUniform1i(glGetUniformLocation(pbrDeferredPointLight.id, "gAoRoughMetal"), 3);
+        pbrDeferredPointLight.setInt("gAoRoughMetal", 3);
         glBindTexture(GL_TEXTURE_2D, m_gBuffer->m_gAoRoughMetal);
 
         pointLightVolume->drawInstanced(pbrDeferredPointLight, lights.size());
@@ -731,7 +858,78 @@ void RenderManager::renderLightVolumes(std::vector<LightSource> &lights, bool ca
     glCullFace(GL_BACK);
     glDisable(GL_CULL_FACE);
 
-    // light points
+    renderLightPoints(lights.size());
+}
+
+void RenderManager::renderClusteredLights()
+{
+    if (m_pointLights.size() == 0)
+        return;
+
+    m_lightClusters->update(m_pointLights, m_view, m_projection, m_camera->m_near, m_camera->m_far);
+
+    // a fullscreen pass on the far plane, the greater test leaves the sky out
+    glDepthFunc(GL_GREATER);
+    glDepthMask(GL_FALSE);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glBlendEquation(GL_FUNC_ADD);
+
+    pbrDeferredClustered.use();
+    pbrDeferredClustered.setMat4("view", m_view);
+    pbrDeferredClustered.setVec3("camPos", m_camera->position + m_worldOrigin);
+    pbrDeferredClustered.setVec2("screenSize", glm::vec2(m_screenW, m_screenH));
+    pbrDeferredClustered.setInt("clusterCountX", LIGHT_CLUSTER_X);
+    pbrDeferredClustered.setInt("clusterCountY", LIGHT_CLUSTER_Y);
+    pbrDeferredClustered.setInt("clusterCountZ", LIGHT_CLUSTER_Z);
+    pbrDeferredClustered.setFloat("sliceScale", m_lightClusters->m_sliceScale);
+    pbrDeferredClustered.setFloat("sliceBias", m_lightClusters->m_sliceBias);
+
+    glActiveTexture(GL_TEXTURE0 + 0);
+    pbrDeferredClustered.setInt("gPosition", 0);
+    glBindTexture(GL_TEXTURE_2D, m_gBuffer->m_gPosition);
+
+    glActiveTexture(GL_TEXTURE0 + 1);
+    pbrDeferredClustered.setInt("gNormalShadow", 1);
+    glBindTexture(GL_TEXTURE_2D, m_gBuffer->m_gNormalShadow);
+
+    glActiveTexture(GL_TEXTURE0 + 2);
+    pbrDeferredClustered.setInt("gAlbedo", 2);
+    glBindTexture(GL_TEXTURE_2D, m_gBuffer->m_gAlbedo);
+
+    glActiveTexture(GL_TEXTURE0 + 3);
+    pbrDeferredClustered.setInt("gAoRoughMetal", 3);
+    glBindTexture(GL_TEXTURE_2D, m_gBuffer->m_gAoRoughMetal);
+
+    pbrDeferredClustered.setInt("clusterLights", LIGHT_CLUSTERS_TEXTURE_UNIT);
+    pbrDeferredClustered.setInt("lightIndices", LIGHT_CLUSTERS_TEXTURE_UNIT + 1);
+    pbrDeferredClustered.setInt("lightData", LIGHT_CLUSTERS_TEXTURE_UNIT + 2);
+    m_lightClusters->bind();
+
+    glBindVertexArray(quad_vao);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+
+    glDisable(GL_BLEND);
+    glDepthFunc(GL_LEQUAL);
+    glDepthMask(GL_TRUE);
+
+    // markers cost a draw instance per light, only the visible ones and only when debugging
+    if (m_lightPointDebug)
+    {
+        m_visiblePointLights.clear();
+        for (int index : m_lightClusters->m_visibleLights)
+            m_visiblePointLights.push_back(m_pointLights[index]);
+
+        updateLightBuffer(m_visiblePointLights);
+        renderLightPoints(m_visiblePointLights.size());
+    }
+}
+
+// markers at the light positions from the instanced light buffer
+void RenderManager::renderLightPoints(int count)
+{
     lightVolume.use();
     lightVolume.setMat4("projection", m_projection);
     lightVolume.setMat4("view", m_view);
@@ -740,10 +938,9 @@ void RenderManager::renderLightVolumes(std::vector<LightSource> &lights, bool ca
     model = glm::scale(model, glm::vec3(0.01f));
     lightVolume.setMat4("model", model);
     // TODO: bilboarded circle
-    pointLightVolume->drawInstanced(lightVolume, lights.size());
+    pointLightVolume->drawInstanced(lightVolume, count);
 }
 
-// TODO: only update changed
 void RenderManager::updateLightBuffer(std::vector<LightSource> &lights)
 {
     m_lightBufferList.clear();
@@ -764,33 +961,22 @@ void RenderManager::updateLightBuffer(std::vector<LightSource> &lights)
         m_lightBufferList.push_back(lightInstance);
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_lightArrayBuffer);
-    glBufferData(GL_ARRAY_BUFFER, m_lightBufferList.size() * sizeof(LightInstance), m_lightBufferList.data(), GL_STATIC_DRAW);
+    // skipped while the lights are unchanged
+    int offset = m_lightArrayBuffer->uploadChanged(m_lightBufferList.data(), m_lightBufferList.size() * sizeof(LightInstance));
+    setupLightInstances(offset);
 }
 
 void RenderManager::renderBlend()
 {
-    if (m_particleSources.empty() && m_transparentRenderables.empty())
+    if (m_particleManager->m_sources.empty() && m_transparentRenderables.empty())
         return;
 
     glDepthMask(GL_FALSE);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    // render particle engines
-    for (int i = 0; i < m_particleSources.size(); i++)
-    {
-        ParticleEngine *particle = m_particleSources[i]->particleEngine;
-        if (m_particleSources[i]->transformLink)
-        {
-            // TODO: refactor
-            glm::mat4 model = m_particleSources[i]->transformLink->getModelMatrix();
-            particle->m_position = CommonUtil::positionFromModel(model);
-            particle->m_direction = glm::normalize(glm::mat3(model) * glm::vec3(0.f, 0.f, 1.f));
-        }
-
-        particle->drawParticles(m_particleSources[i]->shader, m_viewProjection, m_worldOrigin);
-    }
+    // render particle engines, simulated and packed by the particle manager
+    m_particleManager->draw(m_viewProjection, m_worldOrigin);
 
     // render transparent renderables
     for (int i = 0; i < m_transparentRenderables.size(); i++)
@@ -846,23 +1032,23 @@ void RenderManager::renderTransmission()
     pbrTransmission.setVec2("u_TransmissionFramebufferSize", glm::vec2(m_screenW, m_screenH));
 
     glActiveTexture(GL_TEXTURE0 + 8);
-    glUniform1i(glGetUniformLocation(pbrTransmission.id, "irradianceMap"), 8);
+    pbrTransmission.setInt("irradianceMap", 8);
     glBindTexture(GL_TEXTURE_CUBE_MAP, m_pbrManager->irradianceMap);
 
     glActiveTexture(GL_TEXTURE0 + 9);
-    glUniform1i(glGetUniformLocation(pbrTransmission.id, "prefilterMap"), 9);
+    pbrTransmission.setInt("prefilterMap", 9);
     glBindTexture(GL_TEXTURE_CUBE_MAP, m_pbrManager->prefilterMap);
 
     glActiveTexture(GL_TEXTURE0 + 10);
-    glUniform1i(glGetUniformLocation(pbrTransmission.id, "brdfLUT"), 10);
+    pbrTransmission.setInt("brdfLUT", 10);
     glBindTexture(GL_TEXTURE_2D, m_pbrManager->brdfLUTTexture);
 
     glActiveTexture(GL_TEXTURE0 + 11);
-    glUniform1i(glGetUniformLocation(pbrTransmission.id, "ShadowMap"), 11);
+    pbrTransmission.setInt("ShadowMap", 11);
     glBindTexture(GL_TEXTURE_2D_ARRAY, m_shadowmapManager->m_textureArray);
 
     glActiveTexture(GL_TEXTURE0 + 12);
-    glUniform1i(glGetUniformLocation(pbrTransmission.id, "u_TransmissionFramebufferSampler"), 12);
+    pbrTransmission.setInt("u_TransmissionFramebufferSampler", 12);
     glBindTexture(GL_TEXTURE_2D, m_postProcess->m_texture);
 
     // TODO: only blend transparent meshes
@@ -874,7 +1060,9 @@ void RenderManager::renderTransmission()
     for (int i = 0; i < m_visiblePbrSources.size(); i++)
     {
         RenderSource *source = m_visiblePbrSources[i];
-        pbrTransmission.setMat4("model", m_originTransform * source->transform.getModelMatrix());
+        if (source->occluded)
+            continue;
+        pbrTransmission.set(uniformModel, m_originTransform * source->transform.getModelMatrix());
         source->model->draw(pbrTransmission, false);
     }
 
@@ -913,11 +1101,11 @@ void RenderManager::renderPostProcess()
     postProcessShader.setFloat("u_gamma", m_postProcess->m_gamma);
 
     glActiveTexture(GL_TEXTURE0);
-    glUniform1i(glGetUniformLocation(postProcessShader.id, "renderedTexture"), 0);
+    postProcessShader.setInt("renderedTexture", 0);
     glBindTexture(GL_TEXTURE_2D, m_postProcess->m_texture);
 
     glActiveTexture(GL_TEXTURE0 + 1);
-    glUniform1i(glGetUniformLocation(postProcessShader.id, "bloomTexture"), 1);
+    postProcessShader.setInt("bloomTexture", 1);
     glBindTexture(GL_TEXTURE_2D, m_bloomManager->bloomTexture());
 
     glBindVertexArray(quad_vao);
@@ -950,6 +1138,8 @@ void RenderManager::addSource(RenderSource *source)
 void RenderManager::removeSource(RenderSource *source)
 {
     m_cullingManager->removeObject(source);
+    m_cullingManager->removeOccluder(source);
+    invalidateShadowCache(source->cachedCascades);
 
     auto it = std::find(m_pbrSources.begin(), m_pbrSources.end(), source);
     if (it != m_pbrSources.end())
@@ -961,11 +1151,55 @@ void RenderManager::removeSource(RenderSource *source)
         if (it != m_linkSources.end())
             m_linkSources.erase(it);
     }
+
+    // models are shared, pooled ranges are released with the last source drawing them
+    if (source->model && !source->model->meshes.empty() && source->model->meshes[0]->pool)
+    {
+        auto sameModel = [source](RenderSource *other) { return other->model == source->model; };
+        if (std::none_of(m_pbrSources.begin(), m_pbrSources.end(), sameModel))
+            removeStaticGeometry(source->model);
+    }
 }
 
 void RenderManager::addParticleSource(RenderParticleSource *source)
 {
-    m_particleSources.push_back(source);
+    m_particleManager->addSource(source);
+}
+
+void RenderManager::setParticleBackend(RenderParticleSource *source, ParticleBackend backend)
+{
+    if (backend == ParticleBackend::gpu)
+    {
+        source->billboardShader = getParticleBillboardShader(source->shader);
+        if (!source->billboardShader)
+            return;
+    }
+
+    source->particleEngine->setBackend(backend, &particleUpdateShader);
+}
+
+// the effect keeps its fragment shader, the billboard vertex and geometry shaders take the feedback points
+Shader *RenderManager::getParticleBillboardShader(Shader *effectShader)
+{
+    auto effect = std::find_if(m_shaderManager->m_shaderList.begin(), m_shaderManager->m_shaderList.end(),
+                               [effectShader](const ShaderDynamic &shader) { return shader.m_shader == effectShader; });
+    if (effect == m_shaderManager->m_shaderList.end())
+    {
+        std::cout << "RenderManager: particle shader is not managed, gpu backend needs its fragment shader path" << std::endl;
+        return nullptr;
+    }
+
+    auto it = m_particleBillboardShaders.find(effect->m_fsPath);
+    if (it != m_particleBillboardShaders.end())
+        return it->second;
+
+    // copied, addShader grows the list
+    std::string fsPath = effect->m_fsPath;
+    Shader *shader = new Shader();
+    m_shaderManager->addShader(ShaderDynamic(shader, "assets/shaders/particle-billboard.vs", fsPath, "assets/shaders/particle-billboard.gs"));
+    m_particleBillboardShaders[fsPath] = shader;
+
+    return shader;
 }
 
 void RenderManager::addRenderable(Renderable *renderable)
@@ -980,16 +1214,255 @@ void RenderManager::removeRenderable(Renderable *renderable)
         m_renderables.erase(it);
 }
 
-bool RenderManager::inShadowFrustum(RenderSource *source, int frustumIndex)
+// culled sources are off-screen, others are ranked by distance and projected size
+// shadows of off-screen casters are still seen, they keep moving at a reduced rate
+AnimationLod RenderManager::getAnimationLod(RenderSource *source)
 {
+    if (!m_animationLod.enabled)
+        return AnimationLod::full;
+
     if (source->cullIndex == -1)
-        return false;
+        return source->shadowCascades ? AnimationLod::reducedRate : AnimationLod::offscreen;
+
+    const aabb &bounds = m_visibleAabbs[source->cullIndex];
+    glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+    float radius = glm::length(bounds.max - bounds.min) * 0.5f;
+    float distance = std::max(glm::distance(center, m_cullViewPos), 0.001f);
+
+    if (distance > m_animationLod.reducedRateDistance)
+        return AnimationLod::reducedRate;
+
+    // fraction of the screen height covered by the bounding sphere
+    float screenSize = radius * m_cullProjection[1][1] / distance;
+    if (screenSize < m_animationLod.reducedBonesScreenSize)
+        return AnimationLod::reducedBones;
+
+    return AnimationLod::full;
+}
+
+// steps one level at a time from the previous one so sizes near a threshold don't flicker
+int RenderManager::selectMeshLod(const Model *model, float screenSize, int level)
+{
+    int lodCount = 1;
+    for (Mesh *mesh : model->opaqueMeshes)
+        lodCount = std::max(lodCount, (int)mesh->lods.size());
+
+    level = std::min(std::max(level, 0), lodCount - 1);
+    float hysteresis = m_meshLodSelection.hysteresis;
+
+    // threshold of level n is screenSize * 0.5^(n - 1)
+    auto threshold = [this](int level) { return m_meshLodSelection.screenSize * std::pow(0.5f, (float)(level - 1)); };
 
-    const auto &frustumIndexes = m_shadowManager->m_sceneObjects[source->cullIndex].frustumIndexes;
-    if (std::find(frustumIndexes.begin(), frustumIndexes.end(), frustumIndex) == frustumIndexes.end())
-        return false;
+    while (level + 1 < lodCount && screenSize < threshold(level + 1) * (1.f - hysteresis))
+        level++;
+    while (level > 0 && screenSize > threshold(level) * (1.f + hysteresis))
+        level--;
 
-    return true;
+    return level;
+}
+
+// camera levels use the perspective projected size, cascades are orthographic so only the radius counts
+void RenderManager::updateMeshLods()
+{
+    int viewCount = 1 + m_shadowManager->m_depthPMatrices.size();
+    bool enabled = m_meshLodSelection.enabled;
+
+    for (int i = 0; i < 2; i++)
+    {
+        std::vector<RenderSource *> &sources = i == 0 ? m_visiblePbrSources : m_visiblePbrAnimSources;
+
+        for (RenderSource *source : sources)
+        {
+            source->lodLevels.resize(viewCount, 0);
+            if (!enabled)
+            {
+                source->lodLevels[0] = 0;
+                continue;
+            }
+
+            const aabb &bounds = m_visibleAabbs[source->cullIndex];
+            glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+            float radius = glm::length(bounds.max - bounds.min) * 0.5f;
+            float distance = std::max(glm::distance(center, m_cullViewPos), 0.001f);
+
+            float screenSize = radius * m_cullProjection[1][1] / distance;
+            source->lodLevels[0] = selectMeshLod(source->model, screenSize, source->lodLevels[0]);
+        }
+    }
+
+    for (int i = 0; i < m_shadowCasters.size(); i++)
+    {
+        for (int j = 0; j < m_shadowCasters[i].size(); j++)
+        {
+            RenderSource *source = m_shadowCasters[i][j];
+            source->lodLevels.resize(viewCount, 0);
+            if (!enabled)
+            {
+                source->lodLevels[i + 1] = 0;
+                continue;
+            }
+
+            const aabb &bounds = m_casterAabbs[i][j];
+            float radius = glm::length(bounds.max - bounds.min) * 0.5f;
+            float screenSize = radius * m_shadowManager->m_depthPMatrices[i][1][1];
+            source->lodLevels[i + 1] = selectMeshLod(source->model, screenSize, source->lodLevels[i + 1]);
+        }
+    }
+}
+
+// sources without animation or a transform link that haven't moved for a while
+bool RenderManager::isStaticCaster(RenderSource *source)
+{
+    return !source->animator && !source->transformLink && m_frameIndex - source->movedFrame > m_shadowCache.staticFrames;
+}
+
+// decides which cascades are drawn this frame and which of them redraw their cached layer
+void RenderManager::updateShadowCache()
+{
+    int cascadeCount = m_shadowCasters.size();
+    m_cascadeCaches.resize(cascadeCount);
+    m_shadowCacheStats = ShadowCacheStats();
+
+    for (int i = 0; i < cascadeCount; i++)
+    {
+        ShadowCascadeCache &cache = m_cascadeCaches[i];
+        if (!m_shadowCache.enabled)
+        {
+            cache.valid = false;
+            cache.update = true;
+            cache.rebuild = false;
+            m_shadowCacheStats.updatedCascades++;
+            m_shadowCacheStats.dynamicCasters += m_shadowCasters[i].size();
+            continue;
+        }
+
+        // light, box step, world origin or map size changed
+        glm::mat4 viewProjection = m_shadowManager->m_depthPMatrices[i] * m_depthViewMatrix * m_originTransform;
+        int size = m_shadowmapManager->getSize();
+        if (viewProjection != cache.viewProjection || size != cache.size)
+        {
+            cache.valid = false;
+            cache.viewProjection = viewProjection;
+            cache.size = size;
+        }
+
+        // sources that became static since the layer was drawn, moved ones invalidate it themselves
+        int cascadeBit = 1 << i;
+        int staticCount = 0;
+        for (RenderSource *source : m_shadowCasters[i])
+        {
+            if (!isStaticCaster(source))
+                continue;
+
+            staticCount++;
+            if (!(source->cachedCascades & cascadeBit))
+                cache.valid = false;
+        }
+
+        int interval = std::max(1, m_shadowCache.updateIntervals[i]);
+        cache.rebuild = !cache.valid;
+        cache.update = cache.rebuild || (m_frameIndex + i) % interval == 0;
+
+        if (cache.rebuild)
+        {
+            for (RenderSource *source : m_shadowCasters[i])
+            {
+                if (isStaticCaster(source))
+                    source->cachedCascades |= cascadeBit;
+            }
+            cache.valid = true;
+            m_shadowCacheStats.rebuiltCascades++;
+        }
+
+        if (cache.update)
+            m_shadowCacheStats.updatedCascades++;
+        m_shadowCacheStats.staticCasters += staticCount;
+        m_shadowCacheStats.dynamicCasters += m_shadowCasters[i].size() - staticCount;
+    }
+}
+
+void RenderManager::invalidateShadowCache(int cascadeMask)
+{
+    for (int i = 0; i < m_cascadeCaches.size(); i++)
+    {
+        if (cascadeMask & (1 << i))
+            m_cascadeCaches[i].valid = false;
+    }
+}
+
+void RenderManager::buildRenderQueue()
+{
+    m_renderQueue.clear();
+
+    FaceCullType depthFaceCullType = m_cullFront ? FaceCullType::frontFaces : FaceCullType::backFaces;
+    float farPlane = std::max(m_camera->m_far, 0.001f);
+
+    for (int i = 0; i < 2; i++)
+    {
+        std::vector<RenderSource *> &sources = i == 0 ? m_visiblePbrSources : m_visiblePbrAnimSources;
+        bool animated = i == 1;
+
+        for (int j = 0; j < sources.size(); j++)
+        {
+            RenderSource *source = sources[j];
+            // occluded sources only cast shadows
+            if (source->occluded)
+                continue;
+
+            const aabb &bounds = m_visibleAabbs[source->cullIndex];
+            float depth = glm::distance((bounds.min + bounds.max) * 0.5f, m_cullViewPos) / farPlane;
+
+            // skinned sources were always drawn filled
+            PolygonMode polygonMode = animated ? PolygonMode::fill : source->polygonMode;
+
+            // skinned meshes differ per source, only static ones are batched
+            bool instanced = m_instancedBatching && !animated;
+
+            for (Mesh *mesh : source->model->opaqueMeshes)
+            {
+                m_renderQueue.add(RenderPass::opaque, animated ? &pbrDeferredPreAnim : &pbrDeferredPre,
+                                  instanced ? &pbrDeferredPreInstanced : nullptr, mesh, source,
+                                  source->faceCullType, polygonMode, depth);
+            }
+        }
+    }
+
+    // each cascade draws its own casters, front to back from the light
+    for (int i = 0; i < m_shadowCasters.size(); i++)
+    {
+        const ShadowCascadeCache &cache = m_cascadeCaches[i];
+        if (!cache.update)
+            continue;
+
+        const frustum &f = m_shadowManager->m_frustums[i];
+        float lightNear = f.lightAABB[0].z;
+        float lightRange = std::max(lightNear - f.lightAABB[4].z, 0.001f);
+
+        for (int j = 0; j < m_shadowCasters[i].size(); j++)
+        {
+            RenderSource *source = m_shadowCasters[i][j];
+            bool cached = m_shadowCache.enabled && isStaticCaster(source);
+            if (cached && !cache.rebuild)
+                continue;
+
+            RenderPass pass = (RenderPass)((int)(cached ? RenderPass::staticDepth : RenderPass::depth) + i);
+            const aabb &bounds = m_casterAabbs[i][j];
+            glm::vec4 lightCenter = m_depthViewMatrix * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.f);
+            float depth = (lightNear - lightCenter.z) / lightRange;
+
+            bool animated = source->animator != nullptr;
+            bool instanced = m_instancedBatching && !animated;
+
+            for (Mesh *mesh : source->model->opaqueMeshes)
+            {
+                m_renderQueue.add(pass, animated ? &depthShaderAnim : &depthShader,
+                                  instanced ? &depthShaderInstanced : nullptr, mesh, source,
+                                  depthFaceCullType, PolygonMode::fill, depth);
+            }
+        }
+    }
+
+    m_renderQueue.sort();
 }
 
 // RenderSource
@@ -1002,6 +1475,11 @@ void RenderSource::updateModelMatrix()
 
     modelMatrix = transform.getModelMatrix() * offset.getModelMatrix();
 
+    // drawn as a dynamic caster until it stays in place again
+    movedFrame = m_renderManager->m_frameIndex;
+    m_renderManager->invalidateShadowCache(cachedCascades);
+    cachedCascades = 0;
+
     glm::vec3 aabbCenter = (model->aabbMax + model->aabbMin) / 2.0f;
 
     eTransform aabbTransform;
@@ -1010,4 +1488,5 @@ void RenderSource::updateModelMatrix()
     glm::mat4 aabbModelMatrix = modelMatrix * aabbTransform.getModelMatrix();
 
     m_renderManager->m_cullingManager->updateObject(this, m_renderManager->m_originTransform * aabbModelMatrix);
+    m_renderManager->m_cullingManager->updateOccluder(this, m_renderManager->m_originTransform * modelMatrix);
 }
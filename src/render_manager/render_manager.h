@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <GL/glew.h>
@@ -20,30 +21,20 @@
 #include "../post_process/post_process.h"
 #include "../post_process/bloom_manager.h"
 #include "../transform_link/transform_link.h"
-#include "../particle_engine/particle_engine.h"
+#include "../particle_manager/particle_manager.h"
 #include "../culling_manager/culling_manager.h"
 #include "../resource_manager/resource_manager.h"
+#include "../job_pool/job_pool.h"
+#include "../stream_buffer/stream_buffer.h"
 #include "../utils/common.h"
 
+#include "bone_palette.h"
 #include "g_buffer.h"
+#include "geometry_pool.h"
+#include "light_clusters.h"
+#include "render_queue.h"
 #include "ssao.h"
 
-enum class FaceCullType
-{
-    backFaces,
-    frontFaces,
-    none,
-    COUNT
-};
-
-enum class PolygonMode
-{
-    point,
-    line,
-    fill,
-    COUNT
-};
-
 class RenderManager;
 class RenderSource
 {
@@ -58,6 +49,20 @@ public:
     Animator *animator = nullptr;
     TransformLink *transformLink = nullptr;
     int cullIndex = -1;
+    // first bone matrix in the frame's bone palette
+    int paletteOffset = 0;
+    // mesh lod per view, 0 is the camera, 1 + i is shadow cascade i
+    std::vector<int> lodLevels;
+    // rasterized into the occlusion buffer
+    bool occluder = false;
+    // hidden from the camera this frame, still casts shadows
+    bool occluded = false;
+    // bit i is set if the source casts into shadow cascade i this frame
+    int shadowCascades = 0;
+    // frame of the last transform change
+    int movedFrame = 0;
+    // shadow cascades whose cached static depth holds the source
+    int cachedCascades = 0;
 
     RenderSource(eTransform transform, eTransform offset, FaceCullType faceCullType, Model *model, Animator *animator, TransformLink *transformLink)
         : transform(transform),
@@ -72,27 +77,6 @@ public:
     void updateModelMatrix();
 };
 
-// TODO: remove?
-class RenderParticleSource
-{
-public:
-    Shader *shader;
-    Model *model;
-    ParticleEngine *particleEngine;
-    TransformLink *transformLink = nullptr;
-
-    RenderParticleSource(Shader *shader, Model *model, ParticleEngine *particleEngine)
-        : shader(shader),
-          model(model),
-          particleEngine(particleEngine){};
-
-    RenderParticleSource(Shader *shader, Model *model, ParticleEngine *particleEngine, TransformLink *transformLink)
-        : shader(shader),
-          model(model),
-          particleEngine(particleEngine),
-          transformLink(transformLink){};
-};
-
 class RenderSourceBuilder
 {
 public:
@@ -168,6 +152,45 @@ struct LightSource
           quadratic(0.032f){};
 };
 
+struct MeshLodSelection
+{
+    bool enabled = true;
+    // projected radius over screen height where lod 1 starts, halved for every further level
+    float screenSize = 0.25f;
+    // relative band around a threshold where the current level is kept
+    float hysteresis = 0.1f;
+};
+
+struct ShadowCacheSettings
+{
+    // static casters are drawn into a cached layer, dynamic ones over a copy of it each update
+    bool enabled = false;
+    // frames without a transform change before a source counts as static
+    int staticFrames = 30;
+    // frames between updates of each cascade, a changed projection updates it anyway
+    int updateIntervals[MAX_SHADOW_CASCADES] = {1, 1, 2, 4};
+};
+
+struct ShadowCascadeCache
+{
+    // projection the cached layer was drawn with
+    glm::mat4 viewProjection = glm::mat4(0.f);
+    int size = 0;
+    bool valid = false;
+    // decided for the current frame
+    bool update = true;
+    bool rebuild = false;
+};
+
+struct ShadowCacheStats
+{
+    int updatedCascades = 0;
+    int rebuiltCascades = 0;
+    // over all cascades, duplicates included
+    int staticCasters = 0;
+    int dynamicCasters = 0;
+};
+
 struct LightInstance
 {
     glm::mat4 model;
@@ -208,11 +231,12 @@ public:
 class RenderManager
 {
 public:
-    RenderManager(ShaderManager *shaderManager, ResourceManager *resourceManager, Camera *camera);
+    RenderManager(ShaderManager *shaderManager, ResourceManager *resourceManager, JobPool *jobPool, Camera *camera);
     ~RenderManager();
 
     ShaderManager *m_shaderManager;
     ResourceManager *m_resourceManager;
+    JobPool *m_jobPool;
     Camera *m_camera;
     Camera *m_debugCamera;
 
@@ -231,33 +255,65 @@ public:
     ShadowManager *m_shadowManager;
     ShadowmapManager *m_shadowmapManager;
     CullingManager *m_cullingManager;
+    ParticleManager *m_particleManager;
     GBuffer *m_gBuffer;
     SSAO *m_ssao;
     PostProcess *m_postProcess;
     BloomManager *m_bloomManager;
+    BonePalette *m_bonePalette;
+    GeometryPool *m_geometryPool;
+    LightClusters *m_lightClusters;
     glm::mat4 m_originTransform;
     bool m_debugCulling = false;
     bool m_drawCullingAabb = false;
 
     std::vector<RenderSource *> m_visiblePbrSources;
     std::vector<RenderSource *> m_visiblePbrAnimSources;
+    // culling space bounds of visible sources, indexed by cullIndex
+    std::vector<aabb> m_visibleAabbs;
+    // casters of each shadow cascade and their bounds, visible or not
+    std::vector<std::vector<RenderSource *>> m_shadowCasters;
+    std::vector<std::vector<aabb>> m_casterAabbs;
+    // skinned casters outside the view, posed for their shadows only
+    std::vector<RenderSource *> m_shadowAnimSources;
+    ShadowCacheSettings m_shadowCache;
+    std::vector<ShadowCascadeCache> m_cascadeCaches;
+    ShadowCacheStats m_shadowCacheStats;
+    int m_frameIndex = 0;
+    // sorted draws of the visible sources, rebuilt after culling
+    RenderQueue m_renderQueue;
+    // static sources sharing a mesh are drawn instanced
+    bool m_instancedBatching = true;
+    MeshLodSelection m_meshLodSelection;
     std::vector<Renderable *> m_renderables;
     std::vector<ForwardRenderable *> m_forwardRenderables;
     std::vector<TransparentRenderable *> m_transparentRenderables;
 
     std::vector<RenderSource *> m_pbrSources;
     std::vector<RenderSource *> m_linkSources;
-    std::vector<RenderParticleSource *> m_particleSources;
+
+    // animators with advanced timers, evaluated together each frame
+    std::vector<Animator *> m_dueAnimators;
+    AnimationLodSettings m_animationLod;
+    bool m_batchPoseBlending = true;
+    int m_animationLodCounts[(int)AnimationLod::COUNT] = {};
 
     std::vector<LightSource> m_pointLights;
 
     Shader pbrDeferredPre;
     Shader pbrDeferredPreAnim;
+    Shader pbrDeferredPreInstanced;
     Shader pbrDeferredAfter;
     Shader pbrDeferredPointLight;
+    Shader pbrDeferredClustered;
+    // transform feedback step of gpu particle engines
+    Shader particleUpdateShader;
+    // billboards of gpu particle engines by fragment shader path, created with the first source using it
+    std::unordered_map<std::string, Shader *> m_particleBillboardShaders;
     Shader pbrTransmission;
     Shader depthShader;
     Shader depthShaderAnim;
+    Shader depthShaderInstanced;
     Shader lightVolume;
     Shader lightVolumeDebug;
     Shader shaderSSAO, shaderSSAOBlur;
@@ -306,10 +362,15 @@ public:
 
     bool m_lightAreaDebug = false;
     bool m_lightSurfaceDebug = false;
+    // point lights shaded in one pass from view space clusters, light volumes are kept for the debug views
+    bool m_clusteredLighting = true;
+    // markers of the visible lights in the clustered path
+    bool m_lightPointDebug = false;
 
     // instanced lights
-    unsigned int m_lightArrayBuffer;
+    StreamBuffer *m_lightArrayBuffer;
     std::vector<LightInstance> m_lightBufferList;
+    std::vector<LightSource> m_visiblePointLights;
 
     float fogMaxDist = 10000.0f;
     float fogMinDist = 4500.0f;
@@ -317,6 +378,7 @@ public:
 
     void updateTransforms();
     void setupFrame(GLFWwindow *window);
+    void updateAnimators();
     void renderDepth();
     void renderOpaque();
     void renderSSAO();
@@ -330,7 +392,16 @@ public:
     void addSource(RenderSource *source);
     void removeSource(RenderSource *source);
     void addParticleSource(RenderParticleSource *source);
+    // gpu sources draw with a billboard program made from the fragment shader of their effect
+    void setParticleBackend(RenderParticleSource *source, ParticleBackend backend);
     void addLight(LightSource light);
+    // opt in, meshes of the model are drawn from the shared static pool
+    void addStaticGeometry(Model *model);
+    void removeStaticGeometry(Model *model);
+    // the coarsest lod of the opaque meshes occludes other sources
+    void setOccluder(RenderSource *source, bool occluder);
+    // cached static depth of the cascades is redrawn, for changes of static casters not made through sources
+    void invalidateShadowCache(int cascadeMask = ~0);
 
     void addRenderable(Renderable *renderable);
     void removeRenderable(Renderable *renderable);
@@ -344,8 +415,18 @@ private:
 
     void setupLights();
     void renderLightVolumes(std::vector<LightSource> &lights, bool camInsideVolume);
+    void renderClusteredLights();
+    void renderLightPoints(int count);
     void updateLightBuffer(std::vector<LightSource> &lights);
-    bool inShadowFrustum(RenderSource *source, int frustumIndex);
+    void setupLightInstances(size_t offset);
+    AnimationLod getAnimationLod(RenderSource *source);
+    int selectMeshLod(const Model *model, float screenSize, int level);
+    void updateMeshLods();
+    bool isStaticCaster(RenderSource *source);
+    void updateShadowCache();
+    void buildRenderQueue();
+    void renderDepthPass(RenderPass pass, bool renderables);
+    Shader *getParticleBillboardShader(Shader *effectShader);
 };
 
 #endif /* render_manager_hpp */
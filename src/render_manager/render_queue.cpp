@@ -0,0 +1,319 @@
+#include <algorithm>
+#include <chrono>
+
+#include "render_manager.h"
+#include "render_queue.h"
+
+// per draw uniforms, hashed at compile time
+static constexpr Uniform<glm::mat4> uniformMeshOffset("u_meshOffset");
+
+static const int passShift = 60;
+static const int shaderShift = 52;
+static const int faceCullShift = 50;
+static const int polygonModeShift = 48;
+static const int materialShift = 32;
+static const int vaoShift = 16;
+
+RenderQueue::RenderQueue()
+    : m_instanceOffset(0)
+{
+    m_instanceBuffer = new StreamBuffer();
+}
+
+RenderQueue::~RenderQueue()
+{
+    delete m_instanceBuffer;
+}
+
+void RenderQueue::clear()
+{
+    m_items.clear();
+
+    for (int i = 0; i < (int)RenderPass::COUNT; i++)
+        m_stats[i] = RenderPassStats();
+}
+
+void RenderQueue::add(RenderPass pass, Shader *shader, Shader *instancedShader, Mesh *mesh, RenderSource *source,
+                      FaceCullType faceCullType, PolygonMode polygonMode, float depth)
+{
+    uint64_t quantizedDepth = (uint64_t)(std::clamp(depth, 0.f, 1.f) * 65535.f);
+
+    uint64_t key = 0;
+    key |= (uint64_t)pass << passShift;
+    key |= (uint64_t)(shader->id & 0xff) << shaderShift;
+    key |= (uint64_t)faceCullType << faceCullShift;
+    key |= (uint64_t)polygonMode << polygonModeShift;
+    key |= (uint64_t)(getMaterialId(mesh->material) & 0xffff) << materialShift;
+    // pooled meshes share the pool vertex array, their draws sort together and merge into one multi draw
+    unsigned int vao = mesh->poolVAO ? mesh->poolVAO : mesh->VAO;
+    key |= (uint64_t)(vao & 0xffff) << vaoShift;
+    key |= quantizedDepth;
+
+    m_items.push_back(DrawItem{key, shader, instancedShader, mesh, source, faceCullType, polygonMode});
+}
+
+void RenderQueue::sort()
+{
+    std::sort(m_items.begin(), m_items.end(), [](const DrawItem &a, const DrawItem &b) { return a.key < b.key; });
+}
+
+void RenderQueue::submit(RenderPass pass,
+                         const std::function<void(const DrawItem &item, bool instanced)> &setupDraw,
+                         const std::function<bool(const DrawItem &item)> &filter,
+                         int lodView)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    RenderPassStats &stats = m_stats[(int)pass];
+
+    buildCommands(pass, lodView, filter);
+    uploadInstances();
+
+    // unknown state at the start of a pass, the first draw binds everything
+    Shader *shader = nullptr;
+    // mesh whose material is bound
+    Mesh *materialMesh = nullptr;
+    int faceCullType = -1;
+    int polygonMode = -1;
+    unsigned int vao = 0;
+
+    for (int i = 0; i < m_commands.size(); i++)
+    {
+        const DrawCommand &command = m_commands[i];
+        const DrawItem &item = *command.item;
+        Mesh *mesh = item.mesh;
+        bool instanced = command.instanceCount > 0;
+        Shader *itemShader = instanced ? item.instancedShader : item.shader;
+
+        if (itemShader != shader)
+        {
+            // uniforms live in the program, material state of the previous one does not carry over
+            if (materialMesh)
+            {
+                materialMesh->unbindTextures(*shader);
+                materialMesh->unbindProperties(*shader);
+            }
+
+            shader = itemShader;
+            shader->use();
+            materialMesh = nullptr;
+            stats.shaderChanges++;
+        }
+
+        if ((int)item.faceCullType != faceCullType)
+        {
+            if (item.faceCullType == FaceCullType::none)
+            {
+                glDisable(GL_CULL_FACE);
+            }
+            else
+            {
+                glEnable(GL_CULL_FACE);
+                glCullFace(item.faceCullType == FaceCullType::frontFaces ? GL_FRONT : GL_BACK);
+            }
+
+            faceCullType = (int)item.faceCullType;
+            stats.rasterChanges++;
+        }
+
+        if ((int)item.polygonMode != polygonMode)
+        {
+            if (item.polygonMode == PolygonMode::fill)
+                glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            else if (item.polygonMode == PolygonMode::line)
+                glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+            else if (item.polygonMode == PolygonMode::point)
+                glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
+
+            polygonMode = (int)item.polygonMode;
+            stats.rasterChanges++;
+        }
+
+        if (!materialMesh || mesh->material != materialMesh->material)
+        {
+            // flags and units of the new material overwrite the previous ones
+            materialMesh = mesh;
+            mesh->bindTextures(*shader);
+            mesh->bindProperties(*shader);
+            stats.materialChanges++;
+        }
+
+        // pooled meshes share one vertex array
+        bool pooled = mesh->poolVAO != 0;
+        unsigned int meshVAO = pooled ? mesh->poolVAO : mesh->VAO;
+        if (meshVAO != vao)
+        {
+            vao = meshVAO;
+            glBindVertexArray(vao);
+            stats.vaoChanges++;
+        }
+
+        setupDraw(item, instanced);
+        shader->set(uniformMeshOffset, pooled ? glm::mat4(1.f) : mesh->offset);
+
+        const MeshLod &lod = mesh->getLod(command.lodLevel);
+        int firstIndex = (pooled ? mesh->poolFirstIndex : 0) + lod.firstIndex;
+        // the pool is always 32 bit
+        GLenum indexType = pooled ? GL_UNSIGNED_INT : mesh->indexType;
+        int indexSize = pooled ? sizeof(unsigned int) : mesh->getIndexSize();
+        const void *indices = (const void *)(size_t)(firstIndex * indexSize);
+        int baseVertex = pooled ? mesh->poolBaseVertex : 0;
+
+        if (instanced)
+        {
+            // no base instance in 4.1, the attributes are pointed at the batch instead
+            glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer->m_buffer);
+            for (int j = 0; j < 4; j++)
+            {
+                int location = INSTANCE_MATRIX_LOCATION + j;
+                size_t offset = m_instanceOffset + command.firstInstance * sizeof(glm::mat4) + j * sizeof(glm::vec4);
+                glEnableVertexAttribArray(location);
+                glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void *)offset);
+                glVertexAttribDivisor(location, 1);
+            }
+
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, lod.indexCount, indexType, indices,
+                                              command.instanceCount, baseVertex);
+            stats.instancedDrawCount++;
+            stats.meshCount += command.instanceCount;
+            stats.triangleCount += lod.indexCount / 3 * command.instanceCount;
+        }
+        else if (command.drawCount > 0)
+        {
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, &m_multiDrawCounts[command.firstDraw], GL_UNSIGNED_INT,
+                                          &m_multiDrawIndices[command.firstDraw], command.drawCount,
+                                          &m_multiDrawBaseVertices[command.firstDraw]);
+            stats.multiDrawCount++;
+            stats.meshCount += command.drawCount;
+            for (int j = 0; j < command.drawCount; j++)
+                stats.triangleCount += m_multiDrawCounts[command.firstDraw + j] / 3;
+        }
+        else
+        {
+            glDrawElementsBaseVertex(GL_TRIANGLES, lod.indexCount, indexType, indices, baseVertex);
+            stats.meshCount++;
+            stats.triangleCount += lod.indexCount / 3;
+        }
+        stats.drawCount++;
+    }
+
+    if (materialMesh)
+    {
+        materialMesh->unbindTextures(*shader);
+        materialMesh->unbindProperties(*shader);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDisable(GL_CULL_FACE);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    stats.submitTime += std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+// merges runs of items that differ only in their source into instanced commands
+void RenderQueue::buildCommands(RenderPass pass, int lodView, const std::function<bool(const DrawItem &item)> &filter)
+{
+    m_commands.clear();
+    m_instanceMatrices.clear();
+    m_multiDrawCounts.clear();
+    m_multiDrawIndices.clear();
+    m_multiDrawBaseVertices.clear();
+
+    uint64_t passKey = (uint64_t)pass << passShift;
+    auto begin = std::lower_bound(m_items.begin(), m_items.end(), passKey,
+                                  [](const DrawItem &item, uint64_t key) { return item.key < key; });
+
+    for (auto it = begin; it != m_items.end() && (it->key >> passShift) == (uint64_t)pass; it++)
+    {
+        const DrawItem &item = *it;
+        if (filter && !filter(item))
+            continue;
+
+        const std::vector<int> &lodLevels = item.source->lodLevels;
+        int lodLevel = lodView < lodLevels.size() ? lodLevels[lodView] : 0;
+
+        if (!m_commands.empty() && item.instancedShader)
+        {
+            DrawCommand &last = m_commands.back();
+            const DrawItem &lastItem = *last.item;
+
+            bool sameState = lastItem.instancedShader == item.instancedShader &&
+                             lastItem.mesh == item.mesh &&
+                             last.lodLevel == lodLevel &&
+                             lastItem.faceCullType == item.faceCullType &&
+                             lastItem.polygonMode == item.polygonMode;
+            if (sameState && last.drawCount == 0)
+            {
+                if (last.instanceCount == 0)
+                {
+                    last.firstInstance = m_instanceMatrices.size();
+                    last.instanceCount = 1;
+                    m_instanceMatrices.push_back(lastItem.source->modelMatrix);
+                }
+
+                last.instanceCount++;
+                m_instanceMatrices.push_back(item.source->modelMatrix);
+                continue;
+            }
+        }
+
+        if (!m_commands.empty() && item.mesh->poolVAO != 0)
+        {
+            DrawCommand &last = m_commands.back();
+            const DrawItem &lastItem = *last.item;
+
+            // offsets are baked in the pool, only the source matrix has to match
+            bool sameState = last.instanceCount == 0 &&
+                             lastItem.source == item.source &&
+                             lastItem.shader == item.shader &&
+                             lastItem.mesh->poolVAO == item.mesh->poolVAO &&
+                             lastItem.mesh->material == item.mesh->material &&
+                             lastItem.faceCullType == item.faceCullType &&
+                             lastItem.polygonMode == item.polygonMode;
+            if (sameState)
+            {
+                if (last.drawCount == 0)
+                {
+                    last.firstDraw = m_multiDrawCounts.size();
+                    last.drawCount = 1;
+                    addMultiDraw(lastItem.mesh, last.lodLevel);
+                }
+
+                last.drawCount++;
+                addMultiDraw(item.mesh, lodLevel);
+                continue;
+            }
+        }
+
+        m_commands.push_back(DrawCommand{&item, lodLevel, 0, 0, 0, 0});
+    }
+}
+
+void RenderQueue::addMultiDraw(const Mesh *mesh, int lodLevel)
+{
+    const MeshLod &lod = mesh->getLod(lodLevel);
+    m_multiDrawCounts.push_back(lod.indexCount);
+    m_multiDrawIndices.push_back((const void *)((mesh->poolFirstIndex + lod.firstIndex) * sizeof(unsigned int)));
+    m_multiDrawBaseVertices.push_back(mesh->poolBaseVertex);
+}
+
+void RenderQueue::uploadInstances()
+{
+    if (m_instanceMatrices.empty())
+        return;
+
+    // appended for every submit, cascades of the same frame keep their own ranges
+    m_instanceOffset = m_instanceBuffer->upload(m_instanceMatrices.data(), m_instanceMatrices.size() * sizeof(glm::mat4));
+}
+
+int RenderQueue::getMaterialId(const Material *material)
+{
+    auto it = m_materialIds.find(material);
+    if (it != m_materialIds.end())
+        return it->second;
+
+    int id = m_materialIds.size();
+    m_materialIds[material] = id;
+    return id;
+}
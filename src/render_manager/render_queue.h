@@ -0,0 +1,137 @@
+#ifndef render_queue_hpp
+#define render_queue_hpp
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "../mesh/mesh.h"
+#include "../shader/shader.h"
+#include "../stream_buffer/stream_buffer.h"
+
+enum class FaceCullType
+{
+    backFaces,
+    frontFaces,
+    none,
+    COUNT
+};
+
+enum class PolygonMode
+{
+    point,
+    line,
+    fill,
+    COUNT
+};
+
+// shadow cascades with their own depth pass
+#define MAX_SHADOW_CASCADES 4
+
+// casters of cascade i are drawn by pass depth + i, static ones into its cache by staticDepth + i
+enum class RenderPass
+{
+    depth,
+    staticDepth = depth + MAX_SHADOW_CASCADES,
+    opaque = staticDepth + MAX_SHADOW_CASCADES,
+    COUNT
+};
+
+class RenderSource;
+
+// first vertex attribute of the per instance model matrix, takes 4 locations
+#define INSTANCE_MATRIX_LOCATION 7
+
+// key bits from high to low: pass 4, shader 8, cull mode 2, polygon mode 2, material 16, vao 16, depth 16
+// sorting by key groups draws by the most expensive state first and goes front to back inside a group
+struct DrawItem
+{
+    uint64_t key;
+    Shader *shader;
+    // variant reading the model matrix from the instance buffer, null if the item can't be batched
+    Shader *instancedShader;
+    Mesh *mesh;
+    RenderSource *source;
+    FaceCullType faceCullType;
+    PolygonMode polygonMode;
+};
+
+// consecutive items with the same state, drawn instanced when instanceCount > 0
+// pooled meshes of one source sharing a material are drawn together when drawCount > 0
+struct DrawCommand
+{
+    const DrawItem *item;
+    int lodLevel;
+    int firstInstance;
+    int instanceCount;
+    int firstDraw;
+    int drawCount;
+};
+
+struct RenderPassStats
+{
+    // draw calls
+    int drawCount = 0;
+    // meshes drawn, instances included
+    int meshCount = 0;
+    int instancedDrawCount = 0;
+    int multiDrawCount = 0;
+    int triangleCount = 0;
+    int shaderChanges = 0;
+    // cull and polygon mode
+    int rasterChanges = 0;
+    int materialChanges = 0;
+    int vaoChanges = 0;
+    // cpu time spent submitting, in ms
+    float submitTime = 0.f;
+};
+
+class RenderQueue
+{
+public:
+    RenderQueue();
+    ~RenderQueue();
+
+    std::vector<DrawItem> m_items;
+    // reset on clear, accumulated over every submit of a pass
+    RenderPassStats m_stats[(int)RenderPass::COUNT];
+
+    void clear();
+    // depth is the normalized view distance, 0 near, 1 far
+    void add(RenderPass pass, Shader *shader, Shader *instancedShader, Mesh *mesh, RenderSource *source,
+             FaceCullType faceCullType, PolygonMode polygonMode, float depth);
+    void sort();
+
+    // binds changed state only, setupDraw sets the per draw uniforms of the bound shader
+    // for instanced draws the source model matrices come from the instance buffer
+    // draws rejected by filter are skipped before any state is touched
+    // lodView selects the detail level of the sources, see RenderSource::lodLevels
+    void submit(RenderPass pass,
+                const std::function<void(const DrawItem &item, bool instanced)> &setupDraw,
+                const std::function<bool(const DrawItem &item)> &filter = nullptr,
+                int lodView = 0);
+
+private:
+    StreamBuffer *m_instanceBuffer;
+    // in bytes, of the matrices of the current submit
+    int m_instanceOffset;
+    std::vector<glm::mat4> m_instanceMatrices;
+    std::vector<DrawCommand> m_commands;
+    // glMultiDrawElementsBaseVertex arguments of all multi draw commands
+    std::vector<GLsizei> m_multiDrawCounts;
+    std::vector<const void *> m_multiDrawIndices;
+    std::vector<GLint> m_multiDrawBaseVertices;
+    // stable small ids for the material bits of the key
+    std::unordered_map<const Material *, int> m_materialIds;
+
+    void buildCommands(RenderPass pass, int lodView, const std::function<bool(const DrawItem &item)> &filter);
+    void uploadInstances();
+    void addMultiDraw(const Mesh *mesh, int lodLevel);
+    int getMaterialId(const Material *material);
+};
+
+#endif /* render_queue_hpp */
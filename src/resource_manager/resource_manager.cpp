@@ -1,4 +1,5 @@
 #include "resource_manager.h"
+#include "../animation/animation.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "../external/stb_image/stb_image.h"
@@ -10,6 +11,10 @@ ResourceManager::ResourceManager(std::string executablePath)
 
 ResourceManager::~ResourceManager()
 {
+    for (auto &pair : m_animations)
+        delete pair.second.animation;
+    m_animations.clear();
+
     for (auto &pair : m_models)
         delete pair.second;
     m_models.clear();
@@ -62,6 +67,51 @@ void ResourceManager::disposeModel(std::string fullPath)
     m_models.erase(fullPath);
 }
 
+// clips are immutable, so every animator playing the same model shares them
+Animation *ResourceManager::getAnimation(Model *model, const std::string &name, bool compressed)
+{
+    std::string key = model->m_path + ":" + name;
+    if (compressed)
+        key += ":compressed";
+
+    auto it = m_animations.find(key);
+    if (it != m_animations.end())
+    {
+        it->second.refCount++;
+        return it->second.animation;
+    }
+
+    unsigned int start = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+    Animation *animation = new Animation(name, model);
+    if (compressed)
+        animation->compress(m_clipCompression);
+    m_animations[key] = AnimationEntry{animation, 1};
+
+    unsigned int end = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    unsigned int duration = end - start;
+    std::cout << std::setfill(' ') << std::setw(4) << duration << "ms - Animation - " << name << std::endl;
+
+    return animation;
+}
+
+void ResourceManager::releaseAnimation(Animation *animation)
+{
+    for (auto it = m_animations.begin(); it != m_animations.end(); ++it)
+    {
+        if (it->second.animation != animation)
+            continue;
+
+        it->second.refCount--;
+        if (it->second.refCount > 0)
+            return;
+
+        delete it->second.animation;
+        m_animations.erase(it);
+        return;
+    }
+}
+
 Texture *ResourceManager::textureFromMemory(
     const TextureParams &params,
     const std::string &key,
@@ -8,6 +8,15 @@
 class Model;
 #include "../model/model.h"
 
+class Animation;
+#include "../animation/keyframe.h"
+
+struct AnimationEntry
+{
+    Animation *animation;
+    int refCount;
+};
+
 class ResourceManager
 {
 public:
@@ -19,10 +28,19 @@ public:
     std::unordered_map<std::string, Texture *> m_textures;
     std::unordered_map<std::string, Material *> m_materials;
     std::vector<Material *> m_copyMaterials;
+    std::unordered_map<std::string, AnimationEntry> m_animations;
+    ClipCompression m_clipCompression;
+    // gpu vertex buffers of imported meshes use the packed layouts
+    bool m_packVertices = true;
+    // imported meshes are reordered for the vertex cache, overdraw and vertex fetch
+    bool m_optimizeMeshes = true;
+    MeshLodSettings m_meshLod;
 
     Model *getModel(const std::string &path, bool isCopy = false);
     Model *getModelFullPath(const std::string &fullPath, bool isCopy = false);
     void disposeModel(std::string fullPath);
+    Animation *getAnimation(Model *model, const std::string &name, bool compressed = false);
+    void releaseAnimation(Animation *animation);
     Texture *textureFromMemory(const TextureParams &params, const std::string &key, void *buffer, unsigned int bufferSize);
     Texture *textureFromFile(const TextureParams &params, const std::string &key, const std::string &path);
     Texture *getTextureArray(std::vector<std::string> texturePaths, bool anisotropicFiltering = false);
@@ -16,6 +16,15 @@ void Shader::init(const std::string &vertexCode, const std::string &fragmentCode
     link();
 }
 
+void Shader::init(const std::string &vertexCode, const std::string &fragmentCode, const std::string &geometryCode)
+{
+    vertexCode_ = vertexCode;
+    fragmentCode_ = fragmentCode;
+    geometryCode_ = geometryCode;
+    compile();
+    link();
+}
+
 void Shader::init(const std::string &vertexCode, const std::string &fragmentCode,
                   const std::string &tessControlCode, const std::string &tessEvalCode)
 {
@@ -41,6 +50,15 @@ void Shader::compile()
     glCompileShader(fragmentId_);
     checkCompileError(fragmentId_, "FRAGMENT");
 
+    if (!geometryCode_.empty())
+    {
+        const char *gcode = geometryCode_.c_str();
+        geometryId_ = glCreateShader(GL_GEOMETRY_SHADER);
+        glShaderSource(geometryId_, 1, &gcode, NULL);
+        glCompileShader(geometryId_);
+        checkCompileError(geometryId_, "GEOMETRY");
+    }
+
     if (!tessControlCode_.empty())
     {
         const char *tcShaderCode = tessControlCode_.c_str();
@@ -65,6 +83,10 @@ void Shader::link()
     id = glCreateProgram();
     glAttachShader(id, vertexId_);
     glAttachShader(id, fragmentId_);
+    if (!geometryCode_.empty())
+    {
+        glAttachShader(id, geometryId_);
+    }
     if (!tessControlCode_.empty())
     {
         glAttachShader(id, tessControlId_);
@@ -73,10 +95,20 @@ void Shader::link()
     {
         glAttachShader(id, tessEvalId_);
     }
+    if (!m_feedbackVaryings.empty())
+    {
+        std::vector<const char *> varyings;
+        for (const std::string &varying : m_feedbackVaryings)
+            varyings.push_back(varying.c_str());
+        glTransformFeedbackVaryings(id, varyings.size(), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+    }
     glLinkProgram(id);
     checkLinkingError();
+    reflectUniforms();
     glDeleteShader(vertexId_);
     glDeleteShader(fragmentId_);
+    if (!geometryCode_.empty())
+        glDeleteShader(geometryId_);
     if (!tessControlCode_.empty())
         glDeleteShader(tessControlId_);
     if (!tessEvalCode_.empty())
@@ -88,61 +120,120 @@ void Shader::use()
     glUseProgram(id);
 }
 
-void Shader::setBool(const std::string &name, bool value) const
+// array uniforms are added by their base name and by every element
+void Shader::reflectUniforms()
 {
-    glUniform1i(glGetUniformLocation(id, name.c_str()), (int)value);
+    m_locations.clear();
+
+    int count = 0;
+    glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+
+    char buffer[256];
+    for (int i = 0; i < count; i++)
+    {
+        int length = 0;
+        int size = 0;
+        GLenum type;
+        glGetActiveUniform(id, i, sizeof(buffer), &length, &size, &type, buffer);
+
+        std::string name(buffer, length);
+        std::vector<std::string> names;
+        names.push_back(name);
+
+        size_t arrayStart = name.rfind("[0]");
+        if (arrayStart != std::string::npos && arrayStart + 3 == name.size())
+        {
+            std::string baseName = name.substr(0, arrayStart);
+            names.push_back(baseName);
+            for (int j = 1; j < size; j++)
+                names.push_back(baseName + "[" + std::to_string(j) + "]");
+        }
+
+        for (int j = 0; j < names.size(); j++)
+        {
+            int location = glGetUniformLocation(id, names[j].c_str());
+            if (location == -1)
+                continue;
+
+            uint32_t hash = hashUniformName(names[j].c_str());
+            auto it = m_locations.find(hash);
+            if (it != m_locations.end() && it->second != location)
+                std::cout << "Shader: uniform name hash collision: " << names[j] << std::endl;
+
+            m_locations[hash] = location;
+        }
+    }
+}
+
+int Shader::getLocation(UniformName name) const
+{
+    auto it = m_locations.find(name.hash);
+    if (it == m_locations.end())
+        return -1;
+
+    return it->second;
+}
+
+void Shader::setBool(UniformName name, bool value) const
+{
+    glUniform1i(getLocation(name), (int)value);
 }
 
-void Shader::setInt(const std::string &name, int value) const
+void Shader::setInt(UniformName name, int value) const
 {
-    glUniform1i(glGetUniformLocation(id, name.c_str()), value);
+    glUniform1i(getLocation(name), value);
 }
 
-void Shader::setFloat(const std::string &name, float value) const
+void Shader::setFloat(UniformName name, float value) const
 {
-    glUniform1f(glGetUniformLocation(id, name.c_str()), value);
+    glUniform1f(getLocation(name), value);
 }
 
-void Shader::setVec2(const std::string &name, const glm::vec2 &value) const
+void Shader::setVec2(UniformName name, const glm::vec2 &value) const
 {
-    glUniform2fv(glGetUniformLocation(id, name.c_str()), 1, &value[0]);
+    glUniform2fv(getLocation(name), 1, &value[0]);
 }
-void Shader::setVec2(const std::string &name, float x, float y) const
+void Shader::setVec2(UniformName name, float x, float y) const
 {
-    glUniform2f(glGetUniformLocation(id, name.c_str()), x, y);
+    glUniform2f(getLocation(name), x, y);
 }
 
-void Shader::setVec3(const std::string &name, const glm::vec3 &value) const
+void Shader::setVec3(UniformName name, const glm::vec3 &value) const
+{
+    glUniform3fv(getLocation(name), 1, &value[0]);
+}
+void Shader::setVec3(UniformName name, float x, float y, float z) const
 {
-    glUniform3fv(glGetUniformLocation(id, name.c_str()), 1, &value[0]);
+    glUniform3f(getLocation(name), x, y, z);
 }
-void Shader::setVec3(const std::string &name, float x, float y, float z) const
+
+void Shader::setVec3(UniformName name, const glm::vec3 *values, int count) const
 {
-    glUniform3f(glGetUniformLocation(id, name.c_str()), x, y, z);
+    glUniform3fv(getLocation(name), count, &values[0][0]);
 }
 
-void Shader::setVec4(const std::string &name, const glm::vec4 &value) const
+void Shader::setVec4(UniformName name, const glm::vec4 &value) const
 {
-    glUniform4fv(glGetUniformLocation(id, name.c_str()), 1, &value[0]);
+    glUniform4fv(getLocation(name), 1, &value[0]);
 }
-void Shader::setVec4(const std::string &name, float x, float y, float z, float w) const
+void Shader::setVec4(UniformName name, float x, float y, float z, float w) const
 {
-    glUniform4f(glGetUniformLocation(id, name.c_str()), x, y, z, w);
+    glUniform4f(getLocation(name), x, y, z, w);
 }
 
-void Shader::setMat2(const std::string &name, const glm::mat2 &mat) const
+void Shader::setMat2(UniformName name, const glm::mat2 &mat) const
 {
-    glUniformMatrix2fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix2fv(getLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 
-void Shader::setMat3(const std::string &name, const glm::mat3 &mat) const
+void Shader::setMat3(UniformName name, const glm::mat3 &mat) const
 {
-    glUniformMatrix3fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix3fv(getLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 
-void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const
+void Shader::setMat4(UniformName name, const glm::mat4 &mat) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix4fv(getLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::checkCompileError(unsigned int shader, std::string type)
@@ -1,45 +1,96 @@
 #ifndef shader_hpp
 #define shader_hpp
 
+#include <cstdint>
 #include <string>
 #include <iostream>
+#include <unordered_map>
 #include <vector>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+// fnv-1a of a uniform name, constexpr so names can be hashed at compile time
+constexpr uint32_t hashUniformName(const char *name, uint32_t hash = 2166136261u)
+{
+    while (*name)
+        hash = (hash ^ (uint32_t)(unsigned char)*name++) * 16777619u;
+    return hash;
+}
+
+// hashed uniform name, literals and strings convert implicitly
+struct UniformName
+{
+    uint32_t hash;
+
+    constexpr UniformName(const char *name) : hash(hashUniformName(name)) {}
+    UniformName(const std::string &name) : hash(hashUniformName(name.c_str())) {}
+    constexpr explicit UniformName(uint32_t hash) : hash(hash) {}
+};
+
+// typed handle, usually declared static constexpr next to its call site
+template <typename T>
+struct Uniform
+{
+    UniformName name;
+
+    constexpr explicit Uniform(const char *name) : name(name) {}
+};
+
 class Shader
 {
 public:
     Shader();
     ~Shader();
     unsigned int id;
+    // captured by transform feedback, interleaved in this order, set before init
+    std::vector<std::string> m_feedbackVaryings;
     void init(const std::string &vertexCode, const std::string &fragmentCode);
+    void init(const std::string &vertexCode, const std::string &fragmentCode, const std::string &geometryCode);
     void init(const std::string &vertexCode, const std::string &fragmentCode,
               const std::string &tessControlCode, const std::string &tessEvalCode);
     void use();
-    void setBool(const std::string &name, bool value) const;
-    void setInt(const std::string &name, int value) const;
-    void setFloat(const std::string &name, float value) const;
-    void setVec2(const std::string &name, const glm::vec2 &value) const;
-    void setVec2(const std::string &name, float x, float y) const;
-    void setVec3(const std::string &name, const glm::vec3 &value) const;
-    void setVec3(const std::string &name, float x, float y, float z) const;
-    void setVec4(const std::string &name, const glm::vec4 &value) const;
-    void setVec4(const std::string &name, float x, float y, float z, float w) const;
-    void setMat2(const std::string &name, const glm::mat2 &mat) const;
-    void setMat3(const std::string &name, const glm::mat3 &mat) const;
-    void setMat4(const std::string &name, const glm::mat4 &mat) const;
+    // -1 for unknown or inactive uniforms, no driver call
+    int getLocation(UniformName name) const;
+    void setBool(UniformName name, bool value) const;
+    void setInt(UniformName name, int value) const;
+    void setFloat(UniformName name, float value) const;
+    void setVec2(UniformName name, const glm::vec2 &value) const;
+    void setVec2(UniformName name, float x, float y) const;
+    void setVec3(UniformName name, const glm::vec3 &value) const;
+    void setVec3(UniformName name, float x, float y, float z) const;
+    // whole array from its first element, name is the array name
+    void setVec3(UniformName name, const glm::vec3 *values, int count) const;
+    void setVec4(UniformName name, const glm::vec4 &value) const;
+    void setVec4(UniformName name, float x, float y, float z, float w) const;
+    void setMat2(UniformName name, const glm::mat2 &mat) const;
+    void setMat3(UniformName name, const glm::mat3 &mat) const;
+    void setMat4(UniformName name, const glm::mat4 &mat) const;
+
+    void set(const Uniform<bool> &uniform, bool value) const { setBool(uniform.name, value); }
+    void set(const Uniform<int> &uniform, int value) const { setInt(uniform.name, value); }
+    void set(const Uniform<float> &uniform, float value) const { setFloat(uniform.name, value); }
+    void set(const Uniform<glm::vec2> &uniform, const glm::vec2 &value) const { setVec2(uniform.name, value); }
+    void set(const Uniform<glm::vec3> &uniform, const glm::vec3 &value) const { setVec3(uniform.name, value); }
+    void set(const Uniform<glm::vec4> &uniform, const glm::vec4 &value) const { setVec4(uniform.name, value); }
+    void set(const Uniform<glm::mat2> &uniform, const glm::mat2 &value) const { setMat2(uniform.name, value); }
+    void set(const Uniform<glm::mat3> &uniform, const glm::mat3 &value) const { setMat3(uniform.name, value); }
+    void set(const Uniform<glm::mat4> &uniform, const glm::mat4 &value) const { setMat4(uniform.name, value); }
 
 private:
+    // active uniform locations by name hash, filled after link
+    std::unordered_map<uint32_t, int> m_locations;
+
+    void reflectUniforms();
     void checkCompileError(unsigned int shader, std::string type);
     void checkLinkingError();
     void compile();
     void link();
-    unsigned int vertexId_, fragmentId_, tessControlId_, tessEvalId_;
+    unsigned int vertexId_, fragmentId_, geometryId_, tessControlId_, tessEvalId_;
     std::string vertexCode_;
     std::string fragmentCode_;
+    std::string geometryCode_;
     std::string tessControlCode_;
     std::string tessEvalCode_;
 };
@@ -39,11 +39,22 @@ void ShaderManager::initShader(const ShaderDynamic &shaderDynamic)
     std::string fsCode = FileManager::read(fsPathStr);
     std::string vsDirectory = vsPath.parent_path().string();
     std::string fsDirectory = fsPath.parent_path().string();
-    shaderDynamic.m_shader->init(processIncludes(vsDirectory, vsCode), processIncludes(fsDirectory, fsCode));
+    if (shaderDynamic.m_gsPath.empty())
+    {
+        shaderDynamic.m_shader->init(processIncludes(vsDirectory, vsCode), processIncludes(fsDirectory, fsCode));
+    }
+    else
+    {
+        std::filesystem::path gsPath = m_executablePath + '/' + shaderDynamic.m_gsPath;
+        std::string gsCode = FileManager::read(gsPath.string());
+        shaderDynamic.m_shader->init(processIncludes(vsDirectory, vsCode), processIncludes(fsDirectory, fsCode),
+                                     processIncludes(gsPath.parent_path().string(), gsCode));
+    }
 
     unsigned int end = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
     unsigned int duration = end - start;
-    std::cout << std::setfill(' ') << std::setw(4) << duration << "ms - Shader - vs: " << shaderDynamic.m_vsPath << " - fs: " << shaderDynamic.m_fsPath << std::endl;
+    std::cout << std::setfill(' ') << std::setw(4) << duration << "ms - Shader - vs: " << shaderDynamic.m_vsPath << " - fs: " << shaderDynamic.m_fsPath
+              << (shaderDynamic.m_gsPath.empty() ? "" : " - gs: " + shaderDynamic.m_gsPath) << std::endl;
 }
 
 // Function to process and replace #include directives
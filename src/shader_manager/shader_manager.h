@@ -15,6 +15,8 @@ struct ShaderDynamic
     Shader *m_shader;
     std::string m_vsPath;
     std::string m_fsPath;
+    // optional
+    std::string m_gsPath;
 
     ShaderDynamic(Shader *shader, std::string vsPath, std::string fsPath)
         : m_shader(shader),
@@ -22,6 +24,14 @@ struct ShaderDynamic
           m_fsPath(fsPath)
     {
     }
+
+    ShaderDynamic(Shader *shader, std::string vsPath, std::string fsPath, std::string gsPath)
+        : m_shader(shader),
+          m_vsPath(vsPath),
+          m_fsPath(fsPath),
+          m_gsPath(gsPath)
+    {
+    }
 };
 
 class ShaderManager
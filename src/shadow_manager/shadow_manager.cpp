@@ -11,6 +11,7 @@ ShadowManager::~ShadowManager()
 {
     m_frustums.clear();
     m_depthPMatrices.clear();
+    delete m_ubo;
 }
 
 // Shadowmap lookup matrices
@@ -23,11 +24,9 @@ void ShadowManager::setupUBO()
         glUniformBlockBinding(shaderId, uniformBlockIndex, 0);
     }
 
-    glGenBuffers(1, &m_ubo);
-    glBindBuffer(GL_UNIFORM_BUFFER, m_ubo);
-    glBufferData(GL_UNIFORM_BUFFER, sizeof(glm::mat4) * m_splitCount, NULL, GL_STREAM_DRAW);
-    glBindBufferRange(GL_UNIFORM_BUFFER, 0, m_ubo, 0, sizeof(glm::mat4) * m_splitCount);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    int alignment;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    m_ubo = new StreamBuffer(StreamMode::ring, alignment);
 }
 
 // TODO: update cam values
@@ -83,66 +82,26 @@ void ShadowManager::updateFrustumPoints(frustum &f, glm::vec3 &center, glm::vec3
 // First, it computes the appropriate z-range and sets an orthogonal projection.
 // Then, it translates and scales it, so that it exactly captures the bounding box
 // of the current frustum slice
-glm::mat4 ShadowManager::applyCropMatrix(int frustumIndex, glm::mat4 lightView)
+glm::mat4 ShadowManager::applyCropMatrix(int frustumIndex, glm::mat4 lightView, const std::vector<aabb> &casterAabbs)
 {
     frustum &f = m_frustums[frustumIndex];
-    float maxX, maxY, maxZ, minX, minY, minZ;
+    glm::vec3 boundsMin, boundsMax;
+    getLightBounds(frustumIndex, lightView, boundsMin, boundsMax);
+    float minX = boundsMin.x, minY = boundsMin.y, minZ = boundsMin.z;
+    float maxX = boundsMax.x, maxY = boundsMax.y, maxZ = boundsMax.z;
 
     glm::mat4 nv_mvp = lightView;
-    glm::vec4 transf;
-
-    // found min-max X, Y, Z
-    transf = nv_mvp * glm::vec4(f.points[0], 1.0f);
-    minX = transf.x;
-    maxX = transf.x;
-    minY = transf.y;
-    maxY = transf.y;
-    minZ = transf.z;
-    maxZ = transf.z;
-    for (int i = 1; i < 8; i++)
-    {
-        transf = nv_mvp * glm::vec4(f.points[i], 1.0f);
-
-        if (transf.z > maxZ)
-            maxZ = transf.z;
-        if (transf.z < minZ)
-            minZ = transf.z;
-
-        // eliminate the perspective - for point lights - ?
-        transf.x /= transf.w;
-        transf.y /= transf.w;
-
-        if (transf.x > maxX)
-            maxX = transf.x;
-        if (transf.x < minX)
-            minX = transf.x;
-        if (transf.y > maxY)
-            maxY = transf.y;
-        if (transf.y < minY)
-            minY = transf.y;
-    }
 
-    // extend borders with scene objects
-    float objMinZ = minZ;
-    float objMaxZ = maxZ;
-    for (int i = 0; i < m_sceneObjects.size(); i++)
+    // extend the depth range with the casters, they are already known to overlap the split in x and y
+    for (int i = 0; i < casterAabbs.size() && !m_stableCascades; i++)
     {
-        SceneObject &object = m_sceneObjects[i];
-        glm::vec3 &center = object.center;
-        float radius = object.radius;
+        glm::vec3 center = (casterAabbs[i].min + casterAabbs[i].max) * 0.5f;
+        float radius = glm::distance(casterAabbs[i].min, casterAabbs[i].max) * 0.5f;
+        float z = (lightView * glm::vec4(center, 1.0f)).z;
 
-        if (!(center.x - radius > maxX || center.x + radius < minX) &&
-            !(center.y - radius > maxY || center.y + radius < minY))
-        {
-            // mark object with frustum index
-            object.frustumIndexes.push_back(frustumIndex);
-
-            objMinZ = std::min(center.z - radius, objMinZ);
-            objMaxZ = std::max(center.z + radius, objMaxZ);
-        }
+        minZ = std::min(z - radius, minZ);
+        maxZ = std::max(z + radius, maxZ);
     }
-    minZ = std::min(minZ, objMinZ);
-    maxZ = std::max(maxZ, objMaxZ);
 
     f.lightAABB[0] = glm::vec3(minX, minY, maxZ);
     f.lightAABB[1] = glm::vec3(maxX, minY, maxZ);
@@ -213,37 +172,78 @@ void ShadowManager::setupFrustum(float screenWidth, float screenHeight, glm::mat
     updateFrustumAabb();
 }
 
-void ShadowManager::setupLightAabb(const std::vector<aabb> &objectAabbs)
+void ShadowManager::setupLightAabb(const std::vector<std::vector<aabb>> &casterAabbs)
 {
     glm::mat4 depthViewMatrix = getDepthViewMatrix();
 
-    m_sceneObjects.clear();
-    for (int i = 0; i < objectAabbs.size(); i++)
-    {
-        glm::vec3 center = (objectAabbs[i].min + objectAabbs[i].max) * 0.5f;
-        // TODO: any other way?
-        float radius = glm::distance(objectAabbs[i].min, objectAabbs[i].max) * 0.5f;
-
-        glm::vec4 transf = depthViewMatrix * glm::vec4(center, 1.0f);
-        // eliminate the perspective - for point lights - ?
-        transf.x /= transf.w;
-        transf.y /= transf.w;
-
-        SceneObject sceneObject;
-        sceneObject.center = glm::vec3(transf);
-        sceneObject.radius = radius;
-        m_sceneObjects.push_back(sceneObject);
-    }
-
     for (int i = 0; i < m_splitCount; i++)
     {
-        glm::mat4 projection = applyCropMatrix(i, depthViewMatrix);
+        glm::mat4 projection = applyCropMatrix(i, depthViewMatrix, casterAabbs[i]);
         m_depthPMatrices.push_back(projection);
     }
 
     setupBiasMatrices(depthViewMatrix);
 }
 
+// light space box of the split with its near side moved to the light, anything inside can shadow the split
+void ShadowManager::getCasterPlanes(int frustumIndex, std::vector<glm::vec4> &planes)
+{
+    glm::mat4 lightView = getDepthViewMatrix();
+    glm::vec3 boundsMin, boundsMax;
+    getLightBounds(frustumIndex, lightView, boundsMin, boundsMax);
+
+    // the light looks along -z, casters are at larger z than the split
+    glm::vec4 lightPlanes[5] = {
+        glm::vec4(1.f, 0.f, 0.f, -boundsMin.x),
+        glm::vec4(-1.f, 0.f, 0.f, boundsMax.x),
+        glm::vec4(0.f, 1.f, 0.f, -boundsMin.y),
+        glm::vec4(0.f, -1.f, 0.f, boundsMax.y),
+        glm::vec4(0.f, 0.f, 1.f, -boundsMin.z)};
+
+    // light view is rigid, transformed planes stay normalized
+    planes.clear();
+    for (int i = 0; i < 5; i++)
+        planes.push_back(lightPlanes[i] * lightView);
+}
+
+// bounds of the split's corners in light view space, or its stable box
+void ShadowManager::getLightBounds(int frustumIndex, const glm::mat4 &lightView, glm::vec3 &boundsMin, glm::vec3 &boundsMax)
+{
+    frustum &f = m_frustums[frustumIndex];
+
+    if (m_stableCascades)
+    {
+        // the sphere doesn't change with the view direction
+        glm::vec3 center = glm::vec3(0.f);
+        for (int i = 0; i < 8; i++)
+            center += f.points[i] / 8.f;
+        float radius = 0.f;
+        for (int i = 0; i < 8; i++)
+            radius = std::max(radius, glm::distance(center, f.points[i]));
+        // rounding error of the points would change the box every frame
+        radius = std::ceil(radius * 16.f) / 16.f;
+
+        float halfSize = radius * (1.f + m_stableMargin);
+        float texelSize = 2.f * halfSize / m_shadowmapSize;
+        float step = std::max(texelSize, std::floor(radius * m_stableMargin / texelSize) * texelSize);
+
+        glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+        lightCenter = glm::floor(lightCenter / step + 0.5f) * step;
+        boundsMin = lightCenter - halfSize;
+        boundsMax = lightCenter + halfSize;
+        return;
+    }
+
+    boundsMin = glm::vec3(lightView * glm::vec4(f.points[0], 1.0f));
+    boundsMax = boundsMin;
+    for (int i = 1; i < 8; i++)
+    {
+        glm::vec3 point = glm::vec3(lightView * glm::vec4(f.points[i], 1.0f));
+        boundsMin = glm::min(boundsMin, point);
+        boundsMax = glm::max(boundsMax, point);
+    }
+}
+
 void ShadowManager::setupBiasMatrices(glm::mat4 depthViewMatrix)
 {
     glm::mat4 depthBiasVPMatrices[m_splitCount];
@@ -253,9 +253,9 @@ void ShadowManager::setupBiasMatrices(glm::mat4 depthViewMatrix)
         depthBiasVPMatrices[i] = m_biasMatrix * m_depthPMatrices[i] * depthViewMatrix;
     }
 
-    glBindBuffer(GL_UNIFORM_BUFFER, m_ubo);
-    glBufferData(GL_UNIFORM_BUFFER, sizeof(glm::mat4) * m_splitCount, depthBiasVPMatrices, GL_DYNAMIC_DRAW);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    int size = sizeof(glm::mat4) * m_splitCount;
+    int offset = m_ubo->uploadChanged(depthBiasVPMatrices, size);
+    glBindBufferRange(GL_UNIFORM_BUFFER, 0, m_ubo->m_buffer, offset, size);
 }
 
 void ShadowManager::updateFrustumAabb()
@@ -10,6 +10,7 @@
 #include <glm/glm.hpp>
 
 #include "../camera/camera.h"
+#include "../stream_buffer/stream_buffer.h"
 
 struct frustum
 {
@@ -31,13 +32,6 @@ struct aabb
     aabb(glm::vec3 min, glm::vec3 max) : min(min), max(max){};
 };
 
-struct SceneObject
-{
-    glm::vec3 center;
-    float radius;
-    std::vector<int> frustumIndexes;
-};
-
 class ShadowManager
 {
 public:
@@ -47,9 +41,16 @@ public:
     Camera *m_camera;
     std::vector<frustum> m_frustums;
     std::vector<float> m_frustumDistances;
-    std::vector<SceneObject> m_sceneObjects;
     aabb m_aabb;
     int m_splitCount = 3;
+    // cascades cover a box around the bounding sphere of their split that moves in whole steps
+    // the projections stay the same between steps so the maps can be cached
+    // casters nearer to the light than the box are left to depth clamping
+    bool m_stableCascades = false;
+    // border of a stable box relative to the sphere radius, also the step it moves in
+    float m_stableMargin = 0.25f;
+    // texels per side, stable boxes snap to whole texels
+    int m_shadowmapSize = 512;
     float m_splitWeight = 0.75f;
     float m_near = 0.1f;
     float m_far = 200.0f;
@@ -63,10 +64,14 @@ public:
 
     glm::mat4 getDepthViewMatrix();
     void setupFrustum(float screenWidth, float screenHeight, glm::mat4 projection, glm::vec3 worldOrigin);
-    void setupLightAabb(const std::vector<aabb> &objectAabbs);
+    // casters of each split, from the culling volumes of getCasterPlanes
+    void setupLightAabb(const std::vector<std::vector<aabb>> &casterAabbs);
+    // world space volume holding every possible caster of the split, after setupFrustum
+    void getCasterPlanes(int frustumIndex, std::vector<glm::vec4> &planes);
 
 private:
-    unsigned int m_ubo;
+    // ranged per upload, unchanged while the cascades are stable
+    StreamBuffer *m_ubo;
     glm::mat4 m_biasMatrix = glm::mat4(
         0.5, 0.0, 0.0, 0.0,
         0.0, 0.5, 0.0, 0.0,
@@ -76,7 +81,8 @@ private:
     void setupUBO();
     void updateSplitDist(float nd, float fd);
     void updateFrustumPoints(frustum &f, glm::vec3 &center, glm::vec3 &view_dir);
-    glm::mat4 applyCropMatrix(int frustumIndex, glm::mat4 lightView);
+    glm::mat4 applyCropMatrix(int frustumIndex, glm::mat4 lightView, const std::vector<aabb> &casterAabbs);
+    void getLightBounds(int frustumIndex, const glm::mat4 &lightView, glm::vec3 &boundsMin, glm::vec3 &boundsMax);
     void setupBiasMatrices(glm::mat4 depthViewMatrix);
     void updateFrustumAabb();
 };
@@ -13,7 +13,10 @@ ShadowmapManager::ShadowmapManager(int cascadeCount, int shadowmapSize)
 
 ShadowmapManager::~ShadowmapManager()
 {
-    // TODO: destruction
+    deleteCacheTextureArray();
+
+    glDeleteTextures(1, &m_textureArray);
+    glDeleteFramebuffers(1, &m_framebufferObject);
 }
 
 void ShadowmapManager::createTextureArray()
@@ -54,6 +57,71 @@ void ShadowmapManager::createTextureArray()
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+// same format as the cascades so layers can be blitted
+void ShadowmapManager::createCacheTextureArray()
+{
+    deleteCacheTextureArray();
+
+    glGenFramebuffers(1, &m_cacheFramebufferObject);
+
+    glGenTextures(1, &m_cacheTextureArray);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_cacheTextureArray);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT, m_shadowmapSize, m_shadowmapSize, m_cascadeCount, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_cacheFramebufferObject);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_cacheTextureArray, 0, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        fprintf(stderr, "ShadowmapManager: Cache framebuffer creation error!\n");
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferObject);
+}
+
+void ShadowmapManager::deleteCacheTextureArray()
+{
+    if (m_cacheFramebufferObject != 0)
+    {
+        glDeleteFramebuffers(1, &m_cacheFramebufferObject);
+        m_cacheFramebufferObject = 0;
+    }
+
+    if (m_cacheTextureArray != 0)
+    {
+        glDeleteTextures(1, &m_cacheTextureArray);
+        m_cacheTextureArray = 0;
+    }
+}
+
+void ShadowmapManager::bindCacheLayer(int index)
+{
+    if (m_cacheTextureArray == 0)
+        createCacheTextureArray();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_cacheFramebufferObject);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_cacheTextureArray, 0, index);
+    glViewport(0, 0, m_shadowmapSize, m_shadowmapSize);
+
+    glClearDepth(1.0f);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void ShadowmapManager::restoreCacheLayer(int index)
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_cacheFramebufferObject);
+    glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_cacheTextureArray, 0, index);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebufferObject);
+    glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_textureArray, 0, index);
+
+    glBlitFramebuffer(0, 0, m_shadowmapSize, m_shadowmapSize, 0, 0, m_shadowmapSize, m_shadowmapSize, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferObject);
+    glViewport(0, 0, m_shadowmapSize, m_shadowmapSize);
+}
+
 void ShadowmapManager::bindFramebuffer()
 {
     glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferObject);
@@ -90,4 +158,7 @@ void ShadowmapManager::updateSize(int size)
     m_shadowmapSize = size;
 
     createTextureArray();
+
+    // recreated with the new size when used again
+    deleteCacheTextureArray();
 }
@@ -11,9 +11,15 @@ public:
     ~ShadowmapManager();
 
     GLuint m_textureArray;
+    // static casters of each cascade, created on first use
+    GLuint m_cacheTextureArray = 0;
 
     void bindFramebuffer();
     void bindTextureArray(int index);
+    // binds the cascade's cache layer and clears it
+    void bindCacheLayer(int index);
+    // copies the cache layer into the cascade and binds the cascade without clearing it
+    void restoreCacheLayer(int index);
     void updateSize(int size);
 
     int getSize()
@@ -23,10 +29,13 @@ public:
 
 private:
     GLuint m_framebufferObject;
+    GLuint m_cacheFramebufferObject = 0;
     int m_cascadeCount;
     int m_shadowmapSize;
 
     void createTextureArray();
+    void createCacheTextureArray();
+    void deleteCacheTextureArray();
 };
 
 #endif /* shadowmap_manager_hpp */
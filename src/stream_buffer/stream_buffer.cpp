@@ -0,0 +1,165 @@
+#include "stream_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+std::vector<StreamBuffer *> StreamBuffer::s_buffers;
+StreamStats StreamBuffer::s_stats;
+StreamStats StreamBuffer::s_frameStats;
+
+StreamBuffer::StreamBuffer(StreamMode mode, int alignment)
+    : m_mode(mode),
+      m_alignment(alignment),
+      m_regionSize(0),
+      m_region(0),
+      m_head(0),
+      m_written(false),
+      m_used(false),
+      m_lastOffset(0)
+{
+    // fences are core since 3.2, without them the ring falls back to orphaning
+    if (m_mode == StreamMode::ring && !(GLEW_VERSION_3_2 || GLEW_ARB_sync))
+        m_mode = StreamMode::orphan;
+
+    for (int i = 0; i < STREAM_BUFFER_REGIONS; i++)
+        m_fences[i] = nullptr;
+
+    glGenBuffers(1, &m_buffer);
+    s_buffers.push_back(this);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    s_buffers.erase(std::remove(s_buffers.begin(), s_buffers.end(), this), s_buffers.end());
+
+    for (int i = 0; i < STREAM_BUFFER_REGIONS; i++)
+    {
+        if (m_fences[i])
+            glDeleteSync(m_fences[i]);
+    }
+    glDeleteBuffers(1, &m_buffer);
+}
+
+void StreamBuffer::beginFrame()
+{
+    for (int i = 0; i < s_buffers.size(); i++)
+    {
+        StreamBuffer *buffer = s_buffers[i];
+
+        // the region stays current while its data is unchanged, the newest fence covers every frame reading it
+        if (buffer->m_used && buffer->m_mode == StreamMode::ring && buffer->m_regionSize > 0)
+        {
+            GLsync &fence = buffer->m_fences[buffer->m_region];
+            if (fence)
+                glDeleteSync(fence);
+            fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+
+        buffer->m_used = false;
+        buffer->m_written = false;
+    }
+
+    s_stats = s_frameStats;
+    s_frameStats = StreamStats();
+}
+
+int StreamBuffer::upload(const void *data, int size)
+{
+    m_used = true;
+    m_lastData.clear();
+    s_frameStats.uploadCount++;
+    s_frameStats.bytesUploaded += size;
+
+    // copy write target, binding an element buffer would change the bound vao
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+
+    if (m_mode == StreamMode::orphan)
+    {
+        if (size > m_regionSize)
+            m_regionSize = std::max(size, m_regionSize * 2);
+
+        // never empty so a texture buffer stays valid
+        glBufferData(GL_COPY_WRITE_BUFFER, std::max(m_regionSize, 16), nullptr, GL_STREAM_DRAW);
+        if (size > 0)
+            glBufferSubData(GL_COPY_WRITE_BUFFER, 0, size, data);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return 0;
+    }
+
+    if (!m_written)
+    {
+        m_written = true;
+        m_region = (m_region + 1) % STREAM_BUFFER_REGIONS;
+        m_head = 0;
+        waitRegion(m_region);
+    }
+
+    int offset = (m_head + m_alignment - 1) / m_alignment * m_alignment;
+    if (offset + size > m_regionSize)
+    {
+        grow(offset + size);
+        offset = 0;
+    }
+
+    if (size > 0)
+    {
+        // the fence of the region already passed, no need for the driver to synchronize
+        void *target = glMapBufferRange(GL_COPY_WRITE_BUFFER, m_region * m_regionSize + offset, size,
+                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        memcpy(target, data, size);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    m_head = offset + size;
+    return m_region * m_regionSize + offset;
+}
+
+int StreamBuffer::uploadChanged(const void *data, int size)
+{
+    if (!m_lastData.empty() && size == m_lastData.size() && memcmp(m_lastData.data(), data, size) == 0)
+    {
+        m_used = true;
+        s_frameStats.skippedCount++;
+        return m_lastOffset;
+    }
+
+    m_lastOffset = upload(data, size);
+    m_lastData.assign((const char *)data, (const char *)data + size);
+    return m_lastOffset;
+}
+
+// new storage for the ring, draws already issued keep reading the old one
+void StreamBuffer::grow(int size)
+{
+    m_regionSize = std::max(size, m_regionSize * 2);
+    m_regionSize = (m_regionSize + m_alignment - 1) / m_alignment * m_alignment;
+    glBufferData(GL_COPY_WRITE_BUFFER, m_regionSize * STREAM_BUFFER_REGIONS, nullptr, GL_STREAM_DRAW);
+
+    for (int i = 0; i < STREAM_BUFFER_REGIONS; i++)
+    {
+        if (m_fences[i])
+            glDeleteSync(m_fences[i]);
+        m_fences[i] = nullptr;
+    }
+    m_region = 0;
+    m_head = 0;
+}
+
+void StreamBuffer::waitRegion(int region)
+{
+    GLsync fence = m_fences[region];
+    if (!fence)
+        return;
+
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED)
+    {
+        s_frameStats.stallCount++;
+        while (result == GL_TIMEOUT_EXPIRED)
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    }
+
+    glDeleteSync(fence);
+    m_fences[region] = nullptr;
+}
@@ -0,0 +1,77 @@
+#ifndef stream_buffer_hpp
+#define stream_buffer_hpp
+
+#include <vector>
+
+#include <GL/glew.h>
+
+// frames in flight, each writes its own region of a ring buffer
+#define STREAM_BUFFER_REGIONS 3
+
+enum class StreamMode
+{
+    // regions written unsynchronized, fenced against the gpu, data lives at the returned offset
+    ring,
+    // storage replaced on every upload, data always at offset 0
+    // for consumers that can't take an offset, like texture buffers in 4.1
+    orphan
+};
+
+struct StreamStats
+{
+    int uploadCount = 0;
+    // unchanged data that was not uploaded again
+    int skippedCount = 0;
+    int bytesUploaded = 0;
+    // waits on a region the gpu was still reading
+    int stallCount = 0;
+};
+
+// per frame data of the engine is uploaded through these instead of glBufferData
+class StreamBuffer
+{
+public:
+    // offsets of a ring are multiples of alignment, like GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT for uniform ranges
+    StreamBuffer(StreamMode mode = StreamMode::ring, int alignment = 16);
+    ~StreamBuffer();
+
+    // over all buffers, of the last finished frame
+    static StreamStats s_stats;
+
+    StreamMode m_mode;
+    unsigned int m_buffer;
+
+    // fences the regions used by the frame and starts the next, once per frame before any upload
+    static void beginFrame();
+
+    // returns the offset of the data in m_buffer
+    // uploads of a frame are appended, earlier ones stay valid for draws issued before a later upload grows the buffer
+    int upload(const void *data, int size);
+    // same data as the last upload returns its offset without writing
+    // called every frame the data is read, the call keeps its region fenced
+    int uploadChanged(const void *data, int size);
+
+private:
+    static std::vector<StreamBuffer *> s_buffers;
+    static StreamStats s_frameStats;
+
+    int m_alignment;
+    // in bytes
+    int m_regionSize;
+    int m_region;
+    int m_head;
+    // written this frame, the next write starts a new region
+    bool m_written;
+    // read by the draws of this frame
+    bool m_used;
+    GLsync m_fences[STREAM_BUFFER_REGIONS];
+
+    // for uploadChanged
+    std::vector<char> m_lastData;
+    int m_lastOffset;
+
+    void grow(int size);
+    void waitRegion(int region);
+};
+
+#endif /* stream_buffer_hpp */
@@ -312,7 +312,7 @@ void Terrain::createMesh(int m, int n, unsigned int &vbo, unsigned int &vao, uns
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-void Terrain::drawColor(PbrManager *pbrManager, Shader terrainShader, glm::vec3 lightPosition, glm::vec3 lightColor, float lightPower,
+void Terrain::drawColor(PbrManager *pbrManager, Shader &terrainShader, glm::vec3 lightPosition, glm::vec3 lightColor, float lightPower,
                         glm::mat4 view, glm::mat4 projection, glm::vec3 viewPos,
                         glm::mat4 cullView, glm::mat4 cullProjection, glm::vec3 cullViewPos,
                         GLuint shadowmapId, glm::vec3 camPos, glm::vec3 camView, glm::vec4 frustumDistances, glm::vec3 shadowBias,
@@ -349,40 +349,40 @@ void Terrain::drawColor(PbrManager *pbrManager, Shader terrainShader, glm::vec3
 
     // elevation
     glActiveTexture(GL_TEXTURE0);
-    glUniform1i(glGetUniformLocation(terrainShader.id, "elevationSampler"), 0);
+    terrainShader.setInt("elevationSampler", 0);
     glBindTexture(GL_TEXTURE_2D, textureID);
 
     // shadowmap
     glActiveTexture(GL_TEXTURE0 + 1);
-    glUniform1i(glGetUniformLocation(terrainShader.id, "ShadowMap"), 1);
+    terrainShader.setInt("ShadowMap", 1);
     glBindTexture(GL_TEXTURE_2D_ARRAY, shadowmapId);
 
     // texture arrays
     glActiveTexture(GL_TEXTURE0 + 2);
-    glUniform1i(glGetUniformLocation(terrainShader.id, "texture_diffuse1"), 2);
+    terrainShader.setInt("texture_diffuse1", 2);
     glBindTexture(GL_TEXTURE_2D_ARRAY, m_diffuseArray.id);
     glActiveTexture(GL_TEXTURE0 + 3);
-    glUniform1i(glGetUniformLocation(terrainShader.id, "texture_normal1"), 3);
+    terrainShader.setInt("texture_normal1", 3);
     glBindTexture(GL_TEXTURE_2D_ARRAY, m_normalArray.id);
     glActiveTexture(GL_TEXTURE0 + 4);
-    glUniform1i(glGetUniformLocation(terrainShader.id, "texture_ao1"), 4);
+    terrainShader.setInt("texture_ao1", 4);
     glBindTexture(GL_TEXTURE_2D_ARRAY, m_aoArray.id);
     glActiveTexture(GL_TEXTURE0 + 5);
-    glUniform1i(glGetUniformLocation(terrainShader.id, "texture_rough1"), 5);
+    terrainShader.setInt("texture_rough1", 5);
     glBindTexture(GL_TEXTURE_2D_ARRAY, m_roughArray.id);
     glActiveTexture(GL_TEXTURE0 + 6);
-    glUniform1i(glGetUniformLocation(terrainShader.id, "texture_height1"), 6);
+    terrainShader.setInt("texture_height1", 6);
     glBindTexture(GL_TEXTURE_2D_ARRAY, m_heightArray.id);
 
     // pbr
     glActiveTexture(GL_TEXTURE0 + 7);
-    glUniform1i(glGetUniformLocation(terrainShader.id, "irradianceMap"), 7);
+    terrainShader.setInt("irradianceMap", 7);
     glBindTexture(GL_TEXTURE_CUBE_MAP, pbrManager->irradianceMap);
     glActiveTexture(GL_TEXTURE0 + 8);
-    glUniform1i(glGetUniformLocation(terrainShader.id, "prefilterMap"), 8);
+    terrainShader.setInt("prefilterMap", 8);
     glBindTexture(GL_TEXTURE_CUBE_MAP, pbrManager->prefilterMap);
     glActiveTexture(GL_TEXTURE0 + 9);
-    glUniform1i(glGetUniformLocation(terrainShader.id, "brdfLUT"), 9);
+    terrainShader.setInt("brdfLUT", 9);
     glBindTexture(GL_TEXTURE_2D, pbrManager->brdfLUTTexture);
 
     draw(terrainShader, cullViewPos, ortho);
@@ -406,7 +406,7 @@ void Terrain::updateHorizontalScale()
     updateHeightMatrix();
 }
 
-void Terrain::drawDepth(Shader terrainShadow, glm::mat4 view, glm::mat4 projection, glm::vec3 viewPos)
+void Terrain::drawDepth(Shader &terrainShadow, glm::mat4 view, glm::mat4 projection, glm::vec3 viewPos)
 {
     calculatePlanes(projection, view);
 
@@ -422,13 +422,13 @@ void Terrain::drawDepth(Shader terrainShadow, glm::mat4 view, glm::mat4 projecti
     terrainShadow.setMat4("V", view);
 
     glActiveTexture(GL_TEXTURE0);
-    glUniform1i(glGetUniformLocation(terrainShadow.id, "elevationSampler"), 0);
+    terrainShadow.setInt("elevationSampler", 0);
     glBindTexture(GL_TEXTURE_2D, textureID);
 
     draw(terrainShadow, viewPos, true);
 }
 
-void Terrain::draw(Shader terrainShader, glm::vec3 viewPos, bool ortho)
+void Terrain::draw(Shader &terrainShader, glm::vec3 viewPos, bool ortho)
 {
     glm::vec3 vPos = viewPos - glm::vec3(m_worldOrigin.x, 0.f, m_worldOrigin.y);
     int m = resolution;
@@ -622,7 +622,7 @@ void Terrain::draw(Shader terrainShader, glm::vec3 viewPos, bool ortho)
     }
 }
 
-void Terrain::drawInstance(glm::vec3 grassColorFactor, glm::vec3 playerPos, Shader instanceShader, Model *model, int tileSize, float density, glm::mat4 projection, glm::mat4 view, glm::vec3 viewPos)
+void Terrain::drawInstance(glm::vec3 grassColorFactor, glm::vec3 playerPos, Shader &instanceShader, Model *model, int tileSize, float density, glm::mat4 projection, glm::mat4 view, glm::vec3 viewPos)
 {
     int tileSize1 = tileSize;
     int tileSize2 = tileSize * 2;
@@ -691,7 +691,7 @@ void Terrain::drawInstance(glm::vec3 grassColorFactor, glm::vec3 playerPos, Shad
 
     // TODO: texture unit based on texture count for instanced model
     glActiveTexture(GL_TEXTURE0 + 1);
-    glUniform1i(glGetUniformLocation(instanceShader.id, "elevationSampler"), 1);
+    instanceShader.setInt("elevationSampler", 1);
     glBindTexture(GL_TEXTURE_2D, textureID);
 
     for (int i = 0; i < 24; i++)
@@ -720,7 +720,7 @@ void Terrain::drawInstance(glm::vec3 grassColorFactor, glm::vec3 playerPos, Shad
 }
 
 // TODO: reduce glBindVertexArray calls
-void Terrain::drawBlock(Shader shader, unsigned int vao, int scale, glm::vec2 size, glm::vec2 pos, int indiceCount, glm::vec3 viewPos, bool ortho)
+void Terrain::drawBlock(Shader &shader, unsigned int vao, int scale, glm::vec2 size, glm::vec2 pos, int indiceCount, glm::vec3 viewPos, bool ortho)
 {
     glm::vec2 blockSize = glm::vec2(size.x * scale, size.y * scale);
 
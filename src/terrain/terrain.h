@@ -97,13 +97,13 @@ public:
     void renderDepth() override;
     void renderColor() override;
 
-    void drawDepth(Shader terrainShadow, glm::mat4 view, glm::mat4 projection, glm::vec3 viewPos);
-    void drawColor(PbrManager *pbrManager, Shader terrainShader, glm::vec3 lightPosition, glm::vec3 lightColor, float lightPower,
+    void drawDepth(Shader &terrainShadow, glm::mat4 view, glm::mat4 projection, glm::vec3 viewPos);
+    void drawColor(PbrManager *pbrManager, Shader &terrainShader, glm::vec3 lightPosition, glm::vec3 lightColor, float lightPower,
                    glm::mat4 view, glm::mat4 projection, glm::vec3 viewPos,
                    glm::mat4 cullView, glm::mat4 cullProjection, glm::vec3 cullViewPos,
                    GLuint shadowmapId, glm::vec3 camPos, glm::vec3 camView, glm::vec4 frustumDistances, glm::vec3 shadowBias,
                    bool ortho);
-    void drawInstance(glm::vec3 grassColorFactor, glm::vec3 playerPos, Shader instanceShader, Model *model, int tileSize, float density, glm::mat4 projection, glm::mat4 view, glm::vec3 viewPos);
+    void drawInstance(glm::vec3 grassColorFactor, glm::vec3 playerPos, Shader &instanceShader, Model *model, int tileSize, float density, glm::mat4 projection, glm::mat4 view, glm::vec3 viewPos);
     void updateHorizontalScale();
 
 private:
@@ -117,8 +117,8 @@ private:
     void createMesh(int m, int n, unsigned int &vbo, unsigned int &vao, unsigned int &ebo);
     void createOuterCoverMesh(int size, unsigned int &vbo, unsigned int &vao, unsigned int &ebo);
     void createTriangleFanMesh(int size, unsigned int &vbo, unsigned int &vao, unsigned int &ebo);
-    void draw(Shader shader, glm::vec3 viewPos, bool ortho);
-    void drawBlock(Shader shader, unsigned int vao, int scale, glm::vec2 size, glm::vec2 pos, int indiceCount, glm::vec3 viewPos, bool ortho);
+    void draw(Shader &shader, glm::vec3 viewPos, bool ortho);
+    void drawBlock(Shader &shader, unsigned int vao, int scale, glm::vec2 size, glm::vec2 pos, int indiceCount, glm::vec3 viewPos, bool ortho);
 
     // frustum culling
     glm::vec4 m_planes[5];
@@ -4,7 +4,7 @@
 
 AnimationUI::AnimationUI(Animator *animator)
     : m_animator(animator),
-      m_selectedAnimation(nullptr)
+      m_selectedAnim(nullptr)
 {
 }
 
@@ -65,18 +65,20 @@ void AnimationUI::renderBlendTable(const std::string &tableName, std::vector<Ani
 
 void AnimationUI::renderSelectedAnimation()
 {
-    if (m_selectedAnimation == nullptr)
+    if (m_selectedAnim == nullptr)
         return;
 
-    ImGui::Text("Name: %s", m_selectedAnimation->m_name.c_str());
+    ImGui::Text("Name: %s", m_selectedAnim->m_animation->m_name.c_str());
+    ImGui::Text("Clip: %s", m_selectedAnim->m_ownedAnimation ? "own copy" : "shared, copied on first edit");
 
     if (!ImGui::TreeNode("Bones##AnimationUI::renderSelectedAnimation"))
         return;
 
-    auto bonesMap = &m_selectedAnimation->m_bones;
-    for (auto it = bonesMap->begin(); it != bonesMap->end(); ++it)
+    for (int nodeIndex = 0; nodeIndex < m_selectedAnim->m_channels.size(); nodeIndex++)
     {
-        Bone *bone = it->second;
+        Bone *bone = m_selectedAnim->m_channels[nodeIndex];
+        if (!bone)
+            continue;
 
         auto i = std::find_if(
             m_boneNames.begin(),
@@ -87,11 +89,29 @@ void AnimationUI::renderSelectedAnimation()
 
         ImGui::PushID(bone);
         ImGui::Text("%s", bone->m_name.c_str());
-        ImGui::DragFloat("Blend", &bone->m_blendFactor, 0.01f, 0.0f, 1.0f);
-        ImGui::DragFloat3("Position", &bone->m_positions[0].value[0], 0.001f);
-        // if (ImGui::DragFloat4("Rotation", &bone->m_rotations[0].value.w, 0.001f))
-        //     bone->m_rotations[0].value = glm::normalize(bone->m_rotations[0].value);
-        ImGui::DragFloat4("Rotation", &bone->m_rotations[0].value[0], 0.001f);
+        ImGui::DragFloat("Blend", &m_selectedAnim->m_blendMask[nodeIndex], 0.01f, 0.0f, 1.0f);
+
+        // compressed keys are not editable
+        if (bone->m_compressed)
+        {
+            ImGui::Text("Keys: %d, %d, %d", bone->m_compressedPositions.m_keyCount, bone->m_compressedRotations.m_keyCount, bone->m_compressedScales.m_keyCount);
+            ImGui::Separator();
+            ImGui::PopID();
+            continue;
+        }
+
+        // edits never reach the shared clip, other animators keep playing it unchanged
+        glm::vec3 position = bone->m_positions[0].value;
+        glm::quat rotation = bone->m_rotations[0].value;
+        bool positionChanged = ImGui::DragFloat3("Position", &position[0], 0.001f);
+        bool rotationChanged = ImGui::DragFloat4("Rotation", &rotation[0], 0.001f);
+        if (positionChanged || rotationChanged)
+        {
+            m_selectedAnim->makeClipUnique();
+            bone = m_selectedAnim->m_channels[nodeIndex];
+            bone->m_positions[0].value = position;
+            bone->m_rotations[0].value = rotation;
+        }
 
         ImGui::Separator();
         ImGui::PopID();
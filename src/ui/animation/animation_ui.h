@@ -13,7 +13,7 @@ private:
 public:
     AnimationUI(Animator *animator);
 
-    Animation *m_selectedAnimation;
+    Anim *m_selectedAnim;
     std::vector<std::string> m_boneNames;
 
     void render() override;
@@ -11,7 +11,7 @@ void ParticleUI::render()
 
 void ParticleUI::renderParticleEngine(ParticleEngine *pe, int index)
 {
-    ImGui::Text("size: %d", (int)pe->m_particles.size());
+    ImGui::Text("size: %d/%d", pe->m_pool->m_count, pe->m_pool->m_capacity);
     ImGui::DragFloat((std::to_string(index) + ":m_particlesPerSecond").c_str(), &pe->m_particlesPerSecond, 1.f);
     ImGui::DragFloat((std::to_string(index) + ":m_randomness").c_str(), &pe->m_randomness, 0.01f);
     ImGui::DragFloat((std::to_string(index) + ":m_minVelocity").c_str(), &pe->m_minVelocity, 0.01f);
@@ -28,6 +28,27 @@ RenderUI::RenderUI(InputManager *inputManager, RenderManager *renderManager, Res
                                                      std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
     m_inputManager->addFileDropListener(std::bind(&RenderUI::fileDropListener, this,
                                                   std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+
+    glGenVertexArrays(1, &m_normalVAO);
+    glGenBuffers(1, &m_normalVBO);
+    glGenBuffers(1, &m_normalEBO);
+
+    // position, color
+    glBindVertexArray(m_normalVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_normalVBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_normalEBO);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)(3 * sizeof(float)));
+    glBindVertexArray(0);
+}
+
+RenderUI::~RenderUI()
+{
+    glDeleteVertexArrays(1, &m_normalVAO);
+    glDeleteBuffers(1, &m_normalVBO);
+    glDeleteBuffers(1, &m_normalEBO);
 }
 
 void RenderUI::render()
@@ -49,7 +70,7 @@ void RenderUI::render()
     renderPostProcess();
     renderRenderSources();
     renderLightSources();
-    // TODO: particle sources
+    renderParticleSources();
 
     renderSelectedSourceWindow();
 }
@@ -279,7 +300,7 @@ void RenderUI::drawSelectedSource(Shader &simpleShader, glm::mat4 mvp)
     glEnable(GL_DEPTH_TEST);
 }
 
-void RenderUI::drawSelectedNormals(Shader &lineShader, glm::mat4 mvp, unsigned int vbo, unsigned int vao, unsigned int ebo)
+void RenderUI::drawSelectedNormals(Shader &lineShader, glm::mat4 mvp)
 {
     if (!m_drawNormals || m_selectedSource == nullptr)
         return;
@@ -288,29 +309,21 @@ void RenderUI::drawSelectedNormals(Shader &lineShader, glm::mat4 mvp, unsigned i
     {
         setupDrawNormals();
         m_drawNormalSource = m_selectedSource;
+
+        glBindBuffer(GL_ARRAY_BUFFER, m_normalVBO);
+        glBufferData(GL_ARRAY_BUFFER, m_normalVertices.size() * sizeof(GLfloat), m_normalVertices.data(), GL_STATIC_DRAW);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_normalEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_normalIndices.size() * sizeof(GLuint), m_normalIndices.data(), GL_STATIC_DRAW);
     }
 
     glm::mat4 model = m_selectedSource->modelMatrix;
     mvp = mvp * model;
 
-    glBindVertexArray(vao);
-
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, m_normalVertices.size() * sizeof(float), m_normalVertices.data(), GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_normalIndices.size() * sizeof(float), m_normalIndices.data(), GL_STATIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)0);
-
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)(3 * sizeof(float)));
-
     lineShader.use();
     lineShader.setMat4("MVP", mvp);
 
-    glBindVertexArray(vao);
+    glBindVertexArray(m_normalVAO);
     glDrawElements(GL_LINES, m_normalIndices.size(), GL_UNSIGNED_INT, 0);
     glBindVertexArray(0);
 }
@@ -422,13 +435,10 @@ void RenderUI::renderRenderSource(RenderSource *source)
 {
     std::stringstream ss;
     ss << source;
-    if (source->cullIndex != -1)
+    for (int i = 0; i < m_renderManager->m_shadowManager->m_splitCount; i++)
     {
-        for (int i = 0; i < m_renderManager->m_shadowManager->m_sceneObjects[source->cullIndex].frustumIndexes.size(); i++)
-        {
-            ss << ", ";
-            ss << m_renderManager->m_shadowManager->m_sceneObjects[source->cullIndex].frustumIndexes[i];
-        }
+        if (source->shadowCascades & (1 << i))
+            ss << ", " << i;
     }
 
     if (source->model != nullptr)
@@ -478,6 +488,23 @@ void RenderUI::renderSelectedSourceWindow()
     ImGui::Checkbox("Draw Normals", &m_drawNormals);
     if (ImGui::DragFloat("Normal Size", &m_normalSize, 0.001f))
         m_drawNormalSource = nullptr;
+    if (m_selectedSource->model && !m_selectedSource->animator &&
+        !m_selectedSource->model->meshes.empty() && m_selectedSource->model->meshes[0]->poolVAO == 0)
+    {
+        if (ImGui::Button("Add To Static Geometry"))
+            m_renderManager->addStaticGeometry(m_selectedSource->model);
+    }
+    else if (m_selectedSource->model && !m_selectedSource->model->meshes.empty() && m_selectedSource->model->meshes[0]->pool)
+    {
+        if (ImGui::Button("Remove From Static Geometry"))
+            m_renderManager->removeStaticGeometry(m_selectedSource->model);
+    }
+    if (m_selectedSource->model)
+    {
+        bool occluder = m_selectedSource->occluder;
+        if (ImGui::Checkbox("Occluder", &occluder))
+            m_renderManager->setOccluder(m_selectedSource, occluder);
+    }
     if (m_selectedSource->animator)
     {
         ImGui::Checkbox("Draw Armature", &m_drawArmature);
@@ -563,6 +590,42 @@ void RenderUI::renderLightSources()
     ImGui::TreePop();
 }
 
+void RenderUI::renderParticleSources()
+{
+    if (!ImGui::TreeNode("Particle Sources"))
+        return;
+
+    ParticleManager *particleManager = m_renderManager->m_particleManager;
+    const ParticleStats &stats = particleManager->m_stats;
+    ImGui::Text("sources: %d, particles: %d, throttled: %d, budget scale: %.2f, update: %.3f ms", stats.sourceCount,
+                stats.particleCount, stats.throttledCount, stats.budgetScale, stats.updateTime);
+    ImGui::DragInt("m_particleBudget", &particleManager->m_particleBudget, 256, 0, 1 << 20);
+    ImGui::DragFloat("m_throttleNear", &particleManager->m_throttleNear, 1.f, 0.f, 1000.f);
+    ImGui::DragFloat("m_throttleFar", &particleManager->m_throttleFar, 1.f, 0.f, 1000.f);
+    ImGui::DragFloat("m_minEmission", &particleManager->m_minEmission, 0.01f, 0.f, 1.f);
+
+    // opt in per source, particles are restarted on the other backend
+    for (int i = 0; i < particleManager->m_sources.size(); i++)
+    {
+        RenderParticleSource *source = particleManager->m_sources[i];
+        ParticleEngine *engine = source->particleEngine;
+
+        ImGui::PushID(source);
+        bool gpu = engine->m_backend == ParticleBackend::gpu;
+        if (ImGui::Checkbox("GPU", &gpu))
+            m_renderManager->setParticleBackend(source, gpu ? ParticleBackend::gpu : ParticleBackend::cpu);
+        ImGui::SameLine();
+        if (gpu)
+            ImGui::Text("%d: capacity: %d, rate: %.0f/s", i, engine->m_pool->m_capacity, engine->m_particlesPerSecond);
+        else
+            ImGui::Text("%d: particles: %d/%d, rate: %.0f/s", i, engine->m_pool->m_count, engine->m_pool->m_capacity, engine->m_particlesPerSecond);
+        ImGui::DragFloat("m_particlesPerSecond", &engine->m_particlesPerSecond, 10.f, 0.f, 1e6f);
+        ImGui::PopID();
+    }
+
+    ImGui::TreePop();
+}
+
 void RenderUI::renderDebug()
 {
     // if (!ImGui::TreeNode("Debug##RenderUI::renderDebug", ImGuiTreeNodeFlags_DefaultOpen))
@@ -582,6 +645,11 @@ void RenderUI::renderDebug()
     }
     ImGui::Checkbox("m_lightAreaDebug", &m_renderManager->m_lightAreaDebug);
     ImGui::Checkbox("m_lightSurfaceDebug", &m_renderManager->m_lightSurfaceDebug);
+    ImGui::Checkbox("m_clusteredLighting", &m_renderManager->m_clusteredLighting);
+    ImGui::Checkbox("m_lightPointDebug", &m_renderManager->m_lightPointDebug);
+    const LightClusterStats &clusterStats = m_renderManager->m_lightClusters->m_stats;
+    ImGui::Text("lights: %d, visible: %d, indices: %d, max per cluster: %d, build: %.3f ms", clusterStats.lightCount,
+                clusterStats.visibleCount, clusterStats.indexCount, clusterStats.maxClusterLights, clusterStats.buildTime);
     //
     VectorUI::renderVec3("m_shadowBias", m_renderManager->m_shadowBias, 0.001f);
 
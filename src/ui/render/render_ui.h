@@ -14,6 +14,7 @@ class RenderUI : public BaseUI, public Updatable
 {
 public:
     RenderUI(InputManager *inputManager, RenderManager *renderManager, ResourceManager *resourceManager);
+    ~RenderUI();
 
     InputManager *m_inputManager;
     RenderManager *m_renderManager;
@@ -32,6 +33,8 @@ public:
     RenderSource *m_drawNormalSource;
     std::vector<GLfloat> m_normalVertices;
     std::vector<GLuint> m_normalIndices;
+    // filled when the source or the size changes
+    unsigned int m_normalVAO, m_normalVBO, m_normalEBO;
     // armature
     bool m_drawArmature;
     bool m_drawArmatureInFront;
@@ -55,13 +58,14 @@ public:
     void renderAddRenderSource();
 
     void drawSelectedSource(Shader &simpleShader, glm::mat4 mvp);
-    void drawSelectedNormals(Shader &lineShader, glm::mat4 mvp, unsigned int vbo, unsigned int vao, unsigned int ebo);
+    void drawSelectedNormals(Shader &lineShader, glm::mat4 mvp);
     void drawSelectedArmature(Shader &simpleShader);
 
     void renderRenderSource(RenderSource *source);
     void renderSelectedSourceWindow();
     void renderRenderSources();
     void renderLightSources();
+    void renderParticleSources();
     void renderDebug();
     void renderGBuffer();
     void renderSSAO();
@@ -1,5 +1,53 @@
 #include "shadowmap_ui.h"
 
+// lines of the frustum edges, then the triangles of a box
+#define SHADOWMAP_UI_LINE_INDICES 24
+#define SHADOWMAP_UI_BOX_INDICES 36
+
+ShadowmapUI::ShadowmapUI(ShadowManager *shadowManager, ShadowmapManager *shadowmapManager)
+    : m_shadowManager(shadowManager),
+      m_shadowmapManager(shadowmapManager)
+{
+    m_frustumBuffer = new StreamBuffer();
+    m_frustumAABBBuffer = new StreamBuffer();
+    m_lightAABBBuffer = new StreamBuffer();
+
+    GLuint indices[] = {
+        // Near plane
+        0, 1, 1, 2, 2, 3, 3, 0,
+        // Far plane
+        4, 5, 5, 6, 6, 7, 7, 4,
+        // Connections between planes
+        0, 4, 1, 5, 2, 6, 3, 7,
+
+        0, 1, 2, 2, 3, 0, // Front face
+        1, 5, 6, 6, 2, 1, // Right face
+        5, 4, 7, 7, 6, 5, // Back face
+        4, 0, 3, 3, 7, 4, // Left face
+        3, 2, 6, 6, 7, 3, // Top face
+        0, 1, 5, 5, 4, 0, // Bottom face
+    };
+
+    glGenVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_ebo);
+
+    // element array binding is vertex array state
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+}
+
+ShadowmapUI::~ShadowmapUI()
+{
+    glDeleteVertexArrays(1, &m_vao);
+    glDeleteBuffers(1, &m_ebo);
+    delete m_frustumBuffer;
+    delete m_frustumAABBBuffer;
+    delete m_lightAABBBuffer;
+}
+
 void ShadowmapUI::render()
 {
     if (!ImGui::CollapsingHeader("Shadowmap", ImGuiTreeNodeFlags_NoTreePushOnOpen))
@@ -23,157 +71,114 @@ void ShadowmapUI::render()
         m_shadowmapManager->updateSize(size);
 }
 
-void ShadowmapUI::drawFrustum(Shader &simpleShader, glm::mat4 mvp, unsigned int c_vbo, unsigned int c_vao, unsigned int c_ebo)
+void ShadowmapUI::drawFrustum(Shader &simpleShader, glm::mat4 mvp)
 {
     if (!m_drawFrustum)
         return;
 
+    std::vector<glm::vec3> vertices;
     for (int i = 0; i < m_shadowManager->m_splitCount; i++)
-    {
-        GLuint indices[] = {
-            // Near plane
-            0, 1, 1, 2, 2, 3, 3, 0,
-            // Far plane
-            4, 5, 5, 6, 6, 7, 7, 4,
-            // Connections between planes
-            0, 4, 1, 5, 2, 6, 3, 7};
-
-        glBindVertexArray(c_vao);
+        vertices.insert(vertices.end(), m_shadowManager->m_frustums[i].points, m_shadowManager->m_frustums[i].points + 8);
 
-        glBindBuffer(GL_ARRAY_BUFFER, c_vbo);
-        glBufferData(GL_ARRAY_BUFFER, 24 * sizeof(float), m_shadowManager->m_frustums[i].points, GL_STATIC_DRAW);
+    size_t offset = m_frustumBuffer->uploadChanged(vertices.data(), vertices.size() * sizeof(glm::vec3));
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, c_ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, 24 * sizeof(float), indices, GL_STATIC_DRAW);
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_frustumBuffer->m_buffer);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)offset);
 
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
+    simpleShader.use();
+    simpleShader.setMat4("MVP", mvp);
+    simpleShader.setMat4("u_meshOffset", glm::mat4(1.0));
+    simpleShader.setVec4("DiffuseColor", glm::vec4(0.0, 1.0, 1.0, 1.0f));
 
-        simpleShader.use();
-        simpleShader.setMat4("MVP", mvp);
-        simpleShader.setMat4("u_meshOffset", glm::mat4(1.0));
-        simpleShader.setVec4("DiffuseColor", glm::vec4(0.0, 1.0, 1.0, 1.0f));
+    // 8 corners per split
+    for (int i = 0; i < m_shadowManager->m_splitCount; i++)
+        glDrawElementsBaseVertex(GL_LINES, SHADOWMAP_UI_LINE_INDICES, GL_UNSIGNED_INT, 0, i * 8);
 
-        glBindVertexArray(c_vao);
-        glDrawElements(GL_LINES, 24, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-    }
+    glBindVertexArray(0);
 }
 
-void ShadowmapUI::drawFrustumAABB(Shader &simpleShader, glm::mat4 mvp, unsigned int c_vbo, unsigned int c_vao, unsigned int c_ebo)
+void ShadowmapUI::drawFrustumAABB(Shader &simpleShader, glm::mat4 mvp)
 {
     if (!m_drawFrustumAABB)
         return;
 
-    for (int i = 0; i < m_shadowManager->m_splitCount; i++)
-    {
-        glm::vec3 minPoint = m_shadowManager->m_aabb.min;
-        glm::vec3 maxPoint = m_shadowManager->m_aabb.max;
+    glm::vec3 minPoint = m_shadowManager->m_aabb.min;
+    glm::vec3 maxPoint = m_shadowManager->m_aabb.max;
 
-        glm::vec3 vertices[] = {
-            glm::vec3(minPoint.x, minPoint.y, minPoint.z),
-            glm::vec3(maxPoint.x, minPoint.y, minPoint.z),
-            glm::vec3(maxPoint.x, maxPoint.y, minPoint.z),
-            glm::vec3(minPoint.x, maxPoint.y, minPoint.z),
-            glm::vec3(minPoint.x, minPoint.y, maxPoint.z),
-            glm::vec3(maxPoint.x, minPoint.y, maxPoint.z),
-            glm::vec3(maxPoint.x, maxPoint.y, maxPoint.z),
-            glm::vec3(minPoint.x, maxPoint.y, maxPoint.z)};
+    glm::vec3 vertices[] = {
+        glm::vec3(minPoint.x, minPoint.y, minPoint.z),
+        glm::vec3(maxPoint.x, minPoint.y, minPoint.z),
+        glm::vec3(maxPoint.x, maxPoint.y, minPoint.z),
+        glm::vec3(minPoint.x, maxPoint.y, minPoint.z),
+        glm::vec3(minPoint.x, minPoint.y, maxPoint.z),
+        glm::vec3(maxPoint.x, minPoint.y, maxPoint.z),
+        glm::vec3(maxPoint.x, maxPoint.y, maxPoint.z),
+        glm::vec3(minPoint.x, maxPoint.y, maxPoint.z)};
 
-        int indices[] = {
-            0, 1, 2, 2, 3, 0, // Front face
-            1, 5, 6, 6, 2, 1, // Right face
-            5, 4, 7, 7, 6, 5, // Back face
-            4, 0, 3, 3, 7, 4, // Left face
-            3, 2, 6, 6, 7, 3, // Top face
-            4, 5, 1, 1, 0, 4, // Bottom face
-        };
+    size_t offset = m_frustumAABBBuffer->uploadChanged(vertices, sizeof(vertices));
 
-        glBindVertexArray(c_vao);
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_frustumAABBBuffer->m_buffer);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)offset);
 
-        glBindBuffer(GL_ARRAY_BUFFER, c_vbo);
-        glBufferData(GL_ARRAY_BUFFER, 24 * sizeof(float), vertices, GL_STATIC_DRAW);
+    simpleShader.use();
+    simpleShader.setMat4("MVP", mvp);
+    simpleShader.setMat4("u_meshOffset", glm::mat4(1.0));
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, c_ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, 36 * sizeof(float), indices, GL_STATIC_DRAW);
+    for (int i = 0; i < m_shadowManager->m_splitCount; i++)
+        drawBox(simpleShader, glm::vec4(1.0, 0.0, 1.0, 0.2f), 0);
 
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
+    glBindVertexArray(0);
+}
 
-        simpleShader.use();
-        simpleShader.setMat4("MVP", mvp);
-        simpleShader.setMat4("u_meshOffset", glm::mat4(1.0));
-        simpleShader.setVec4("DiffuseColor", glm::vec4(1.0, 0.0, 1.0, 0.2f));
+void ShadowmapUI::drawLightAABB(Shader &simpleShader, glm::mat4 mvp, glm::mat4 inverseDepthViewMatrix)
+{
+    if (!m_drawAABB)
+        return;
 
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    std::vector<glm::vec3> vertices;
+    for (int i = 0; i < m_shadowManager->m_splitCount; i++)
+        vertices.insert(vertices.end(), m_shadowManager->m_frustums[i].lightAABB, m_shadowManager->m_frustums[i].lightAABB + 8);
 
-        glBindVertexArray(c_vao);
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+    size_t offset = m_lightAABBBuffer->uploadChanged(vertices.data(), vertices.size() * sizeof(glm::vec3));
 
-        glDisable(GL_BLEND);
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_lightAABBBuffer->m_buffer);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)offset);
 
-        simpleShader.setVec4("DiffuseColor", glm::vec4(0.0, 0.0, 0.0, 1.0f));
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+    simpleShader.use();
+    simpleShader.setMat4("MVP", mvp * inverseDepthViewMatrix);
+    simpleShader.setMat4("u_meshOffset", glm::mat4(1.0));
 
-        glBindVertexArray(0);
+    for (int i = 0; i < m_shadowManager->m_splitCount; i++)
+    {
+        glm::vec4 color = glm::vec4(1.0, 1.0, 1.0, 0.2f);
+        color[i] *= 0.7;
+        drawBox(simpleShader, color, i * 8);
     }
 
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glBindVertexArray(0);
 }
 
-void ShadowmapUI::drawLightAABB(Shader &simpleShader, glm::mat4 mvp, glm::mat4 inverseDepthViewMatrix, unsigned int c_vbo, unsigned int c_vao, unsigned int c_ebo)
+// blended faces with black edges, the vertex array is bound
+void ShadowmapUI::drawBox(Shader &simpleShader, glm::vec4 color, int baseVertex)
 {
-    if (!m_drawAABB)
-        return;
+    void *indexOffset = (void *)(SHADOWMAP_UI_LINE_INDICES * sizeof(GLuint));
 
-    for (int i = 0; i < m_shadowManager->m_splitCount; i++)
-    {
-        // Define indices
-        GLuint indices[] = {
-            0, 1, 2, 2, 3, 0, // Front face
-            1, 5, 6, 6, 2, 1, // Right face
-            5, 4, 7, 7, 6, 5, // Back face
-            4, 0, 3, 3, 7, 4, // Left face
-            3, 2, 6, 6, 7, 3, // Top face
-            0, 1, 5, 5, 4, 0, // Bottom face
-        };
-
-        glBindVertexArray(c_vao);
-
-        glBindBuffer(GL_ARRAY_BUFFER, c_vbo);
-        glBufferData(GL_ARRAY_BUFFER, 24 * sizeof(float), m_shadowManager->m_frustums[i].lightAABB, GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, c_ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, 36 * sizeof(float), indices, GL_STATIC_DRAW);
-
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
-
-        simpleShader.use();
-        simpleShader.setMat4("MVP", mvp * inverseDepthViewMatrix);
-        simpleShader.setMat4("u_meshOffset", glm::mat4(1.0));
-        glm::vec4 color = glm::vec4(1.0, 1.0, 1.0, 0.2f);
-        color[i] *= 0.7;
-        simpleShader.setVec4("DiffuseColor", color);
+    simpleShader.setVec4("DiffuseColor", color);
 
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-        glBindVertexArray(c_vao);
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-        glDisable(GL_BLEND);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDrawElementsBaseVertex(GL_TRIANGLES, SHADOWMAP_UI_BOX_INDICES, GL_UNSIGNED_INT, indexOffset, baseVertex);
 
-        simpleShader.setVec4("DiffuseColor", glm::vec4(0.0, 0.0, 0.0, 1.0f));
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+    glDisable(GL_BLEND);
 
-        glBindVertexArray(0);
-    }
+    simpleShader.setVec4("DiffuseColor", glm::vec4(0.0, 0.0, 0.0, 1.0f));
+    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    glDrawElementsBaseVertex(GL_TRIANGLES, SHADOWMAP_UI_BOX_INDICES, GL_UNSIGNED_INT, indexOffset, baseVertex);
 
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 }
@@ -186,7 +191,7 @@ void ShadowmapUI::drawShadowmap(Shader &textureArrayShader, float screenWidth, f
     textureArrayShader.use();
 
     glActiveTexture(GL_TEXTURE0);
-    glUniform1i(glGetUniformLocation(textureArrayShader.id, "renderedTexture"), 0);
+    textureArrayShader.setInt("renderedTexture", 0);
     glBindTexture(GL_TEXTURE_2D_ARRAY, m_shadowmapManager->m_textureArray);
 
     for (int i = 0; i < m_shadowManager->m_splitCount; i++)
@@ -6,6 +6,7 @@
 #include "../../shadowmap_manager/shadowmap_manager.h"
 #include "../../camera/camera.h"
 #include "../../shader/shader.h"
+#include "../../stream_buffer/stream_buffer.h"
 
 class ShadowmapUI : public BaseUI
 {
@@ -13,12 +14,18 @@ private:
     ShadowManager *m_shadowManager;
     ShadowmapManager *m_shadowmapManager;
 
+    // corners of every split, uploaded only when they change
+    StreamBuffer *m_frustumBuffer;
+    StreamBuffer *m_frustumAABBBuffer;
+    StreamBuffer *m_lightAABBBuffer;
+    // line and box indices never change, uploaded once
+    unsigned int m_vao, m_ebo;
+
+    void drawBox(Shader &simpleShader, glm::vec4 color, int baseVertex);
+
 public:
-    ShadowmapUI(ShadowManager *shadowManager, ShadowmapManager *shadowmapManager)
-        : m_shadowManager(shadowManager),
-          m_shadowmapManager(shadowmapManager)
-    {
-    }
+    ShadowmapUI(ShadowManager *shadowManager, ShadowmapManager *shadowmapManager);
+    ~ShadowmapUI();
 
     float m_quadScale = 0.2f;
     bool m_drawFrustum = false;
@@ -27,9 +34,9 @@ public:
     bool m_drawShadowmap = false;
 
     void render() override;
-    void drawFrustum(Shader &simpleShader, glm::mat4 mvp, unsigned int c_vbo, unsigned int c_vao, unsigned int c_ebo);
-    void drawFrustumAABB(Shader &simpleShader, glm::mat4 mvp, unsigned int c_vbo, unsigned int c_vao, unsigned int c_ebo);
-    void drawLightAABB(Shader &simpleShader, glm::mat4 mvp, glm::mat4 inverseDepthViewMatrix, unsigned int c_vbo, unsigned int c_vao, unsigned int c_ebo);
+    void drawFrustum(Shader &simpleShader, glm::mat4 mvp);
+    void drawFrustumAABB(Shader &simpleShader, glm::mat4 mvp);
+    void drawLightAABB(Shader &simpleShader, glm::mat4 mvp, glm::mat4 inverseDepthViewMatrix);
     void drawShadowmap(Shader &textureArrayShader, float screenWidth, float screenHeight, unsigned int q_vao);
 };
 
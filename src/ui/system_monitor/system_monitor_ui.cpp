@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "system_monitor_ui.h"
 #include "ui/common/common_ui.h"
 
@@ -9,7 +11,117 @@ void SystemMonitorUI::render()
     ImGuiIO &io = ImGui::GetIO();
     ImGui::Text("FPS: %.1f", io.Framerate);
     ImGui::Text("RAM: %.2f MB", static_cast<float>(m_ramUsage) / (1024.0f * 1024.0f));
+    const StreamStats &stream = StreamBuffer::s_stats;
+    ImGui::Text("Uploaded: %.2f KB, uploads: %d, skipped: %d, stalls: %d", stream.bytesUploaded / 1024.0f,
+                stream.uploadCount, stream.skippedCount, stream.stallCount);
     CommonUI::DrawTimerWidget(m_timer, "Timer");
+    renderAnimation();
+    renderQueueStats();
+}
+
+void SystemMonitorUI::renderAnimation()
+{
+    if (!ImGui::TreeNode("Animation"))
+        return;
+
+    ImGui::Checkbox("batchPoseBlending", &m_renderManager->m_batchPoseBlending);
+    ImGui::DragFloat("blendingTolerance", &m_blendingTolerance, 0.001f, 0.f, 1.f, "%.4f");
+    if (ImGui::Button("Compare Blending"))
+        compareBlending();
+    if (m_blendingError >= 0.f)
+    {
+        ImGui::SameLine();
+        ImGui::Text("%s, max error: %.6f", m_blendingError <= m_blendingTolerance ? "pass" : "fail", m_blendingError);
+    }
+
+    ImGui::Separator();
+    ImGui::Text("LOD");
+    AnimationLodSettings &settings = m_renderManager->m_animationLod;
+    const int *counts = m_renderManager->m_animationLodCounts;
+
+    ImGui::Checkbox("enabled##SystemMonitorUI::renderAnimation", &settings.enabled);
+    ImGui::DragFloat("reducedBonesScreenSize", &settings.reducedBonesScreenSize, 0.005f, 0.f, 1.f);
+    ImGui::DragInt("reducedBoneDepth", &settings.reducedBoneDepth, 0.1f, 0, 32);
+    ImGui::DragFloat("reducedRateDistance", &settings.reducedRateDistance, 1.f, 0.f, 1000.f);
+    ImGui::DragInt("reducedRateInterval", &settings.reducedRateInterval, 0.1f, 1, 16);
+
+    ImGui::Text("full: %d", counts[(int)AnimationLod::full]);
+    ImGui::Text("reducedBones: %d", counts[(int)AnimationLod::reducedBones]);
+    ImGui::Text("reducedRate: %d", counts[(int)AnimationLod::reducedRate]);
+    ImGui::Text("offscreen: %d", counts[(int)AnimationLod::offscreen]);
+
+    ImGui::TreePop();
+}
+
+void SystemMonitorUI::renderQueueStats()
+{
+    if (!ImGui::TreeNode("Render Queue"))
+        return;
+
+    const char *passNames[(int)RenderPass::COUNT] = {"depth 0", "depth 1", "depth 2", "depth 3",
+                                                     "static depth 0", "static depth 1", "static depth 2", "static depth 3",
+                                                     "opaque"};
+    ImGui::Checkbox("instancedBatching", &m_renderManager->m_instancedBatching);
+    ImGui::Text("items: %d", (int)m_renderManager->m_renderQueue.m_items.size());
+    GeometryPool *pool = m_renderManager->m_geometryPool;
+    ImGui::Text("pool meshes: %d, vertices: %d/%d, indices: %d/%d", pool->m_meshCount,
+                pool->m_vertexCount, pool->m_vertexCapacity, pool->m_indexCount, pool->m_indexCapacity);
+
+    CullingManager *cullingManager = m_renderManager->m_cullingManager;
+    const OcclusionStats &occlusion = cullingManager->m_occlusionStats;
+    const CullingStats &culling = cullingManager->m_stats;
+    ImGui::Text("culling objects: %d, leaves: %d/%d, visible: %d, cull: %.3f ms", culling.objectCount,
+                culling.testedLeafCount, culling.leafCount, culling.visibleCount, culling.cullTime);
+    ImGui::Text("shadow casters: %d, cull: %.3f ms", culling.volumeObjectCount, culling.volumeTime);
+    for (int i = 0; i < cullingManager->m_volumes.size(); i++)
+    {
+        const CullVolume &volume = cullingManager->m_volumes[i];
+        ImGui::Text("cascade %d casters: %d, leaves: %d/%d", i, (int)volume.objects.size(), volume.testedLeafCount, culling.leafCount);
+    }
+    ShadowCacheSettings &shadowCache = m_renderManager->m_shadowCache;
+    const ShadowCacheStats &shadowCacheStats = m_renderManager->m_shadowCacheStats;
+    ImGui::Checkbox("shadowCache", &shadowCache.enabled);
+    ImGui::DragInt("staticFrames", &shadowCache.staticFrames, 1.f, 0, 600);
+    ImGui::DragInt4("cascadeIntervals", shadowCache.updateIntervals, 0.1f, 1, 16);
+    ImGui::Text("cascades updated: %d, rebuilt: %d, static casters: %d, dynamic: %d", shadowCacheStats.updatedCascades,
+                shadowCacheStats.rebuiltCascades, shadowCacheStats.staticCasters, shadowCacheStats.dynamicCasters);
+    ImGui::Checkbox("occlusionCulling", &cullingManager->m_occlusionCulling);
+    ImGui::Text("occluders: %d, triangles: %d, raster: %.3f ms", occlusion.occluderCount, occlusion.triangleCount, occlusion.rasterTime);
+    ImGui::Text("occluded: %d/%d", occlusion.occludedCount, occlusion.testedCount);
+
+    MeshLodSelection &lodSelection = m_renderManager->m_meshLodSelection;
+    ImGui::Checkbox("meshLod", &lodSelection.enabled);
+    ImGui::DragFloat("lodScreenSize", &lodSelection.screenSize, 0.005f, 0.f, 1.f);
+    ImGui::DragFloat("lodHysteresis", &lodSelection.hysteresis, 0.005f, 0.f, 0.5f);
+
+    for (int i = 0; i < (int)RenderPass::COUNT; i++)
+    {
+        const RenderPassStats &stats = m_renderManager->m_renderQueue.m_stats[i];
+        ImGui::Separator();
+        ImGui::Text("%s", passNames[i]);
+        ImGui::Text("draws: %d, instanced: %d, multi: %d, meshes: %d, submit: %.3f ms",
+                    stats.drawCount, stats.instancedDrawCount, stats.multiDrawCount, stats.meshCount, stats.submitTime);
+        ImGui::Text("triangles: %d", stats.triangleCount);
+        ImGui::Text("shader: %d, raster: %d, material: %d, vao: %d",
+                    stats.shaderChanges, stats.rasterChanges, stats.materialChanges, stats.vaoChanges);
+    }
+
+    ImGui::TreePop();
+}
+
+// batch path against the scalar path for every animator in the scene
+void SystemMonitorUI::compareBlending()
+{
+    m_blendingError = 0.f;
+
+    std::vector<RenderSource *> &sources = m_renderManager->m_pbrSources;
+    for (int i = 0; i < sources.size(); i++)
+    {
+        if (!sources[i]->animator)
+            continue;
+
+        m_blendingError = std::max(m_blendingError, sources[i]->animator->compareBlending());
+    }
 }
 
 void SystemMonitorUI::update(float deltaTime)
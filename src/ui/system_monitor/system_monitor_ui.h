@@ -1,6 +1,7 @@
 #ifndef system_monitor_ui_hpp
 #define system_monitor_ui_hpp
 
+#include "../../render_manager/render_manager.h"
 #include "../../timer/timer.h"
 #include "../../update_manager/update_manager.h"
 #include "../../utils/common.h"
@@ -9,15 +10,24 @@
 class SystemMonitorUI : public BaseUI, public Updatable
 {
 public:
-    SystemMonitorUI()
+    SystemMonitorUI(RenderManager *renderManager)
+        : m_renderManager(renderManager)
     {
     }
 
+    RenderManager *m_renderManager;
+    float m_blendingTolerance = 0.01f;
+    float m_blendingError = -1.f;
     uint64_t m_ramUsage;
     Timer m_timer;
 
     void render() override;
     void update(float deltaTime) override;
+
+private:
+    void renderAnimation();
+    void renderQueueStats();
+    void compareBlending();
 };
 
 #endif /* system_monitor_ui_hpp */